@@ -0,0 +1,360 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include "json.hpp" // nlohmann::json, which comes with tinygltf.
+#include "rndrx/log.hpp"
+#include "rndrx/throw_exception.hpp"
+#include "rndrx/vulkan/application.hpp"
+#include "rndrx/vulkan/frame_timeline.hpp"
+#include "rndrx/vulkan/gltf_model_creator.hpp"
+#include "rndrx/vulkan/gpu_frame_timer.hpp"
+#include "rndrx/vulkan/model.hpp"
+#include "rndrx/vulkan/renderer.hpp"
+#include "rndrx/vulkan/submission_context.hpp"
+#include "tiny_gltf.h"
+
+// Renders a fixed number of frames of a glTF scene and writes the CPU and
+// GPU time of every frame, plus percentiles, to JSON so runs of different
+// builds can be compared.
+
+namespace {
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+using rndrx::quote;
+using rndrx::throw_runtime_error;
+
+struct BenchOptions {
+  std::string scene;
+  std::string output = "rndrx-bench.json";
+  std::uint64_t frames = 1000;
+  // Run first and left out of the results so caches, pools and clocks
+  // have settled.
+  std::uint64_t warmup_frames = 60;
+  std::uint32_t frames_in_flight = 2;
+  std::optional<std::size_t> device_idx;
+  rndrx::vulkan::ApplicationConfig app;
+};
+
+struct FrameSample {
+  // Time spent recording and submitting, after the wait for a free frame.
+  double cpu_ms = 0;
+  // Time since the previous frame started.
+  double frame_ms = 0;
+  std::optional<double> gpu_ms;
+};
+
+void print_usage() {
+  std::cerr
+      << "usage: rndrx-bench <scene.gltf> [options]\n"
+         "  --frames <n>            frames to measure (default 1000)\n"
+         "  --warmup <n>            frames to run first (default 60)\n"
+         "  --frames-in-flight <n>  (default 2)\n"
+         "  --headless              render offscreen without a window\n"
+         "  --size <w> <h>          offscreen size (default 1920 1080)\n"
+         "  --device <idx>          adapter index (default first discrete)\n"
+         "  --out <file.json>       (default rndrx-bench.json)\n";
+}
+
+BenchOptions parse_options(int argc, char** argv) {
+  BenchOptions options;
+  auto next_arg = [&](int& i) -> std::string_view {
+    if(i + 1 >= argc) {
+      RNDRX_THROW_RUNTIME_ERROR() << "Missing value for " << argv[i];
+    }
+
+    return argv[++i];
+  };
+
+  for(int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if(arg == "--frames") {
+      options.frames = std::stoull(std::string(next_arg(i)));
+    }
+    else if(arg == "--warmup") {
+      options.warmup_frames = std::stoull(std::string(next_arg(i)));
+    }
+    else if(arg == "--frames-in-flight") {
+      options.frames_in_flight = std::stoul(std::string(next_arg(i)));
+    }
+    else if(arg == "--headless") {
+      options.app.headless = true;
+    }
+    else if(arg == "--size") {
+      options.app.headless_extent.width = std::stoul(std::string(next_arg(i)));
+      options.app.headless_extent.height = std::stoul(
+          std::string(next_arg(i)));
+    }
+    else if(arg == "--device") {
+      options.device_idx = std::stoull(std::string(next_arg(i)));
+    }
+    else if(arg == "--out") {
+      options.output = next_arg(i);
+    }
+    else if(options.scene.empty() && !arg.starts_with("--")) {
+      options.scene = arg;
+    }
+    else {
+      RNDRX_THROW_RUNTIME_ERROR() << "Unknown argument " << arg;
+    }
+  }
+
+  if(options.scene.empty()) {
+    throw_runtime_error("No scene given");
+  }
+
+  if(options.frames == 0 || options.frames_in_flight == 0) {
+    throw_runtime_error("--frames and --frames-in-flight must be positive");
+  }
+
+  return options;
+}
+
+void select_device(rndrx::vulkan::Application& app, BenchOptions const& options) {
+  auto devices = app.physical_devices();
+  if(devices.empty()) {
+    throw_runtime_error("No compatible adapters");
+  }
+
+  if(options.device_idx) {
+    if(*options.device_idx >= devices.size()) {
+      RNDRX_THROW_RUNTIME_ERROR() << "Adapter " << *options.device_idx
+                                  << " doesn't exist";
+    }
+
+    app.select_device(devices[*options.device_idx]);
+    return;
+  }
+
+  auto discrete = std::ranges::find_if(
+      devices,
+      [](vk::raii::PhysicalDevice const& device) {
+        return device.getProperties().deviceType ==
+               vk::PhysicalDeviceType::eDiscreteGpu;
+      });
+  app.select_device(discrete != devices.end() ? *discrete : devices.front());
+}
+
+double milliseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Nearest rank, so the result is always one of the samples.
+double percentile(std::vector<double> const& sorted, double p) {
+  auto rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));
+  return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+}
+
+json summarise(std::vector<double> values) {
+  if(values.empty()) {
+    return nullptr;
+  }
+
+  std::ranges::sort(values);
+  json summary;
+  summary["p50"] = percentile(values, 0.50);
+  summary["p95"] = percentile(values, 0.95);
+  summary["p99"] = percentile(values, 0.99);
+  summary["mean"] = std::accumulate(values.begin(), values.end(), 0.0) /
+                    values.size();
+  summary["min"] = values.front();
+  summary["max"] = values.back();
+  return summary;
+}
+
+json to_json(
+    BenchOptions const& options,
+    rndrx::vulkan::Application const& app,
+    rndrx::vulkan::Renderer const& renderer,
+    double load_ms,
+    std::vector<FrameSample> const& samples) {
+  std::vector<double> cpu_ms;
+  std::vector<double> gpu_ms;
+  std::vector<double> frame_ms;
+  json frames = json::array();
+  for(std::size_t i = 0; i < samples.size(); ++i) {
+    FrameSample const& sample = samples[i];
+    json frame;
+    frame["frame"] = i;
+    frame["cpu_ms"] = sample.cpu_ms;
+    frame["frame_ms"] = sample.frame_ms;
+    cpu_ms.push_back(sample.cpu_ms);
+    frame_ms.push_back(sample.frame_ms);
+    if(sample.gpu_ms) {
+      frame["gpu_ms"] = *sample.gpu_ms;
+      gpu_ms.push_back(*sample.gpu_ms);
+    }
+
+    frames.push_back(std::move(frame));
+  }
+
+  json result;
+  result["scene"] = options.scene;
+  result["device"] = std::string(
+      app.selected_device().getProperties().deviceName.data());
+  result["headless"] = options.app.headless;
+  result["width"] = renderer.output_extent().width;
+  result["height"] = renderer.output_extent().height;
+  result["frames_in_flight"] = options.frames_in_flight;
+  result["warmup_frames"] = options.warmup_frames;
+  result["load_ms"] = load_ms;
+  result["cpu_ms"] = summarise(std::move(cpu_ms));
+  result["gpu_ms"] = summarise(std::move(gpu_ms));
+  result["frame_ms"] = summarise(std::move(frame_ms));
+  result["frames"] = std::move(frames);
+  return result;
+}
+
+void run(BenchOptions const& options) {
+  using namespace rndrx::vulkan;
+  Application app(options.app);
+  select_device(app, options);
+  app.set_frames_in_flight(options.frames_in_flight);
+
+  Renderer renderer(app);
+
+  // Kept resident for the whole run.
+  auto load_start = Clock::now();
+  tinygltf::Model gltf_model = gltf::load_model_from_file(options.scene);
+  GltfModelCreator model_creator(gltf_model);
+  Model model(renderer.device(), renderer.shaders(), model_creator);
+  renderer.device().upload_queue().wait(model.upload_token());
+  double const load_ms = milliseconds(Clock::now() - load_start);
+
+  FrameTimeline timeline(renderer.device());
+  std::deque<SubmissionContext> submission_contexts;
+  for(std::uint32_t i = 0; i < options.frames_in_flight; ++i) {
+    submission_contexts.emplace_back(renderer.device(), timeline);
+  }
+
+  GpuFrameTimer gpu_timer(renderer.device(), options.frames_in_flight);
+  if(!gpu_timer.is_supported()) {
+    LOG(Warn) << "The graphics queue has no timestamps, GPU times are "
+                 "left out.";
+  }
+
+  // Frame indices are consecutive, so a frame's sample is found from its
+  // offset from the first measured one.
+  std::vector<FrameSample> samples;
+  samples.reserve(options.frames);
+  std::uint64_t first_measured_frame = 0;
+  auto record_gpu_times = [&] {
+    while(auto time = gpu_timer.poll(timeline)) {
+      if(first_measured_frame != 0 &&
+         time->frame_index >= first_measured_frame) {
+        samples[time->frame_index - first_measured_frame].gpu_ms =
+            time->gpu_ms;
+      }
+    }
+  };
+
+  std::uint64_t const total_frames = options.warmup_frames + options.frames;
+  auto last_frame_start = Clock::now();
+  for(std::uint64_t i = 0; i < total_frames; ++i) {
+    if(!app.is_headless()) {
+      glfwPollEvents();
+      app.window().handle_window_size();
+      if(glfwWindowShouldClose(app.window().glfw())) {
+        throw_runtime_error("Window closed before the run finished");
+      }
+    }
+
+    auto frame_start = Clock::now();
+    // The recreation is part of the frame's time, like it would be in the
+    // application. It's put off while the window is minimised.
+    bool can_present = true;
+    if(!app.is_headless() && renderer.needs_swapchain_recreation()) {
+      can_present = renderer.recreate_swapchain(
+          app,
+          app.window().extents().extent);
+    }
+
+    SubmissionContext& sc = submission_contexts
+        [timeline.current_frame() % submission_contexts.size()];
+    sc.begin_rendering(vk::Rect2D({0, 0}, renderer.output_extent()));
+    auto cpu_start = Clock::now();
+    if(i == options.warmup_frames) {
+      first_measured_frame = sc.frame_index();
+    }
+
+    // Before begin_frame reuses the queries of an older frame.
+    record_gpu_times();
+    gpu_timer.begin_frame(sc);
+    if(app.is_headless()) {
+      renderer.render_offscreen(sc);
+      gpu_timer.end_frame(sc);
+      sc.finish_rendering();
+    }
+    else if(auto present_ctx = can_present
+                                   ? renderer.acquire_present_context()
+                                   : std::nullopt) {
+      renderer.render(sc, *present_ctx);
+      gpu_timer.end_frame(sc);
+      sc.finish_rendering();
+      renderer.present(*present_ctx);
+    }
+    else {
+      gpu_timer.end_frame(sc);
+      sc.finish_rendering();
+    }
+
+    if(i >= options.warmup_frames) {
+      FrameSample sample;
+      sample.cpu_ms = milliseconds(Clock::now() - cpu_start);
+      sample.frame_ms = milliseconds(frame_start - last_frame_start);
+      samples.push_back(sample);
+    }
+
+    last_frame_start = frame_start;
+  }
+
+  timeline.wait_idle();
+  record_gpu_times();
+
+  std::ofstream out(options.output);
+  if(!out) {
+    RNDRX_THROW_RUNTIME_ERROR() << "Failed to open " << quote(options.output);
+  }
+
+  out << to_json(options, app, renderer, load_ms, samples).dump(2) << "\n";
+  LOG(Info) << "Wrote " << samples.size() << " frames to "
+            << quote(options.output);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  try {
+    run(parse_options(argc, argv));
+  }
+  catch(std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    print_usage();
+    return 1;
+  }
+
+  return 0;
+}
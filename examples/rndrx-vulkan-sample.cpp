@@ -13,8 +13,11 @@
 // limitations under the License.
 #include <iostream>
 #include <span>
+#include <string>
+#include <string_view>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_raii.hpp>
+#include "rndrx/throw_exception.hpp"
 #include "rndrx/vulkan/application.hpp"
 
 namespace {
@@ -27,10 +30,96 @@ void choose_graphics_device(rndrx::vulkan::Application& app) {
     }
   }
 }
+
+void print_usage() {
+  std::cerr
+      << "usage: rndrx-vulkan-sample [options]\n"
+         "  --headless              render offscreen without a window\n"
+         "  --pipelined             record frames on a render thread\n"
+         "  --low-latency           wait for a free frame before input\n"
+         "  --profile               time the frame graph nodes\n"
+         "  --max-fps <n>           cap the frame rate (default uncapped)\n"
+         "  --present-mode <mode>   immediate, mailbox, fifo or fifo-relaxed\n"
+         "                          (default mailbox)\n"
+         "  --frames <n>            exit after n frames\n";
+}
+
+rndrx::vulkan::PresentMode parse_present_mode(std::string_view mode) {
+  using rndrx::vulkan::PresentMode;
+  if(mode == "immediate") {
+    return PresentMode::Immediate;
+  }
+  else if(mode == "mailbox") {
+    return PresentMode::Mailbox;
+  }
+  else if(mode == "fifo") {
+    return PresentMode::Fifo;
+  }
+  else if(mode == "fifo-relaxed") {
+    return PresentMode::FifoRelaxed;
+  }
+
+  RNDRX_THROW_RUNTIME_ERROR() << "Unknown present mode " << mode;
+}
+
+rndrx::vulkan::ApplicationConfig parse_options(int argc, char** argv) {
+  rndrx::vulkan::ApplicationConfig config;
+  auto next_arg = [&](int& i) -> std::string_view {
+    if(i + 1 >= argc) {
+      RNDRX_THROW_RUNTIME_ERROR() << "Missing value for " << argv[i];
+    }
+
+    return argv[++i];
+  };
+
+  for(int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if(arg == "--headless") {
+      config.headless = true;
+    }
+    else if(arg == "--pipelined") {
+      config.pipelined_rendering = true;
+    }
+    else if(arg == "--low-latency") {
+      config.low_latency = true;
+    }
+    else if(arg == "--profile") {
+      config.profile_frame_graphs = true;
+    }
+    else if(arg == "--max-fps") {
+      config.max_fps = std::stod(std::string(next_arg(i)));
+    }
+    else if(arg == "--present-mode") {
+      config.present_mode = parse_present_mode(next_arg(i));
+    }
+    else if(arg == "--frames") {
+      config.max_frames = std::stoull(std::string(next_arg(i)));
+    }
+    else {
+      RNDRX_THROW_RUNTIME_ERROR() << "Unknown argument " << arg;
+    }
+  }
+
+  if(config.max_fps < 0) {
+    rndrx::throw_runtime_error("--max-fps can't be negative");
+  }
+
+  return config;
+}
 } // namespace
 
-int main(int, char**) {
-  rndrx::vulkan::Application app;
+int main(int argc, char** argv) {
+  rndrx::vulkan::ApplicationConfig config;
+  try {
+    config = parse_options(argc, argv);
+  }
+  catch(std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    print_usage();
+    return 1;
+  }
+
+  rndrx::vulkan::Application app(config);
   choose_graphics_device(app);
   try {
     app.run();
@@ -0,0 +1,44 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_BUFFERUSAGE_HPP_
+#define RNDRX_BUFFERUSAGE_HPP_
+#pragma once
+
+#include <cstdint>
+
+namespace rndrx {
+// Ways a buffer can be accessed by the passes using it. Combine with |.
+enum class BufferUsage : std::uint32_t {
+  None = 0,
+  Uniform = 1 << 0,
+  Storage = 1 << 1,
+  Indirect = 1 << 2,
+  Vertex = 1 << 3,
+  Index = 1 << 4,
+  TransferSrc = 1 << 5,
+  TransferDst = 1 << 6,
+};
+
+constexpr BufferUsage operator|(BufferUsage a, BufferUsage b) {
+  return static_cast<BufferUsage>(
+      static_cast<std::uint32_t>(a) | static_cast<std::uint32_t>(b));
+}
+
+constexpr bool has_usage(BufferUsage usage, BufferUsage flag) {
+  return (static_cast<std::uint32_t>(usage) &
+          static_cast<std::uint32_t>(flag)) != 0;
+}
+
+} // namespace rndrx
+#endif // RNDRX_BUFFERUSAGE_HPP_
@@ -15,6 +15,9 @@
 #define RNDRX_FORMATS_HPP_
 #pragma once
 
+#include <optional>
+#include <string_view>
+
 namespace rndrx {
 enum class ImageFormat {
   Undefined,
@@ -321,5 +324,9 @@ enum class ImageFormat {
   R12X4UnormPack16KHR,
 };
 
+// The enumerator's name, as used in serialised frame graphs.
+std::string_view to_string(ImageFormat format);
+std::optional<ImageFormat> image_format_from_string(std::string_view name);
+
 }
 #endif // RNDRX_FORMATS_HPP_
\ No newline at end of file
@@ -24,6 +24,7 @@
 #include <variant>
 #include <vector>
 #include "rndrx/attachment_ops.hpp"
+#include "rndrx/buffer_usage.hpp"
 #include "rndrx/formats.hpp"
 
 namespace rndrx {
@@ -45,15 +46,38 @@ class FrameGraphNamedObject {
   std::string name_;
 };
 
+enum class FrameGraphSizeMode {
+  // A fixed resolution in pixels.
+  Absolute,
+  // A fraction of the graph's output extent, so the attachment follows
+  // swapchain resizes.
+  OutputRelative,
+};
+
 class FrameGraphAttachmentOutputDescription : public FrameGraphNamedObject {
  public:
   using FrameGraphNamedObject::FrameGraphNamedObject;
   FrameGraphAttachmentOutputDescription& format(ImageFormat format);
   FrameGraphAttachmentOutputDescription& resolution(int width, int height);
+  // Attachments are the size of the output unless given another size.
+  FrameGraphAttachmentOutputDescription& output_relative_resolution(
+      float scale_x,
+      float scale_y);
+  FrameGraphAttachmentOutputDescription& output_relative_resolution(
+      float scale);
   FrameGraphAttachmentOutputDescription& load_op(AttachmentLoadOp op);
   FrameGraphAttachmentOutputDescription& clear_colour(glm::vec4 colour);
   FrameGraphAttachmentOutputDescription& clear_depth(float depth);
   FrameGraphAttachmentOutputDescription& clear_stencil(int stencil);
+  // Keeps last frame's contents around for passes to read through an input
+  // marked previous_frame(). The attachment gets two images that swap
+  // roles every frame. Graphics queue only.
+  FrameGraphAttachmentOutputDescription& history(bool enabled = true);
+  // The image isn't created by the graph but handed to it every frame with
+  // FrameGraph::import_image(), like an acquired swapchain image. Imported
+  // attachments are always results of the graph, start every frame with
+  // undefined contents and can't be written on the async compute queue.
+  FrameGraphAttachmentOutputDescription& imported(bool enabled = true);
 
   ImageFormat format() const {
     return format_;
@@ -67,6 +91,18 @@ class FrameGraphAttachmentOutputDescription : public FrameGraphNamedObject {
     return height_;
   }
 
+  FrameGraphSizeMode size_mode() const {
+    return size_mode_;
+  }
+
+  float scale_x() const {
+    return scale_x_;
+  }
+
+  float scale_y() const {
+    return scale_y_;
+  }
+
   AttachmentLoadOp load_op() const {
     return load_op_;
   }
@@ -83,14 +119,27 @@ class FrameGraphAttachmentOutputDescription : public FrameGraphNamedObject {
     return clear_stencil_;
   }
 
+  bool history() const {
+    return history_;
+  }
+
+  bool imported() const {
+    return imported_;
+  }
+
  private:
   ImageFormat format_ = ImageFormat::Undefined;
   int width_ = 0;
   int height_ = 0;
+  FrameGraphSizeMode size_mode_ = FrameGraphSizeMode::OutputRelative;
+  float scale_x_ = 1.f;
+  float scale_y_ = 1.f;
   AttachmentLoadOp load_op_ = AttachmentLoadOp::DontCare;
-  glm::vec4 clear_colour_;
+  glm::vec4 clear_colour_ = glm::vec4(0.f);
   float clear_depth_ = 0.f;
   int clear_stencil_ = 0;
+  bool history_ = false;
+  bool imported_ = false;
 };
 
 class FrameGraphAttachmentInputDescription : public FrameGraphNamedObject {
@@ -101,11 +150,38 @@ class FrameGraphAttachmentInputDescription : public FrameGraphNamedObject {
 class FrameGraphInputImageDescription : public FrameGraphNamedObject {
  public:
   using FrameGraphNamedObject::FrameGraphNamedObject;
+  // Reads what the previous frame wrote to a history attachment instead of
+  // this frame's contents. Doesn't order the pass after the writer. The
+  // contents are undefined on the first frame.
+  FrameGraphInputImageDescription& previous_frame(bool enabled = true);
+
+  bool previous_frame() const {
+    return previous_frame_;
+  }
+
+ private:
+  bool previous_frame_ = false;
 };
 
+// As an output, declares a buffer that lives for one frame. As an input
+// only the name is used.
 class FrameGraphBufferDescription : public FrameGraphNamedObject {
  public:
   using FrameGraphNamedObject::FrameGraphNamedObject;
+  FrameGraphBufferDescription& size(std::size_t bytes);
+  FrameGraphBufferDescription& usage(BufferUsage usage);
+
+  std::size_t size() const {
+    return size_;
+  }
+
+  BufferUsage usage() const {
+    return usage_;
+  }
+
+ private:
+  std::size_t size_ = 0;
+  BufferUsage usage_ = BufferUsage::Storage;
 };
 
 using FrameGraphInputDescription = std::variant< //
@@ -117,11 +193,26 @@ using FrameGraphOutputDescription = std::variant< //
     FrameGraphAttachmentOutputDescription,
     FrameGraphBufferDescription>;
 
+enum class FrameGraphPassType {
+  // Rasterisation inside a render pass on the graphics queue.
+  Graphics,
+  // Dispatches on the graphics queue. Outputs are written as storage images.
+  Compute,
+  // Like Compute, but runs on a dedicated compute queue when the device
+  // has one so it can overlap with graphics work.
+  AsyncCompute,
+};
+
 class FrameGraphRenderPassDescription : public FrameGraphNamedObject {
  public:
   using FrameGraphNamedObject::FrameGraphNamedObject;
   FrameGraphRenderPassDescription& add_input(FrameGraphInputDescription input);
   FrameGraphRenderPassDescription& add_output(FrameGraphOutputDescription output);
+  FrameGraphRenderPassDescription& type(FrameGraphPassType type);
+
+  FrameGraphPassType type() const {
+    return type_;
+  }
 
   std::span<FrameGraphInputDescription const> inputs() const {
     return inputs_;
@@ -134,6 +225,7 @@ class FrameGraphRenderPassDescription : public FrameGraphNamedObject {
  private:
   std::vector<FrameGraphInputDescription> inputs_;
   std::vector<FrameGraphOutputDescription> outputs_;
+  FrameGraphPassType type_ = FrameGraphPassType::Graphics;
 };
 
 class FrameGraphDescription {
@@ -141,12 +233,21 @@ class FrameGraphDescription {
   FrameGraphDescription() = default;
   FrameGraphDescription& add_render_pass(FrameGraphRenderPassDescription render_pass);
 
+  // Marks a resource as a result of the graph. When any sinks are given,
+  // passes that don't contribute to one of them are culled.
+  FrameGraphDescription& add_sink(std::string resource_name);
+
   std::span<FrameGraphRenderPassDescription const> passes() const {
     return render_passes_;
   }
 
+  std::span<std::string const> sinks() const {
+    return sinks_;
+  }
+
  private:
   std::vector<FrameGraphRenderPassDescription> render_passes_;
+  std::vector<std::string> sinks_;
 };
 
 struct FrameGraphNamedObjectFromResourceDescription {
@@ -0,0 +1,84 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_FRAMEGRAPHSERIALISATION_HPP_
+#define RNDRX_FRAMEGRAPHSERIALISATION_HPP_
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "rndrx/frame_graph_description.hpp"
+
+namespace rndrx {
+
+// Frame graph descriptions as JSON, so pass layouts can be edited without
+// rebuilding. Passes are listed in order with their inputs and outputs,
+// each tagged with its kind:
+//
+// {
+//   "passes": [{
+//     "name": "lighting",
+//     "type": "Graphics",
+//     "inputs": [{"kind": "attachment", "name": "albedo"}],
+//     "outputs": [{
+//       "kind": "attachment",
+//       "name": "hdr",
+//       "format": "R16G16B16A16Sfloat",
+//       "scale": [1.0, 1.0],
+//       "load_op": "Clear",
+//       "clear_colour": [0.0, 0.0, 0.0, 1.0]
+//     }]
+//   }],
+//   "sinks": ["hdr"]
+// }
+//
+// Inputs are "attachment", "image" or "buffer", outputs "attachment" or
+// "buffer". Attachments have either a "resolution" in pixels or a "scale"
+// of the output extent. Anything left out keeps its default, and the
+// writer leaves out defaults.
+std::string to_json(FrameGraphDescription const& description);
+
+// Throws a std::runtime_error naming the problem on malformed input.
+FrameGraphDescription parse_frame_graph_description(std::string_view json);
+
+void save_frame_graph_description(
+    FrameGraphDescription const& description,
+    std::filesystem::path const& path);
+FrameGraphDescription load_frame_graph_description(
+    std::filesystem::path const& path);
+
+// Polls a description file for changes.
+class FrameGraphDescriptionWatcher {
+ public:
+  FrameGraphDescriptionWatcher() = default;
+  explicit FrameGraphDescriptionWatcher(std::filesystem::path path);
+
+  // The new description if the file changed since the last call and
+  // parses. Parse errors are logged and the file is tried again on its
+  // next change, so a half-saved file doesn't lose the current graph.
+  std::optional<FrameGraphDescription> poll();
+
+  std::filesystem::path const& path() const {
+    return path_;
+  }
+
+ private:
+  std::filesystem::path path_;
+  std::filesystem::file_time_type last_write_time_;
+};
+
+} // namespace rndrx
+
+#endif // RNDRX_FRAMEGRAPHSERIALISATION_HPP_
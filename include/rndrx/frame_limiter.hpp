@@ -0,0 +1,52 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_FRAMELIMITER_HPP_
+#define RNDRX_FRAMELIMITER_HPP_
+#pragma once
+
+#include <chrono>
+
+namespace rndrx {
+
+// Caps the frame rate by waiting on the CPU. It sleeps while the next
+// frame is far enough away for the OS scheduler to be trusted, then spins
+// for the remainder, which lands within microseconds of the target rather
+// than the scheduler's granularity.
+class FrameLimiter {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  FrameLimiter() = default;
+  // max_fps of 0 disables the cap.
+  explicit FrameLimiter(
+      double max_fps,
+      Clock::duration spin_threshold = std::chrono::milliseconds(2));
+
+  bool is_enabled() const {
+    return period_ != Clock::duration::zero();
+  }
+
+  // Returns once the next frame is due. Frames that fall behind by more
+  // than a period restart the schedule instead of bunching up to catch up.
+  void wait();
+
+ private:
+  Clock::duration period_ = Clock::duration::zero();
+  Clock::duration spin_threshold_ = Clock::duration::zero();
+  Clock::time_point next_frame_;
+};
+
+} // namespace rndrx
+
+#endif // RNDRX_FRAMELIMITER_HPP_
@@ -0,0 +1,89 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_HANDOFF_HPP_
+#define RNDRX_HANDOFF_HPP_
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include "rndrx/noncopyable.hpp"
+
+namespace rndrx {
+
+// Passes values from one producer thread to one consumer thread through a
+// single slot without locks. The producer blocks while the previous value
+// hasn't been taken and the consumer while there is nothing to take, both
+// with std::atomic::wait rather than spinning. Either side can close the
+// handoff to release the other.
+template <typename T>
+class Handoff : noncopyable {
+ public:
+  // Blocks until the slot is free. Returns false, dropping value, once the
+  // handoff has been closed.
+  bool push(T value) {
+    std::uint32_t state = state_.load(std::memory_order_acquire);
+    while(state == kFull) {
+      state_.wait(state, std::memory_order_acquire);
+      state = state_.load(std::memory_order_acquire);
+    }
+
+    if(state & kClosed) {
+      return false;
+    }
+
+    // The consumer only touches the slot while it is full.
+    slot_ = std::move(value);
+    state = state_.fetch_or(kFull, std::memory_order_acq_rel);
+    state_.notify_one();
+    return !(state & kClosed);
+  }
+
+  // Blocks until there is a value. Returns nothing once the handoff has
+  // been closed and the last value taken.
+  std::optional<T> pop() {
+    std::uint32_t state = state_.load(std::memory_order_acquire);
+    while(state == 0) {
+      state_.wait(state, std::memory_order_acquire);
+      state = state_.load(std::memory_order_acquire);
+    }
+
+    if(!(state & kFull)) {
+      return std::nullopt;
+    }
+
+    std::optional<T> value = std::move(slot_);
+    slot_.reset();
+    state_.fetch_and(~kFull, std::memory_order_acq_rel);
+    state_.notify_one();
+    return value;
+  }
+
+  void close() {
+    state_.fetch_or(kClosed, std::memory_order_acq_rel);
+    state_.notify_all();
+  }
+
+ private:
+  static constexpr std::uint32_t kFull = 1;
+  static constexpr std::uint32_t kClosed = 2;
+
+  std::atomic<std::uint32_t> state_ = 0;
+  std::optional<T> slot_;
+};
+
+} // namespace rndrx
+
+#endif // RNDRX_HANDOFF_HPP_
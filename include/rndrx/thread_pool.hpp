@@ -0,0 +1,69 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_THREADPOOL_HPP_
+#define RNDRX_THREADPOOL_HPP_
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "rndrx/noncopyable.hpp"
+
+namespace rndrx {
+
+// A fixed set of worker threads that execute batches of jobs. The calling
+// thread takes part in every batch as thread index 0, workers are numbered
+// from 1, so per-thread data can be indexed with [0, concurrency()).
+class ThreadPool : noncopyable {
+ public:
+  using Job = std::function<void(std::size_t job_idx, std::size_t thread_idx)>;
+
+  ThreadPool() = default;
+  explicit ThreadPool(std::size_t num_workers);
+  ~ThreadPool();
+
+  std::size_t concurrency() const {
+    return workers_.size() + 1;
+  }
+
+  // Runs job for every index in [0, count) and returns once all have
+  // completed. The first exception thrown by a job is rethrown here.
+  void parallel_for(std::size_t count, Job const& job);
+
+ private:
+  void worker_main(std::size_t thread_idx);
+  void run_jobs(std::size_t thread_idx);
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable work_done_;
+  Job const* job_ = nullptr;
+  std::size_t job_count_ = 0;
+  std::atomic<std::size_t> next_job_ = 0;
+  std::size_t active_workers_ = 0;
+  std::uint64_t generation_ = 0;
+  bool stop_ = false;
+  std::exception_ptr exception_;
+};
+
+} // namespace rndrx
+
+#endif // RNDRX_THREADPOOL_HPP_
@@ -16,6 +16,11 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <span>
 #include <vulkan/vulkan_raii.hpp>
 #include "composite_render_pass.hpp"
@@ -35,13 +40,59 @@ class Device;
 class Swapchain;
 class ShaderCache;
 class Renderer;
+class FrameTimeline;
+struct OffscreenReadback;
+
+struct ApplicationConfig {
+  // Renders into offscreen images without a window, surface or swapchain,
+  // for machines without a display.
+  bool headless = false;
+  vk::Extent2D headless_extent = vk::Extent2D(1920, 1080);
+  // Copies each headless frame back to host memory.
+  bool readback = false;
+  // Exits after this many frames. 0 runs until the window is closed.
+  std::uint64_t max_frames = 0;
+  // Records and submits each frame on a render thread while the main
+  // thread updates the next one.
+  bool pipelined_rendering = false;
+  PresentMode present_mode = PresentMode::Mailbox;
+  // Caps the frame rate with a CPU wait before each frame. 0 for no cap.
+  double max_fps = 0;
+  // Waits for a free frame before sampling input instead of after, so the
+  // input is as fresh as possible when the frame is recorded.
+  bool low_latency = false;
+  // Threads recording frame graph nodes, counting the rendering thread.
+  // 0 uses one per hardware thread, 1 records everything inline.
+  std::uint32_t recording_threads = 0;
+  // Times the renderer's frame graph nodes on the GPU. The timings are
+  // shown in the UI unless rendering is pipelined, and logged when the
+  // renderer is destroyed.
+  bool profile_frame_graphs = false;
+};
+
+// Everything rendering a frame needs from its update. Made on the update
+// thread and never modified once handed to the render thread.
+struct FrameSnapshot {
+  std::uint64_t frame_number = 0;
+  float dt_s = 0;
+  // The window's framebuffer size, sampled on the main thread as GLFW
+  // can't be called from the render thread.
+  vk::Rect2D extents;
+  // The window changed size since the previous snapshot.
+  bool resized = false;
+  // When the input the update used was sampled.
+  std::chrono::steady_clock::time_point input_time;
+  // The UI built by the update, empty when headless.
+  std::shared_ptr<ImGuiFrame const> ui;
+};
 
 class Application : noncopyable {
  public:
-  Application();
+  explicit Application(ApplicationConfig const& config = ApplicationConfig());
   ~Application();
 
   std::uint32_t find_graphics_queue_family_idx() const;
+  std::uint32_t find_compute_queue_family_idx() const;
   std::uint32_t find_transfer_queue_family_idx() const;
   std::vector<char const*> get_required_instance_extensions() const;
   std::vector<char const*> get_required_device_extensions() const;
@@ -68,8 +119,44 @@ class Application : noncopyable {
     return selected_device_idx_;
   }
 
+  ApplicationConfig const& config() const {
+    return config_;
+  }
+
+  bool is_headless() const {
+    return config_.headless;
+  }
+
   Window const& window() const {
-    return window_;
+    RNDRX_ASSERT(window_.has_value());
+    return *window_;
+  }
+
+  Window& window() {
+    RNDRX_ASSERT(window_.has_value());
+    return *window_;
+  }
+
+  // How many frames the CPU may record ahead of the GPU. Takes effect
+  // the next time the renderer is created.
+  void set_frames_in_flight(std::uint32_t count) {
+    RNDRX_ASSERT(count > 0);
+    frames_in_flight_ = count;
+  }
+
+  std::uint32_t frames_in_flight() const {
+    return frames_in_flight_;
+  }
+
+  // Time from sampling input for a frame to handing the frame to the
+  // presentation engine, for the latest frame and as a moving average.
+  // Time spent queued for display and scanout isn't included.
+  double input_latency_ms() const {
+    return input_latency_ms_.load(std::memory_order_relaxed);
+  }
+
+  double average_input_latency_ms() const {
+    return average_input_latency_ms_.load(std::memory_order_relaxed);
   }
 
   void run();
@@ -86,10 +173,14 @@ class Application : noncopyable {
   bool check_validation_layer_support();
 
   void main_loop();
+  bool should_exit(std::uint64_t frame_count) const;
+  vk::Rect2D render_extents() const;
+  void poll_readbacks(FrameTimeline const& timeline);
+  void record_input_latency(FrameSnapshot const& snapshot);
   void initialise_device_resources(SubmissionContext& ctx);
   void update(float dt_s);
   void update_adapter_info(float dt_s);
-  void render(SubmissionContext& ctx);
+  void render(SubmissionContext& ctx, FrameSnapshot const& snapshot);
   void present(PresentationContext& ctx);
 
   void on_pre_create_renderer();
@@ -103,6 +194,7 @@ class Application : noncopyable {
   void on_end_render(SubmissionContext&);
   void on_pre_present(SubmissionContext&, PresentationContext&);
   void on_post_present(PresentationContext&);
+  void on_readback(OffscreenReadback const&);
   void on_end_frame();
   void on_pre_destroy_renderer();
   void on_renderer_destroyed();
@@ -123,9 +215,15 @@ class Application : noncopyable {
     DeviceObjectsDestroyed,
   };
 
-  Window window_;
+  ApplicationConfig config_;
+  // Empty when headless.
+  std::optional<Window> window_;
   vk::raii::Instance instance_ = nullptr;
   int selected_device_idx_;
+  std::uint32_t frames_in_flight_ = 2;
+  // Written by whichever thread presents.
+  std::atomic<double> input_latency_ms_ = 0;
+  std::atomic<double> average_input_latency_ms_ = 0;
   vk::raii::Context vk_context_;
   vk::raii::DebugUtilsMessengerEXT messenger_ = nullptr;
   vk::raii::SurfaceKHR surface_ = nullptr;
@@ -133,6 +231,8 @@ class Application : noncopyable {
   RunStatus run_status_ = RunStatus::NotRunning;
   RunResult run_result_ = RunResult::None;
   std::unique_ptr<Renderer> renderer_;
+  // Built by the update and moved into the frame's snapshot.
+  std::shared_ptr<ImGuiFrame const> ui_frame_;
 };
 
 } // namespace rndrx::vulkan
@@ -16,6 +16,7 @@
 #pragma once
 
 #include <span>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_raii.hpp>
 #include "rndrx/noncopyable.hpp"
@@ -28,11 +29,13 @@ class RenderContext;
 class ShaderCache;
 class Device;
 
+// Blends its sources over its output, which is normally the swapchain
+// image imported into the frame graph, so nothing has to be copied to the
+// backbuffer afterwards.
 class CompositeRenderPass
     : public FrameGraphRenderPass
     , noncopyable {
  public:
-  class DrawItem;
   CompositeRenderPass() = default;
   CompositeRenderPass(
       Device const& device,
@@ -40,14 +43,20 @@ class CompositeRenderPass
       ShaderCache const& sc) {
     // create_render_pass(device, present_format);
     create_pipeline_layout(device);
-    create_pipeline(device, sc);
+    create_pipeline(device, present_format, sc);
   }
 
   RNDRX_DEFAULT_MOVABLE(CompositeRenderPass);
 
-  void pre_render(SubmissionContext& sc) override;
-  void render(SubmissionContext& sc) override;
-  void post_render(SubmissionContext& sc) override;
+  void pre_render(SubmissionContext& sc, vk::CommandBuffer cmd) override;
+  void render(SubmissionContext& sc, vk::CommandBuffer cmd) override;
+  void post_render(SubmissionContext& sc, vk::CommandBuffer cmd) override;
+
+  // The images to blend, in order. The composite node has to read them as
+  // sampled images so the graph moves them into a readable layout.
+  // Replacing earlier sources waits for the GPU to go idle, as frames in
+  // flight may still be reading through the old descriptor sets.
+  void set_sources(Device const& device, std::span<vk::ImageView const> sources);
 
   vk::raii::RenderPass const& render_pass() {
     return render_pass_;
@@ -56,40 +65,19 @@ class CompositeRenderPass
  private:
   // void create_render_pass(Device const& device, vk::Format present_format);
   void create_pipeline_layout(Device const& device);
-  void create_pipeline(Device const& device, ShaderCache const& sc);
+  void create_pipeline(
+      Device const& device,
+      vk::Format present_format,
+      ShaderCache const& sc);
 
   vk::raii::Sampler sampler_ = nullptr;
   vk::raii::DescriptorSetLayout descriptor_layout_ = nullptr;
   vk::raii::PipelineLayout pipeline_layout_ = nullptr;
   vk::raii::RenderPass render_pass_ = nullptr;
   vk::raii::Pipeline copy_image_pipeline_ = nullptr;
+  std::vector<vk::raii::DescriptorSet> source_sets_;
 };
 
-// class CompositeRenderPass::DrawItem : rndrx::noncopyable {
-//  public:
-//   DrawItem() {
-//   }
-//   DrawItem(Device& device, CompositeRenderPass const& parent_pass,
-//   vk::ImageView source) {
-//     create_descriptor_set(device, parent_pass);
-//     update_descriptor_set(device, parent_pass, source);
-//   }
-
-//   DrawItem(DrawItem&&) = default;
-//   DrawItem& operator=(DrawItem&&) = default;
-
-//   void draw(CompositeRenderPass const& pass, SubmissionContext& sc);
-
-//  private:
-//   void create_descriptor_set(Device& device, CompositeRenderPass const&
-//   parent_pass); void update_descriptor_set(
-//       Device& device,
-//       CompositeRenderPass const& parent_pass,
-//       vk::ImageView source);
-
-//   vk::raii::DescriptorSet descriptor_set_ = nullptr;
-// };
-
 } // namespace rndrx::vulkan
 
 #endif // RNDRX_VULKAN_PRESENTRENDERPASS_HPP_
\ No newline at end of file
@@ -21,6 +21,7 @@
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_raii.hpp>
 #include "rndrx/noncopyable.hpp"
+#include "upload_queue.hpp"
 #include "vma/allocator.hpp"
 // #include "rndrx/vulkan/shader_cache.hpp"
 
@@ -30,6 +31,13 @@ class Application;
 
 namespace rndrx::vulkan {
 
+// The queues work can be submitted to. Compute may alias the graphics
+// queue when the device has no separate compute family.
+enum class QueueType {
+  Graphics,
+  Compute,
+};
+
 class Device : noncopyable {
  public:
   Device() = default;
@@ -71,6 +79,40 @@ class Device : noncopyable {
                          .front());
   }
 
+  std::uint32_t compute_queue_family_idx() const {
+    return queue_family_indices_.compute;
+  }
+
+  vk::raii::Queue& compute_queue() {
+    return compute_queue_;
+  }
+
+  // True when compute work can run concurrently with graphics work
+  // on a queue from a different family.
+  bool has_async_compute() const {
+    return queue_family_indices_.compute != queue_family_indices_.graphics;
+  }
+
+  // Whether the pipelineStatisticsQuery feature was enabled.
+  bool has_pipeline_statistics_query() const {
+    return pipeline_statistics_query_;
+  }
+
+  // Whether a memory type can back transient attachments lazily, which
+  // mostly applies to tiled GPUs.
+  bool has_lazily_allocated_memory() const {
+    return lazily_allocated_memory_;
+  }
+
+  std::uint32_t queue_family_idx(QueueType queue) const {
+    return queue == QueueType::Compute ? compute_queue_family_idx()
+                                       : graphics_queue_family_idx();
+  }
+
+  vk::raii::Queue& queue(QueueType queue) {
+    return queue == QueueType::Compute ? compute_queue() : graphics_queue();
+  }
+
   std::uint32_t transfer_queue_family_idx() const {
     return queue_family_indices_.graphics;
   }
@@ -96,6 +138,11 @@ class Device : noncopyable {
     return allocator_;
   }
 
+  // Stages and batches copies from the host into device resources.
+  UploadQueue& upload_queue() {
+    return upload_queue_;
+  }
+
   // ShaderCache& shader_cache() {
   //   return shaders_;
   // }
@@ -107,6 +154,7 @@ class Device : noncopyable {
 
   vk::raii::Device device_ = nullptr;
   vk::raii::Queue graphics_queue_ = nullptr;
+  vk::raii::Queue compute_queue_ = nullptr;
   vk::raii::Queue transfer_queue_ = nullptr;
   vk::raii::CommandPool graphics_command_pool_ = 0;
   vk::raii::CommandPool transfer_command_pool_ = 0;
@@ -116,10 +164,15 @@ class Device : noncopyable {
 
   struct {
     std::uint32_t graphics = 0;
+    std::uint32_t compute = 0;
     std::uint32_t transfer = 0;
   } queue_family_indices_;
 
   vma::Allocator allocator_ = nullptr;
+  bool pipeline_statistics_query_ = false;
+  bool lazily_allocated_memory_ = false;
+  // Declared last, it uses the allocator and the device.
+  UploadQueue upload_queue_;
 };
 
 } // namespace rndrx::vulkan
@@ -15,12 +15,14 @@
 #define RNDRX_VULKAN_FORMATS_HPP_
 #pragma once
 
+#include <cstddef>
+#include <optional>
 #include <vulkan/vulkan_enums.hpp>
 #include "rndrx/assert.hpp"
 #include "rndrx/formats.hpp"
 
 namespace rndrx::vulkan {
-vk::Format to_vulkan_format(ImageFormat format) {
+inline vk::Format to_vulkan_format(ImageFormat format) {
   switch(format) {
     case ImageFormat::Undefined:
       return vk::Format::eUndefined;
@@ -631,5 +633,19 @@ vk::Format to_vulkan_format(ImageFormat format) {
   }
 
 }
+
+// For describing images created elsewhere, like the swapchain's.
+inline std::optional<ImageFormat> from_vulkan_format(vk::Format format) {
+  constexpr std::size_t kNumFormats =
+      static_cast<std::size_t>(ImageFormat::R12X4UnormPack16KHR) + 1;
+  for(std::size_t i = 0; i < kNumFormats; ++i) {
+    auto const candidate = static_cast<ImageFormat>(i);
+    if(to_vulkan_format(candidate) == format) {
+      return candidate;
+    }
+  }
+
+  return std::nullopt;
+}
 } // namespace rndrx::vulkan
 #endif // RNDRX_VULKAN_FORMATS_HPP_
\ No newline at end of file
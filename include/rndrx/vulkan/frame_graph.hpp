@@ -16,14 +16,26 @@
 #include "rndrx/vulkan/submission_context.hpp"
 #pragma once
 
-#include <type_traits>
-#include <unordered_set>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
 #include <variant>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_handles.hpp>
 #include <vulkan/vulkan_raii.hpp>
 #include "glm/vec4.hpp"
+#include "rndrx/assert.hpp"
+#include "rndrx/frame_graph_description.hpp"
 #include "rndrx/noncopyable.hpp"
+#include "rndrx/vulkan/device.hpp"
+#include "rndrx/vulkan/frame_graph_profiler.hpp"
+#include "rndrx/vulkan/frame_graph_resource_pool.hpp"
+#include "rndrx/vulkan/transient_buffer_allocator.hpp"
+#include "rndrx/vulkan/vma/allocation.hpp"
 #include "rndrx/vulkan/vma/buffer.hpp"
 #include "rndrx/vulkan/vma/image.hpp"
 
@@ -31,6 +43,7 @@ namespace rndrx {
 class FrameGraphAttachmentOutputDescription;
 class FrameGraphBufferDescription;
 class FrameGraphDescription;
+class ThreadPool;
 } // namespace rndrx
 
 namespace rndrx::vulkan {
@@ -38,44 +51,187 @@ namespace rndrx::vulkan {
 class Device;
 class FrameGraphBuilder;
 class FrameGraphNode;
+class FrameGraphPhysicalPass;
 class FrameGraph;
 class SubmissionContext;
 
+// Indices into a compiled graph's node and resource tables. Nodes are
+// stored in execution order so a node's handle is also its position in
+// the schedule.
+enum class FrameGraphNodeHandle : std::uint32_t {};
+enum class FrameGraphResourceHandle : std::uint32_t {};
+
+constexpr std::size_t index(FrameGraphNodeHandle handle) {
+  return static_cast<std::size_t>(handle);
+}
+
+constexpr std::size_t index(FrameGraphResourceHandle handle) {
+  return static_cast<std::size_t>(handle);
+}
+
+// How a node accesses one of its resources.
+enum class FrameGraphResourceUsage {
+  InputAttachment,
+  SampledImage,
+  ColourAttachment,
+  DepthStencilAttachment,
+  StorageImage,
+  BufferRead,
+  BufferWrite,
+};
+
+// The synchronisation state of a resource at some point in the graph.
+struct FrameGraphResourceState {
+  vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+  vk::PipelineStageFlags2 stages = vk::PipelineStageFlagBits2::eNone;
+  vk::AccessFlags2 access = vk::AccessFlagBits2::eNone;
+};
+
+// A single transition of a resource that must be recorded before a node.
+struct FrameGraphBarrier {
+  FrameGraphResourceHandle resource = {};
+  FrameGraphResourceState src;
+  FrameGraphResourceState dst;
+  // The previous contents are dead so the image can be transitioned from
+  // an undefined layout.
+  bool discard = false;
+  // Set on both halves of a queue family ownership transfer.
+  std::uint32_t src_queue_family = VK_QUEUE_FAMILY_IGNORED;
+  std::uint32_t dst_queue_family = VK_QUEUE_FAMILY_IGNORED;
+  // The source state is where the previous frame left the resource.
+  bool across_frames = false;
+};
+
+// An image owned outside of the graph, handed to it for a single frame
+// with FrameGraph::import_image().
+struct FrameGraphImportedImage {
+  vk::Image image;
+  vk::ImageView view;
+  // Waited on before the graph first touches the image, e.g. the swapchain
+  // acquire semaphore. Optional.
+  vk::Semaphore acquire_semaphore;
+  // Signalled once the graph has finished with the image, e.g. for the
+  // present to wait on. Optional.
+  vk::Semaphore release_semaphore;
+  // Where the graph leaves the image at the end of the frame.
+  vk::ImageLayout final_layout = vk::ImageLayout::ePresentSrcKHR;
+  // The first use of the image recorded after the graph in the same
+  // submission, e.g. a copy. None when the release semaphore is what
+  // hands the image on.
+  vk::PipelineStageFlags2 final_stages = vk::PipelineStageFlagBits2::eNone;
+  vk::AccessFlags2 final_access = vk::AccessFlagBits2::eNone;
+};
+
+// Interface to the implementation of a graph node. Commands must be
+// recorded into cmd rather than the submission context's command buffer;
+// when the graph records in parallel cmd is a secondary command buffer
+// private to the node and the calls may happen on a worker thread.
 class FrameGraphRenderPass {
  public:
-  virtual void pre_render(SubmissionContext& sc) = 0;
-  virtual void render(SubmissionContext& sc) = 0;
-  virtual void post_render(SubmissionContext& sc) = 0;
+  virtual void pre_render(SubmissionContext& sc, vk::CommandBuffer cmd) = 0;
+  virtual void render(SubmissionContext& sc, vk::CommandBuffer cmd) = 0;
+  virtual void post_render(SubmissionContext& sc, vk::CommandBuffer cmd) = 0;
 };
 
 class FrameGraphAttachment : noncopyable {
  public:
   FrameGraphAttachment(
       Device& device,
-      FrameGraphAttachmentOutputDescription const& description);
+      FrameGraphAttachmentOutputDescription const& description,
+      vk::Extent2D extent,
+      vk::ImageUsageFlags usage);
+  FrameGraphAttachment(
+      Device& device,
+      FrameGraphAttachmentOutputDescription const& description,
+      vk::Extent2D extent,
+      vk::ImageUsageFlags usage,
+      vma::Allocation const& memory,
+      vk::DeviceSize offset);
+  // An imported attachment; there's no image until import() is called.
+  FrameGraphAttachment(
+      FrameGraphAttachmentOutputDescription const& description,
+      vk::Extent2D extent,
+      vk::ImageUsageFlags usage);
+
+  static vk::ImageCreateInfo image_create_info(
+      FrameGraphAttachmentOutputDescription const& description,
+      vk::Extent2D extent,
+      vk::ImageUsageFlags usage);
+
+  // Takes the load op and clear values from description, which don't
+  // affect the image itself.
+  void set_load_state(FrameGraphAttachmentOutputDescription const& description);
 
   vma::Image const& image() const;
   vk::raii::ImageView const& image_view() const;
+  // The image and view, whether owned or imported.
+  vk::Image vk_image() const;
+  vk::ImageView vk_image_view() const;
   vk::Format format() const;
   int width() const;
   int height() const;
+  vk::ImageUsageFlags usage() const;
   vk::AttachmentLoadOp load_op() const;
   glm::vec4 clear_colour() const;
   float clear_depth() const;
   int clear_stencil() const;
+  vk::ImageAspectFlags aspect_mask() const;
+
+  // Index of the transient memory block the image is placed in.
+  // Attachments in the same block may alias each other.
+  std::size_t memory_block() const {
+    return memory_block_;
+  }
+
+  void set_memory_block(std::size_t block) {
+    memory_block_ = block;
+  }
+
+  static constexpr std::size_t kDedicatedMemory = ~std::size_t(0);
+
+  bool is_imported() const {
+    return imported_;
+  }
+
+  void import(vk::Image image, vk::ImageView view) {
+    RNDRX_ASSERT(imported_);
+    imported_image_ = image;
+    imported_view_ = view;
+  }
 
  private:
+  void create_image_view(
+      Device& device,
+      FrameGraphAttachmentOutputDescription const& description,
+      vk::Extent2D extent);
+
   vma::Image image_ = nullptr;
   vk::raii::ImageView image_view_ = nullptr;
   vk::Format format_ = vk::Format::eUndefined;
   int width_ = 0;
   int height_ = 0;
+  vk::ImageUsageFlags usage_;
   vk::AttachmentLoadOp load_op_ = vk::AttachmentLoadOp::eDontCare;
   glm::vec4 clear_colour_;
   float clear_depth_ = 0.f;
   int clear_stencil_ = 0;
+  std::size_t memory_block_ = kDedicatedMemory;
+  bool imported_ = false;
+  vk::Image imported_image_;
+  vk::ImageView imported_view_;
 };
 
+// The state a resource needs to be in for a node to use it. shader_stages
+// are the stages of the node that sample images.
+FrameGraphResourceState required_state(
+    FrameGraphResourceUsage usage,
+    FrameGraphAttachment const* attachment,
+    vk::PipelineStageFlags2 shader_stages);
+vk::ImageUsageFlags image_usage(FrameGraphResourceUsage usage);
+vk::ClearValue clear_value(
+    FrameGraphResourceUsage usage,
+    FrameGraphAttachment const* attachment);
+
 // class FrameGraphImage {
 //  public:
 //   vk::Image image() const {
@@ -86,20 +242,48 @@ class FrameGraphAttachment : noncopyable {
 //   vk::Image image_;
 // };
 
+// A buffer that lives for one frame. Its memory comes from the submission
+// context's transient allocator, so where it lives changes every frame and
+// is only valid while the graph is rendering.
 class FrameGraphBuffer : noncopyable {
  public:
-  FrameGraphBuffer(Device& device, FrameGraphBufferDescription const& description);
-  vma::Buffer const& buffer() const {
+  explicit FrameGraphBuffer(FrameGraphBufferDescription const& description);
+
+  void bind(TransientBufferAllocator::Allocation const& allocation) {
+    buffer_ = allocation.buffer;
+    offset_ = allocation.offset;
+  }
+
+  vk::Buffer vk_buffer() const {
     return buffer_;
   }
 
+  vk::DeviceSize offset() const {
+    return offset_;
+  }
+
+  vk::DeviceSize size() const {
+    return size_;
+  }
+
+  vk::BufferUsageFlags usage() const {
+    return usage_;
+  }
+
+  vk::DescriptorBufferInfo descriptor_info() const {
+    return vk::DescriptorBufferInfo(buffer_, offset_, size_);
+  }
+
  private:
-  vma::Buffer buffer_ = nullptr;
+  vk::Buffer buffer_;
+  vk::DeviceSize offset_ = 0;
+  vk::DeviceSize size_ = 0;
+  vk::BufferUsageFlags usage_;
 };
 
 class FrameGraphResource : noncopyable {
  public:
-  FrameGraphResource(std::string name, FrameGraphNode* producer)
+  FrameGraphResource(std::string name, FrameGraphNodeHandle producer)
       : name_(std::move(name))
       , producer_(producer) {
   }
@@ -108,14 +292,66 @@ class FrameGraphResource : noncopyable {
     return name_;
   }
 
-  FrameGraphNode* producer() const {
+  FrameGraphNodeHandle producer() const {
     return producer_;
   }
 
+  void set_producer(FrameGraphNodeHandle producer) {
+    producer_ = producer;
+  }
+
   void set_render_resource(FrameGraphAttachment* attachment);
   void set_render_resource(FrameGraphBuffer* buffer);
 
   FrameGraphAttachment* get_attachment() const;
+  FrameGraphBuffer* get_buffer() const;
+
+  // History resources alternate between two images every frame. The graph
+  // has a resource for each role, linked to each other: the one written
+  // this frame and the one holding the previous frame's contents.
+  void set_history(FrameGraphResourceHandle other, bool previous_frame) {
+    history_ = other;
+    previous_frame_ = previous_frame;
+  }
+
+  std::optional<FrameGraphResourceHandle> history() const {
+    return history_;
+  }
+
+  bool is_previous_frame() const {
+    return previous_frame_;
+  }
+
+  // Backed by an image handed to the graph every frame.
+  void set_imported(bool imported) {
+    imported_ = imported;
+  }
+
+  bool is_imported() const {
+    return imported_;
+  }
+
+  void set_history_attachments(
+      FrameGraphAttachment* even_frames,
+      FrameGraphAttachment* odd_frames);
+  // Points get_attachment() at the image for frames of the given parity.
+  void select_history(std::size_t parity);
+  FrameGraphAttachment* get_attachment(std::size_t parity) const;
+
+  // Index into the sorted node list of the first and last node
+  // that touch this resource.
+  void set_lifetime(int first_use, int last_use) {
+    first_use_ = first_use;
+    last_use_ = last_use;
+  }
+
+  int first_use() const {
+    return first_use_;
+  }
+
+  int last_use() const {
+    return last_use_;
+  }
 
  private:
   std::variant< //
@@ -124,41 +360,121 @@ class FrameGraphResource : noncopyable {
       FrameGraphBuffer*>
       render_resource_ = nullptr;
 
-  FrameGraphNode* producer_ = nullptr;
+  std::array<FrameGraphAttachment*, 2> history_attachments_ = {};
+  std::optional<FrameGraphResourceHandle> history_;
+  bool previous_frame_ = false;
+  bool imported_ = false;
+  FrameGraphNodeHandle producer_ = {};
   std::string name_;
+  int first_use_ = 0;
+  int last_use_ = 0;
 };
 
 class FrameGraphNode : noncopyable {
  public:
-  FrameGraphNode(std::string name, FrameGraphRenderPass* render_pass);
-
-  void create_vk_render_pass(Device& device);
+  FrameGraphNode(
+      std::string name,
+      FrameGraphRenderPass* render_pass,
+      bool is_compute,
+      QueueType queue);
 
+  // The spans point into tables owned by the graph.
   void set_resources(
-      std::vector<FrameGraphResource const*> inputs,
-      std::vector<FrameGraphResource const*> outputs);
+      std::span<FrameGraphResourceHandle const> inputs,
+      std::span<FrameGraphResourceUsage const> input_usages,
+      std::span<FrameGraphResourceHandle const> outputs,
+      std::span<FrameGraphResourceUsage const> output_usages);
+
+  void set_dependents(std::span<FrameGraphNodeHandle const> dependents) {
+    dependents_ = dependents;
+  }
 
-  void add_dependent(FrameGraphNode* node) {
-    dependents_.push_back(node);
+  void set_barriers(std::vector<FrameGraphBarrier> barriers) {
+    barriers_ = std::move(barriers);
+  }
+
+  void add_release_barrier(FrameGraphBarrier const& barrier) {
+    release_barriers_.push_back(barrier);
+  }
+
+  void clear_release_barriers() {
+    release_barriers_.clear();
   }
 
   FrameGraphRenderPass* render_pass() const {
     return render_pass_;
   }
 
-  vk::RenderPass vk_render_pass() const {
-    return *vk_render_pass_;
+  // Compute nodes dispatch outside of a render pass.
+  bool is_compute() const {
+    return is_compute_;
+  }
+
+  QueueType queue() const {
+    return queue_;
+  }
+
+  // The shader stages that may read the node's sampled images: the vertex
+  // and fragment stages of graphics nodes, as a pass can sample in either.
+  vk::PipelineStageFlags2 shader_stages() const;
+
+  // The render pass this node is a subpass of. Null for compute nodes.
+  FrameGraphPhysicalPass const* physical_pass() const {
+    return physical_pass_;
+  }
+
+  std::uint32_t subpass() const {
+    return subpass_;
+  }
+
+  void set_physical_pass(
+      FrameGraphPhysicalPass const* pass,
+      std::uint32_t subpass) {
+    physical_pass_ = pass;
+    subpass_ = subpass;
   }
 
-  std::span<FrameGraphResource const* const> inputs() const {
+  // Size of the node's attachments.
+  vk::Extent2D extent() const {
+    return extent_;
+  }
+
+  void set_extent(vk::Extent2D extent) {
+    extent_ = extent;
+  }
+
+  std::span<FrameGraphResourceHandle const> inputs() const {
     return inputs_;
   }
 
-  std::span<FrameGraphResource const* const> outputs() const {
+  std::span<FrameGraphResourceUsage const> input_usages() const {
+    return input_usages_;
+  }
+
+  std::span<FrameGraphResourceHandle const> outputs() const {
     return outputs_;
   }
 
-  std::span<FrameGraphNode* const> dependents() const {
+  std::span<FrameGraphResourceUsage const> output_usages() const {
+    return output_usages_;
+  }
+
+  FrameGraphResourceUsage output_usage(std::size_t idx) const {
+    return output_usages_[idx];
+  }
+
+  // Barriers that need to be recorded before this node.
+  std::span<FrameGraphBarrier const> barriers() const {
+    return barriers_;
+  }
+
+  // Ownership releases to other queues, recorded after this node.
+  std::span<FrameGraphBarrier const> release_barriers() const {
+    return release_barriers_;
+  }
+
+  // Nodes that read one of this node's outputs.
+  std::span<FrameGraphNodeHandle const> dependents() const {
     return dependents_;
   }
 
@@ -167,13 +483,143 @@ class FrameGraphNode : noncopyable {
   }
 
  private:
-  vk::raii::RenderPass vk_render_pass_ = nullptr;
-  vk::raii::Framebuffer vk_frame_buffer_ = nullptr;
+  FrameGraphPhysicalPass const* physical_pass_ = nullptr;
+  std::uint32_t subpass_ = 0;
+  vk::Extent2D extent_;
   FrameGraphRenderPass* render_pass_ = nullptr;
-  std::vector<FrameGraphResource const*> inputs_;
-  std::vector<FrameGraphResource const*> outputs_;
-  std::vector<FrameGraphNode*> dependents_;
+  std::span<FrameGraphResourceHandle const> inputs_;
+  std::span<FrameGraphResourceUsage const> input_usages_;
+  std::span<FrameGraphResourceHandle const> outputs_;
+  std::span<FrameGraphResourceUsage const> output_usages_;
+  std::span<FrameGraphNodeHandle const> dependents_;
+  std::vector<FrameGraphBarrier> barriers_;
+  std::vector<FrameGraphBarrier> release_barriers_;
   std::string name_;
+  bool is_compute_ = false;
+  QueueType queue_ = QueueType::Graphics;
+};
+
+// A chain of graphics nodes recorded as the subpasses of a single render
+// pass. Nodes are merged when they read earlier nodes' outputs as input
+// attachments, which lets those attachments stay in tile memory.
+//
+// With dynamic rendering there are no render pass objects and each pass
+// holds a single node.
+class FrameGraphPhysicalPass : noncopyable {
+ public:
+  FrameGraphPhysicalPass(
+      std::size_t first_node,
+      std::vector<FrameGraphNode*> nodes);
+
+  // Resources flagged in internal_resources are dead once this pass ends
+  // so they aren't stored to memory.
+  void create_vk_render_pass(
+      Device& device,
+      std::span<FrameGraphResource const> resources,
+      std::vector<bool> const& internal_resources);
+  void create_rendering_info(
+      std::span<FrameGraphResource const> resources,
+      std::vector<bool> const& internal_resources);
+
+  bool dynamic_rendering() const {
+    return dynamic_rendering_;
+  }
+
+  // Attachment formats to create the pass's pipelines against when using
+  // dynamic rendering. Points into the pass so must not outlive it.
+  vk::PipelineRenderingCreateInfo pipeline_rendering_create_info() const;
+
+  std::span<vk::Format const> colour_formats() const {
+    return colour_formats_;
+  }
+
+  vk::Format depth_format() const {
+    return depth_format_;
+  }
+
+  vk::Format stencil_format() const {
+    return stencil_format_;
+  }
+
+  // Passes writing history resources have a set of attachments for each
+  // frame parity.
+  void begin(
+      vk::CommandBuffer cmd,
+      vk::SubpassContents contents,
+      std::size_t parity) const;
+  void next_subpass(vk::CommandBuffer cmd, vk::SubpassContents contents) const;
+  void end(vk::CommandBuffer cmd) const;
+
+  // Whether any of the pass's attachments are imported.
+  bool has_imported_attachments() const {
+    return !imported_slots_.empty();
+  }
+
+  // Points the pass at the images currently imported into its attachments.
+  // Render passes need a framebuffer for each set of images; those are
+  // created on first use and kept until the pass is recreated or
+  // release_imported_framebuffers() is called.
+  void bind_imported_attachments(Device& device, std::size_t parity);
+  void release_imported_framebuffers();
+
+  // Index of the first node in the graph's sorted order; the rest follow
+  // it directly.
+  std::size_t first_node() const {
+    return first_node_;
+  }
+
+  std::span<FrameGraphNode* const> nodes() const {
+    return nodes_;
+  }
+
+  vk::RenderPass vk_render_pass() const {
+    return *vk_render_pass_;
+  }
+
+  vk::Framebuffer vk_frame_buffer(std::size_t parity) const {
+    if(has_imported_attachments()) {
+      return imported_frame_buffer_;
+    }
+
+    return *vk_frame_buffers_[has_history_ ? parity : 0];
+  }
+
+  vk::Extent2D extent() const {
+    return extent_;
+  }
+
+ private:
+  std::size_t first_node_ = 0;
+  std::vector<FrameGraphNode*> nodes_;
+  vk::raii::RenderPass vk_render_pass_ = nullptr;
+  std::array<vk::raii::Framebuffer, 2> vk_frame_buffers_ = {nullptr, nullptr};
+  bool has_history_ = false;
+  vk::Extent2D extent_;
+  std::vector<vk::ClearValue> clear_values_;
+  bool dynamic_rendering_ = false;
+  std::array<std::vector<vk::RenderingAttachmentInfo>, 2> colour_attachments_;
+  std::array<vk::RenderingAttachmentInfo, 2> depth_stencil_attachments_;
+  std::vector<vk::Format> colour_formats_;
+  vk::Format depth_format_ = vk::Format::eUndefined;
+  vk::Format stencil_format_ = vk::Format::eUndefined;
+
+  // Where the views of imported attachments go, as an index into the
+  // framebuffer's attachments or the colour attachment infos.
+  struct ImportedSlot {
+    FrameGraphAttachment const* attachment = nullptr;
+    std::uint32_t index = 0;
+    bool depth_stencil = false;
+  };
+
+  struct ImportedFramebuffer {
+    std::vector<vk::ImageView> views;
+    vk::raii::Framebuffer framebuffer = nullptr;
+  };
+
+  std::vector<ImportedSlot> imported_slots_;
+  std::array<std::vector<vk::ImageView>, 2> framebuffer_views_;
+  std::vector<ImportedFramebuffer> imported_frame_buffers_;
+  vk::Framebuffer imported_frame_buffer_;
 };
 
 class FrameGraph : noncopyable {
@@ -181,76 +627,220 @@ class FrameGraph : noncopyable {
   FrameGraph() = default;
   FrameGraph(FrameGraphBuilder const& builder, FrameGraphDescription const& description);
   void render(SubmissionContext& sc);
-  FrameGraphNode* find_node(std::string_view name);
 
- private:
-  void parse_description(
+  // Recompiles the graph for a new description or output extent. When
+  // passes, resources and sinks are unchanged only the attachments whose
+  // format or extent changed are recreated, along with the render passes
+  // using them; anything else rebuilds the graph from scratch. Pipelines
+  // created against a pass stay compatible unless its formats change.
+  // The GPU must have finished with the graph.
+  void update(
       FrameGraphBuilder const& builder,
       FrameGraphDescription const& description);
-  void build_edges();
-  void sort_nodes();
-  void allocate_graphics_resources(Device& device, FrameGraphDescription const& description);
 
-  FrameGraphResource* find_resource(std::string_view name);
+  vk::Extent2D output_extent() const {
+    return output_extent_;
+  }
 
-  // Custom hashers and comparers so we can use the name
-  // field in the object itself. Saves a bunch of conversions
-  // and some memory. The consequence of this is that the set value
-  // type in const (to avoid corrupting the data structure), so we
-  // need to const cast to get mutable types out of the sets.
-  struct HashName {
-    using is_transparent = std::true_type;
+  // Hands the graph this frame's image for an attachment described as
+  // imported. Every imported attachment needs an image before each call
+  // to render(). The graph waits on the acquire semaphore before its first
+  // use of the image and, in the caller's final submission, transitions
+  // it to the final layout and signals the release semaphore.
+  void import_image(std::string_view name, FrameGraphImportedImage const& image);
 
-    std::size_t operator()(FrameGraphResource const& obj) const {
-      return std::hash<std::string_view>()(obj.name());
-    }
+  // Drops the framebuffers created for imported images, which must be done
+  // before their views are destroyed, e.g. when the swapchain is recreated.
+  // The GPU must have finished with the graph.
+  void release_imported_images();
 
-    std::size_t operator()(FrameGraphNode const& obj) const {
-      return std::hash<std::string_view>()(obj.name());
-    }
+  FrameGraphNode* find_node(std::string_view name);
+  // Null when there's no attachment by that name or it was culled. The
+  // attachment lives until the graph is rebuilt.
+  FrameGraphAttachment const* find_attachment(std::string_view name) const;
 
-    std::size_t operator()(std::string_view name) const {
-      return std::hash<std::string_view>()(name);
-    }
+  FrameGraphNode& node(FrameGraphNodeHandle handle) {
+    return nodes_[index(handle)];
+  }
 
-    std::size_t operator()(std::string const& name) const {
-      return std::hash<std::string_view>()(name);
-    }
+  FrameGraphResource const& resource(FrameGraphResourceHandle handle) const {
+    return resources_[index(handle)];
+  }
+
+  // In execution order.
+  std::span<FrameGraphNode const> nodes() const {
+    return nodes_;
+  }
+
+  struct TransientMemoryStats {
+    // Bytes required if every attachment had its own allocation.
+    vk::DeviceSize naive_bytes = 0;
+    // Bytes actually allocated after aliasing attachments with
+    // disjoint lifetimes.
+    vk::DeviceSize allocated_bytes = 0;
+    std::size_t num_attachments = 0;
+    std::size_t num_blocks = 0;
   };
 
-  struct EqualName {
-    using is_transparent = std::true_type;
+  TransientMemoryStats const& transient_memory_stats() const {
+    return transient_memory_stats_;
+  }
 
-    std::size_t operator()(FrameGraphResource const& a, FrameGraphResource const& b) const {
-      return a.name() == b.name();
-    }
+  // Null unless profiling was enabled on the builder. Compute nodes are
+  // timed including their pre and post render work, graphics nodes only
+  // across their subpass.
+  FrameGraphProfiler const* profiler() const {
+    return profiler_.get();
+  }
 
-    std::size_t operator()(FrameGraphResource const& obj, std::string_view name) const {
-      return obj.name() == name;
-    }
+ private:
+  void rebuild(
+      FrameGraphBuilder const& builder,
+      FrameGraphDescription const& description);
+  void parse_description(
+      FrameGraphBuilder const& builder,
+      FrameGraphDescription const& description);
+  std::vector<bool> cull_nodes(FrameGraphDescription const& description);
+  std::vector<FrameGraphNodeHandle> sort_nodes(
+      std::vector<bool> const& live) const;
+  void compact_nodes(std::span<FrameGraphNodeHandle const> order);
+  void build_edges();
+  void build_physical_passes();
+  void build_batches();
+  void compute_resource_lifetimes();
+  void allocate_graphics_resources(Device& device, FrameGraphDescription const& description);
+  void allocate_attachments(
+      Device& device,
+      std::vector<FrameGraphAttachmentOutputDescription const*> const& descriptions);
+  void update_transient_memory_stats();
+  FrameGraphResourcePool::Attachment acquire_attachment(
+      Device& device,
+      FrameGraphAttachmentOutputDescription const& description,
+      vk::Extent2D extent,
+      vk::ImageUsageFlags usage);
+  void build_barriers(Device& device);
+  void record_barriers(
+      vk::CommandBuffer cmd,
+      std::span<FrameGraphBarrier const> barriers);
+  std::vector<bool> find_pass_internal_resources() const;
+  void record_compute_node(
+      SubmissionContext& sc,
+      vk::CommandBuffer cmd,
+      std::size_t node_idx,
+      bool parallel);
+  void record_physical_pass(
+      SubmissionContext& sc,
+      vk::CommandBuffer cmd,
+      FrameGraphPhysicalPass const& pass,
+      bool parallel);
+  void record_node_secondaries(
+      SubmissionContext& sc,
+      std::size_t node_idx,
+      std::size_t thread_idx);
+  void begin_profiling(vk::CommandBuffer cmd, std::size_t node_idx) const;
+  void end_profiling(vk::CommandBuffer cmd, std::size_t node_idx) const;
+  void submit_batch(
+      SubmissionContext& sc,
+      std::size_t batch_idx,
+      std::uint64_t first_step);
+  void add_import_waits(
+      std::size_t batch_idx,
+      std::vector<vk::SemaphoreSubmitInfo>& waits) const;
+  void finish_imports(SubmissionContext& sc);
 
-    std::size_t operator()(std::string_view name, FrameGraphResource const& obj) const {
-      return name == obj.name();
-    }
+  FrameGraphResource* find_resource(std::string_view name);
 
-    std::size_t operator()(FrameGraphNode const& a, FrameGraphNode const& b) const {
-      return a.name() == b.name();
-    }
+  std::vector<FrameGraphNode> nodes_;
+  std::vector<FrameGraphResource> resources_;
+  // Backing storage for the nodes' resource and dependent spans.
+  std::vector<FrameGraphResourceHandle> node_inputs_;
+  std::vector<FrameGraphResourceUsage> node_input_usages_;
+  std::vector<FrameGraphResourceHandle> node_outputs_;
+  std::vector<FrameGraphResourceUsage> node_output_usages_;
+  std::vector<FrameGraphNodeHandle> node_dependents_;
+  // Node indices grouped by dependency level, where a node's level is one
+  // more than that of its deepest producer. Level i is the range
+  // [level_begins_[i], level_begins_[i + 1]) of level_nodes_.
+  std::vector<std::uint32_t> level_nodes_;
+  std::vector<std::size_t> level_begins_;
+  // Names are resolved once while compiling; the views point into the
+  // node and resource tables.
+  std::unordered_map<std::string_view, FrameGraphNodeHandle> node_names_;
+  std::unordered_map<std::string_view, FrameGraphResourceHandle>
+      resource_names_;
+  std::vector<std::unique_ptr<FrameGraphPhysicalPass>> physical_passes_;
+  std::vector<FrameGraphResourceHandle> sinks_;
+  Device* device_ = nullptr;
+  ThreadPool* thread_pool_ = nullptr;
+  FrameGraphResourcePool* resource_pool_ = nullptr;
+  bool dynamic_rendering_ = false;
+  vk::Extent2D output_extent_;
+  // What the graph was last compiled from, for update() to diff against.
+  FrameGraphDescription description_;
+
+  // A run of sorted nodes submitted together to one queue.
+  struct QueueBatch {
+    struct Wait {
+      std::size_t batch = 0;
+      vk::PipelineStageFlags2 stages;
+    };
+
+    QueueType queue = QueueType::Graphics;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    // Earlier batches of the same frame on the other queue.
+    std::vector<Wait> waits;
+  };
 
-    std::size_t operator()(FrameGraphNode const& obj, std::string_view name) const {
-      return obj.name() == name;
-    }
+  std::vector<QueueBatch> batches_;
+  // Batches are then submitted separately and ordered across the queues
+  // by steps of the frame on the SubmissionContext's timeline: batch i
+  // signals the frame's first reserved step plus i.
+  bool uses_compute_queue_ = false;
+  // Acquires returning sinks written on the compute queue to the graphics
+  // queue, recorded after the last batch, and the releases of those sinks
+  // needed by the compute queue at the start of the next frame.
+  std::vector<FrameGraphBarrier> tail_acquires_;
+  std::vector<FrameGraphBarrier> tail_releases_;
+
+  // An imported attachment and the image it has this frame.
+  struct ImportedAttachment {
+    FrameGraphResourceHandle resource = {};
+    std::unique_ptr<FrameGraphAttachment> attachment;
+    FrameGraphImportedImage image;
+    bool bound = false;
+    // The batch of the first node to touch the image and the stages it
+    // does so at, which is where the acquire semaphore is waited on.
+    std::size_t first_batch = 0;
+    vk::PipelineStageFlags2 first_stages;
+  };
 
-    std::size_t operator()(std::string_view name, FrameGraphNode const& obj) const {
-      return name == obj.name();
-    }
+  std::vector<ImportedAttachment> imports_;
+  // Moves each imported image from where the frame leaves it to its final
+  // layout, indexed like imports_.
+  std::vector<FrameGraphBarrier> import_releases_;
+
+  struct NodeCommands {
+    vk::CommandBuffer pre_render;
+    vk::CommandBuffer render;
+    vk::CommandBuffer post_render;
   };
 
-  std::unordered_set<FrameGraphResource, HashName, EqualName> resources_;
-  std::unordered_set<FrameGraphNode, HashName, EqualName> nodes_;
-  std::vector<FrameGraphNode*> sorted_nodes_;
-  std::vector<std::unique_ptr<FrameGraphAttachment>> attachments_;
+  // Secondaries recorded by the worker threads, indexed like nodes_.
+  std::vector<NodeCommands> node_commands_;
+  // Memory blocks shared by the attachments, must outlive them.
+  // Both go back to resource_pool_, if there is one, when released.
+  std::vector<FrameGraphResourcePool::Memory> transient_memory_;
+  std::vector<FrameGraphResourcePool::Attachment> attachments_;
   std::vector<std::unique_ptr<FrameGraphBuffer>> buffers_;
+  TransientMemoryStats transient_memory_stats_;
+  std::vector<vk::ImageMemoryBarrier2> image_barrier_scratch_;
+  std::vector<vk::BufferMemoryBarrier2> buffer_barrier_scratch_;
+  std::vector<vk::SemaphoreSubmitInfo> wait_scratch_;
+  std::unique_ptr<FrameGraphProfiler> profiler_;
+  // Picks which image of each history resource is written this frame.
+  std::size_t frame_parity_ = 0;
+  bool first_frame_ = true;
 };
 
 } // namespace rndrx::vulkan
@@ -15,25 +15,32 @@
 #define RNDRX_VULKAN_FRAMEGRAPHBUILDER_HPP_
 #pragma once
 
+#include <optional>
 #include <unordered_map>
+#include <vulkan/vulkan.hpp>
 #include "rndrx/config.hpp"
 #include "rndrx/frame_graph_description.hpp"
+#include "rndrx/vulkan/frame_graph_profiler.hpp"
 
 namespace rndrx {
 class FrameGraphDescription;
-}
+class ThreadPool;
+} // namespace rndrx
 
 namespace rndrx::vulkan {
 
 class FrameGraphRenderPass;
 class FrameGraph;
+class FrameGraphResourcePool;
 class Device;
 class Application;
 
 class FrameGraphBuilder {
  public:
-  explicit FrameGraphBuilder(Device& device)
-      : device_(device) {
+  // When a thread pool is provided the graph records its nodes in parallel.
+  explicit FrameGraphBuilder(Device& device, ThreadPool* thread_pool = nullptr)
+      : device_(device)
+      , thread_pool_(thread_pool) {
   }
 
   void register_pass(std::string_view name, FrameGraphRenderPass* pass);
@@ -43,8 +50,59 @@ class FrameGraphBuilder {
     return device_;
   }
 
+  ThreadPool* thread_pool() const {
+    return thread_pool_;
+  }
+
+  // Take attachments and memory from pool, which is shared with other
+  // graphs, instead of allocating them for this graph alone.
+  void set_resource_pool(FrameGraphResourcePool* pool) {
+    resource_pool_ = pool;
+  }
+
+  FrameGraphResourcePool* resource_pool() const {
+    return resource_pool_;
+  }
+
+  // Record graphics nodes with beginRendering instead of render pass and
+  // framebuffer objects. There are no subpasses in this mode so input
+  // attachments are read as sampled images and every node renders on its
+  // own; pipelines are created against the node's
+  // vk::PipelineRenderingCreateInfo.
+  void set_dynamic_rendering(bool enabled) {
+    dynamic_rendering_ = enabled;
+  }
+
+  bool dynamic_rendering() const {
+    return dynamic_rendering_;
+  }
+
+  // The extent output relative attachments are sized against, normally
+  // the swapchain's.
+  void set_output_extent(vk::Extent2D extent) {
+    output_extent_ = extent;
+  }
+
+  vk::Extent2D output_extent() const {
+    return output_extent_;
+  }
+
+  // Time each node on the GPU, see FrameGraph::profiler().
+  void enable_profiling(FrameGraphProfiler::Options const& options = {}) {
+    profiling_ = options;
+  }
+
+  std::optional<FrameGraphProfiler::Options> const& profiling() const {
+    return profiling_;
+  }
+
  private:
   Device& device_;
+  ThreadPool* thread_pool_ = nullptr;
+  FrameGraphResourcePool* resource_pool_ = nullptr;
+  bool dynamic_rendering_ = false;
+  vk::Extent2D output_extent_;
+  std::optional<FrameGraphProfiler::Options> profiling_;
   std::unordered_map<std::string_view, FrameGraphRenderPass*> render_pass_map_;
 };
 
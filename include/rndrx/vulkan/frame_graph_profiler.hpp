@@ -0,0 +1,134 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_VULKAN_FRAMEGRAPHPROFILER_HPP_
+#define RNDRX_VULKAN_FRAMEGRAPHPROFILER_HPP_
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include "rndrx/noncopyable.hpp"
+#include "rndrx/vulkan/device.hpp"
+
+namespace rndrx::vulkan {
+
+class FrameGraphNode;
+
+struct FrameGraphPipelineStatistics {
+  std::uint64_t input_assembly_vertices = 0;
+  std::uint64_t input_assembly_primitives = 0;
+  std::uint64_t vertex_shader_invocations = 0;
+  std::uint64_t clipping_primitives = 0;
+  std::uint64_t fragment_shader_invocations = 0;
+  std::uint64_t compute_shader_invocations = 0;
+};
+
+struct FrameGraphNodeTiming {
+  std::string name;
+  QueueType queue = QueueType::Graphics;
+  // Time between the node's first and last command, from the most recent
+  // frame whose queries were available.
+  double gpu_ms = 0;
+  // Exponential moving average of gpu_ms, steadier for display.
+  double average_gpu_ms = 0;
+  bool has_timestamps = false;
+  bool has_statistics = false;
+  FrameGraphPipelineStatistics statistics;
+};
+
+// Measures the GPU time of every node in a frame graph, and optionally its
+// pipeline statistics. Each frame in flight has its own query pools; a
+// pool is read back just before it is reused, by which time the frame that
+// wrote it has normally completed, so reading never stalls. Results that
+// are still unavailable are skipped and the previous values are kept.
+class FrameGraphProfiler : noncopyable {
+ public:
+  struct Options {
+    // Application::frames_in_flight() of the application rendering the
+    // graph, so a frame's pools aren't reused before it has completed.
+    std::size_t frames_in_flight = 2;
+    // Requires the pipelineStatisticsQuery device feature, silently
+    // disabled without it. Only nodes on the graphics queue are counted.
+    bool pipeline_statistics = false;
+  };
+
+  FrameGraphProfiler(
+      Device& device,
+      std::span<FrameGraphNode const> nodes,
+      Options const& options);
+
+  // Reads back the queries of the frame about to reuse the current pools.
+  void begin_frame();
+  void end_frame();
+
+  // Resets the queries of a run of nodes recorded to the same queue. Must
+  // be recorded before any of the nodes, outside of a render pass.
+  void reset_queries(
+      vk::CommandBuffer cmd,
+      QueueType queue,
+      std::size_t first_node,
+      std::size_t num_nodes) const;
+
+  // Bracket the commands of a node. Both calls must be recorded to the same
+  // command buffer, and within the same subpass when inside a render pass.
+  void begin_node(vk::CommandBuffer cmd, std::size_t node_idx) const;
+  void end_node(vk::CommandBuffer cmd, std::size_t node_idx) const;
+
+  // Indexed like FrameGraph::nodes().
+  std::span<FrameGraphNodeTiming const> timings() const {
+    return timings_;
+  }
+
+  double total_gpu_ms() const;
+
+  bool has_pipeline_statistics() const {
+    return pipeline_statistics_;
+  }
+
+  // Draws an ImGui window listing the timings. Must be called between
+  // ImGui::NewFrame and ImGui::Render.
+  void draw_ui(char const* title = "Frame Graph Profiler") const;
+
+ private:
+  struct FramePools {
+    vk::raii::QueryPool timestamps = nullptr;
+    vk::raii::QueryPool statistics = nullptr;
+    bool written = false;
+  };
+
+  void read_timestamps(FramePools const& pools);
+  void read_statistics(FramePools const& pools);
+  bool writes_timestamps(QueueType queue) const {
+    return timestamp_mask_[static_cast<std::size_t>(queue)] != 0;
+  }
+
+  std::vector<FramePools> frames_;
+  std::vector<FrameGraphNodeTiming> timings_;
+  std::size_t current_frame_ = 0;
+  // Nanoseconds per timestamp tick.
+  double timestamp_period_ = 0;
+  // Valid bits of the timestamps written on each queue, zero when the
+  // queue can't write them.
+  std::array<std::uint64_t, 2> timestamp_mask_ = {};
+  bool pipeline_statistics_ = false;
+};
+
+} // namespace rndrx::vulkan
+
+#endif // RNDRX_VULKAN_FRAMEGRAPHPROFILER_HPP_
@@ -0,0 +1,52 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_VULKAN_FRAMEGRAPHRELOADER_HPP_
+#define RNDRX_VULKAN_FRAMEGRAPHRELOADER_HPP_
+#pragma once
+
+#include <filesystem>
+#include "rndrx/frame_graph_description.hpp"
+#include "rndrx/frame_graph_serialisation.hpp"
+#include "rndrx/noncopyable.hpp"
+
+namespace rndrx::vulkan {
+
+class FrameGraph;
+class FrameGraphBuilder;
+
+// Compiles a frame graph from a description file and recompiles it
+// whenever the file changes. The builder and graph must outlive the
+// reloader.
+class FrameGraphReloader : noncopyable {
+ public:
+  FrameGraphReloader(
+      FrameGraphBuilder const& builder,
+      FrameGraph& graph,
+      std::filesystem::path path);
+
+  // Call between frames. Waits for the device to go idle before touching
+  // the graph. If the new description doesn't compile the graph is
+  // rebuilt from the last one that did. Returns whether the graph changed.
+  bool poll();
+
+ private:
+  FrameGraphBuilder const* builder_ = nullptr;
+  FrameGraph* graph_ = nullptr;
+  FrameGraphDescriptionWatcher watcher_;
+  FrameGraphDescription current_;
+};
+
+} // namespace rndrx::vulkan
+
+#endif // RNDRX_VULKAN_FRAMEGRAPHRELOADER_HPP_
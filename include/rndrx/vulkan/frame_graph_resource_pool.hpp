@@ -0,0 +1,96 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_VULKAN_FRAMEGRAPHRESOURCEPOOL_HPP_
+#define RNDRX_VULKAN_FRAMEGRAPHRESOURCEPOOL_HPP_
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include "rndrx/noncopyable.hpp"
+#include "rndrx/vulkan/vma/allocation.hpp"
+
+namespace rndrx {
+class FrameGraphAttachmentOutputDescription;
+} // namespace rndrx
+
+namespace rndrx::vulkan {
+
+class Device;
+class FrameGraphAttachment;
+
+// Device wide cache of the images and memory blocks frame graphs allocate
+// for themselves. Graphs built with the same pool hand their resources
+// back when they are destroyed or recompiled, and the next graph asking
+// for an image of the same format, extent and usage, or a memory block
+// at least as large, gets the old one instead of a new allocation.
+// Resources go back to the pool immediately, so as with
+// FrameGraph::update() the GPU must have finished with a graph before it
+// is released. The pool must outlive every graph built with it.
+class FrameGraphResourcePool : noncopyable {
+ public:
+  // Returns a leased resource to its pool, or destroys it when there is
+  // no pool.
+  struct Recycler {
+    FrameGraphResourcePool* pool = nullptr;
+    void operator()(FrameGraphAttachment* attachment) const;
+    void operator()(vma::Allocation* memory) const;
+  };
+
+  using Attachment = std::unique_ptr<FrameGraphAttachment, Recycler>;
+  using Memory = std::unique_ptr<vma::Allocation, Recycler>;
+
+  FrameGraphResourcePool() = default;
+  explicit FrameGraphResourcePool(Device& device);
+  ~FrameGraphResourcePool();
+
+  // A dedicated attachment with the load state of description.
+  Attachment acquire_attachment(
+      FrameGraphAttachmentOutputDescription const& description,
+      vk::Extent2D extent,
+      vk::ImageUsageFlags usage);
+
+  // The smallest free block that satisfies requirements.
+  Memory acquire_memory(vk::MemoryRequirements const& requirements);
+
+  // Destroys everything not currently leased.
+  void trim();
+
+  struct Stats {
+    std::size_t free_attachments = 0;
+    std::size_t free_blocks = 0;
+    vk::DeviceSize free_bytes = 0;
+    // Acquisitions served from the pool rather than allocated.
+    std::size_t reused = 0;
+    std::size_t allocated = 0;
+  };
+
+  Stats const& stats() const {
+    return stats_;
+  }
+
+ private:
+  void recycle(FrameGraphAttachment* attachment);
+  void recycle(vma::Allocation* memory);
+
+  Device* device_ = nullptr;
+  std::vector<std::unique_ptr<FrameGraphAttachment>> free_attachments_;
+  std::vector<std::unique_ptr<vma::Allocation>> free_memory_;
+  Stats stats_;
+};
+
+} // namespace rndrx::vulkan
+
+#endif // RNDRX_VULKAN_FRAMEGRAPHRESOURCEPOOL_HPP_
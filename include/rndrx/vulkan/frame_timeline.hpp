@@ -0,0 +1,100 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_VULKAN_FRAMETIMELINE_HPP_
+#define RNDRX_VULKAN_FRAMETIMELINE_HPP_
+#pragma once
+
+#include <cstdint>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include "rndrx/noncopyable.hpp"
+#include "rndrx/vulkan/device.hpp"
+
+namespace rndrx::vulkan {
+
+// Tracks frame completion with one timeline semaphore per queue. Each
+// semaphore counts the frames whose work on that queue has finished.
+// Frame indices start at 1, so 0 means nothing has been submitted yet.
+//
+// Between two frames every semaphore has kStepsPerFrame - 1 steps, which
+// order the work of the later frame across queues, as when a frame graph
+// splits a frame between the graphics and compute queues. Signalling a
+// step doesn't complete the frame.
+class FrameTimeline : noncopyable {
+ public:
+  static constexpr std::uint64_t kStepsPerFrame = 64;
+
+  explicit FrameTimeline(Device& device);
+
+  // Starts a new frame and returns its index. Frames have to be submitted
+  // in the order they were started.
+  std::uint64_t begin_frame() {
+    return ++current_frame_;
+  }
+
+  std::uint64_t current_frame() const {
+    return current_frame_;
+  }
+
+  // The compute semaphore is the graphics one when compute work shares the
+  // graphics queue.
+  vk::Semaphore semaphore(QueueType queue) const;
+
+  // Signals that all work submitted to queue so far belongs to frame.
+  vk::SemaphoreSubmitInfo signal_info(QueueType queue, std::uint64_t frame)
+      const;
+  // Waits for queue to finish frame.
+  vk::SemaphoreSubmitInfo wait_info(
+      QueueType queue,
+      std::uint64_t frame,
+      vk::PipelineStageFlags2 stages) const;
+
+  // Steps of a frame run from 1 to kStepsPerFrame - 1 and have to be
+  // signalled in increasing order on each queue.
+  vk::SemaphoreSubmitInfo step_signal_info(
+      QueueType queue,
+      std::uint64_t frame,
+      std::uint64_t step) const;
+  vk::SemaphoreSubmitInfo step_wait_info(
+      QueueType queue,
+      std::uint64_t frame,
+      std::uint64_t step,
+      vk::PipelineStageFlags2 stages) const;
+
+  // The last frame every queue has finished.
+  std::uint64_t completed_frame() const;
+
+  bool is_complete(std::uint64_t frame) const {
+    return completed_frame() >= frame;
+  }
+
+  // Blocks until every queue has finished frame.
+  void wait(std::uint64_t frame) const;
+
+  void wait_idle() const {
+    wait(current_frame_);
+  }
+
+ private:
+  static std::uint64_t step_value(std::uint64_t frame, std::uint64_t step);
+
+  Device* device_ = nullptr;
+  vk::raii::Semaphore graphics_semaphore_ = nullptr;
+  vk::raii::Semaphore compute_semaphore_ = nullptr;
+  std::uint64_t current_frame_ = 0;
+};
+
+} // namespace rndrx::vulkan
+
+#endif // RNDRX_VULKAN_FRAMETIMELINE_HPP_
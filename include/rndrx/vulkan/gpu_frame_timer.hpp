@@ -0,0 +1,71 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_VULKAN_GPUFRAMETIMER_HPP_
+#define RNDRX_VULKAN_GPUFRAMETIMER_HPP_
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include "rndrx/noncopyable.hpp"
+
+namespace rndrx::vulkan {
+
+class Device;
+class FrameTimeline;
+class SubmissionContext;
+
+struct GpuFrameTime {
+  std::uint64_t frame_index = 0;
+  double gpu_ms = 0;
+};
+
+// Measures the time each frame spends on the graphics queue with a pair of
+// timestamps around everything it records. Work on the compute queue is
+// covered because the frame's last graphics submission waits for it.
+// Results are only read once the frame timeline shows the frame complete,
+// so reading never stalls.
+class GpuFrameTimer : noncopyable {
+ public:
+  GpuFrameTimer(Device& device, std::uint32_t frames_in_flight);
+
+  // False when the graphics queue can't write timestamps, in which case
+  // nothing is recorded and poll() never returns a result.
+  bool is_supported() const {
+    return timestamp_mask_ != 0;
+  }
+
+  // Record right after SubmissionContext::begin_rendering and right before
+  // finish_rendering. Results of the frame that used the same queries
+  // before have to be polled before begin_frame or they are lost.
+  void begin_frame(SubmissionContext& sc);
+  void end_frame(SubmissionContext& sc);
+
+  // Returns the oldest completed frame that hasn't been returned yet.
+  std::optional<GpuFrameTime> poll(FrameTimeline const& timeline);
+
+ private:
+  vk::raii::QueryPool query_pool_ = nullptr;
+  // The frame whose timestamps are in each pair of queries, 0 if none.
+  std::vector<std::uint64_t> pending_frames_;
+  // Nanoseconds per timestamp tick.
+  double timestamp_period_ = 0;
+  std::uint64_t timestamp_mask_ = 0;
+};
+
+} // namespace rndrx::vulkan
+
+#endif // RNDRX_VULKAN_GPUFRAMETIMER_HPP_
@@ -16,6 +16,7 @@
 #pragma once
 
 #include <vulkan/vulkan_core.h>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <vulkan/vulkan_raii.hpp>
@@ -26,16 +27,35 @@
 
 class ImDrawData;
 class ImDrawList;
+struct ImGuiContext;
 namespace rndrx::vulkan {
 class Application;
 class Device;
 class SubmissionContext;
-class Swapchain;
 class Window;
 } // namespace rndrx::vulkan
 
 namespace rndrx::vulkan {
 
+// A copy of one frame's draw data, which stays valid after ImGui moves on
+// to the next frame so it can be recorded on another thread.
+class ImGuiFrame : noncopyable {
+ public:
+  explicit ImGuiFrame(ImDrawData const& draw_data);
+  ~ImGuiFrame();
+
+  ImDrawData* draw_data() const {
+    return draw_data_.get();
+  }
+
+ private:
+  std::unique_ptr<ImDrawData> draw_data_;
+  std::vector<ImDrawList*> draw_lists_;
+};
+
+// Draws the UI into its own attachment with dynamic rendering. The frame
+// is built on the thread owning the window, between begin_frame() and
+// end_frame(), and handed to the pass with set_frame() before it renders.
 class ImGuiRenderPass
     : public FrameGraphRenderPass
     , noncopyable {
@@ -48,23 +68,31 @@ class ImGuiRenderPass
   void initialise_imgui(
       Device& device,
       Application const& app,
-      Swapchain const& swapchain,
-      vk::RenderPass render_pass);
+      std::uint32_t image_count,
+      vk::Format colour_format);
   void begin_frame();
-  void end_frame();
-  void pre_render(SubmissionContext& sc) override;
-  void render(SubmissionContext& sc) override;
-  void post_render(SubmissionContext& sc) override;
+  std::shared_ptr<ImGuiFrame const> end_frame();
+  // Nothing is drawn without a frame.
+  void set_frame(std::shared_ptr<ImGuiFrame const> frame);
+  void pre_render(SubmissionContext& sc, vk::CommandBuffer cmd) override;
+  void render(SubmissionContext& sc, vk::CommandBuffer cmd) override;
+  void post_render(SubmissionContext& sc, vk::CommandBuffer cmd) override;
   void create_fonts_texture(SubmissionContext& sc);
   void finish_font_texture_creation();
 
  private:
+  // Shuts down whichever backends were initialised with the context.
+  struct ContextDeleter {
+    void operator()(ImGuiContext* context) const;
+  };
+
   static void check_vk_result(VkResult result);
   void create_descriptor_pool(Device const& device);
 
   vk::raii::DescriptorPool descriptor_pool_ = nullptr;
-  std::unique_ptr<ImDrawData> draw_data_;
-  std::vector<ImDrawList*> draw_list_memory_;
+  // Destroyed before the pool the backend allocates from.
+  std::unique_ptr<ImGuiContext, ContextDeleter> context_;
+  std::shared_ptr<ImGuiFrame const> frame_;
 };
 } // namespace rndrx::vulkan
 
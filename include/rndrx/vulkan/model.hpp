@@ -65,6 +65,8 @@ class Node : noncopyable {
 class ModelCreator;
 class Model : noncopyable {
  public:
+  // Submits the model's uploads without waiting for them, see
+  // upload_token().
   Model(Device& device, ShaderCache const& shaders, ModelCreator& source);
 
   RNDRX_DEFAULT_MOVABLE(Model);
@@ -84,6 +86,12 @@ class Model : noncopyable {
   void get_scene_dimensions();
   void update_animation(std::uint32_t index, float time);
 
+  // The upload queue token all of the model's buffers and textures are
+  // ready at. Submissions that draw the model wait on it.
+  std::uint64_t upload_token() const {
+    return upload_token_;
+  }
+
  private:
   friend class ModelCreator;
   void create_device_buffers(
@@ -104,6 +112,7 @@ class Model : noncopyable {
   glm::mat4 aabb_;
   CachedShader const* vs_ = nullptr;
   CachedShader const* fs_ = nullptr;
+  std::uint64_t upload_token_ = 0;
 };
 
 class ModelCreator {
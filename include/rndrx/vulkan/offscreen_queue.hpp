@@ -0,0 +1,135 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_VULKAN_OFFSCREENQUEUE_HPP_
+#define RNDRX_VULKAN_OFFSCREENQUEUE_HPP_
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include "rndrx/noncopyable.hpp"
+#include "rndrx/vulkan/vma/buffer.hpp"
+#include "rndrx/vulkan/vma/image.hpp"
+
+namespace rndrx::vulkan {
+
+class Device;
+class FrameTimeline;
+class SubmissionContext;
+
+// An offscreen image to render a frame into. The last submission writing
+// it has to leave it in final_layout().
+class OffscreenContext {
+ public:
+  vk::Image image() const {
+    return image_;
+  }
+
+  vk::ImageView image_view() const {
+    return image_view_;
+  }
+
+ private:
+  friend class OffscreenQueue;
+
+  OffscreenContext(
+      vk::Image image,
+      vk::ImageView image_view,
+      std::uint32_t image_idx)
+      : image_(image)
+      , image_view_(image_view)
+      , image_idx_(image_idx) {
+  }
+
+  vk::Image image_;
+  vk::ImageView image_view_;
+  std::uint32_t image_idx_;
+};
+
+// The pixels of a finished frame copied back to host memory.
+struct OffscreenReadback {
+  std::uint64_t frame_index = 0;
+  vk::Format format = vk::Format::eUndefined;
+  vk::Extent2D extent;
+  // Tightly packed rows. Only valid until the next frame starts.
+  std::span<std::byte const> pixels;
+};
+
+// Stands in for the swapchain when rendering without a window. Frames go
+// round robin into one image per frame in flight, so the frame timeline
+// guarantees an image is free again by the time it is acquired. Each
+// image can optionally be copied to host memory after its frame without
+// stalling the CPU.
+class OffscreenQueue : noncopyable {
+ public:
+  static constexpr vk::Format kFormat = vk::Format::eR8G8B8A8Unorm;
+
+  OffscreenQueue() = default;
+  OffscreenQueue(
+      Device& device,
+      vk::Extent2D extent,
+      std::uint32_t frames_in_flight,
+      bool readback);
+
+  vk::Format format() const {
+    return kFormat;
+  }
+
+  vk::Extent2D extent() const {
+    return extent_;
+  }
+
+  bool has_readback() const {
+    return readback_;
+  }
+
+  // Images end the frame ready to be copied from.
+  vk::ImageLayout final_layout() const {
+    return vk::ImageLayout::eTransferSrcOptimal;
+  }
+
+  OffscreenContext acquire_context();
+
+  // Copies the image into host memory. Has to be recorded in sc after
+  // everything else writing the image.
+  void record_readback(SubmissionContext& sc, OffscreenContext const& ctx);
+
+  // Returns the oldest readback that has finished on the GPU and hasn't
+  // been returned yet. Never blocks.
+  std::optional<OffscreenReadback> poll_readback(FrameTimeline const& timeline);
+
+ private:
+  struct Image {
+    vma::Image image = nullptr;
+    vk::raii::ImageView view = nullptr;
+    vma::Buffer readback = nullptr;
+    // The frame whose copy is in readback, or 0 if there is none pending.
+    std::uint64_t readback_frame = 0;
+  };
+
+  void create_images(Device& device);
+
+  std::vector<Image> images_;
+  vk::Extent2D extent_;
+  std::uint32_t image_idx_ = 0;
+  bool readback_ = false;
+};
+
+} // namespace rndrx::vulkan
+
+#endif // RNDRX_VULKAN_OFFSCREENQUEUE_HPP_
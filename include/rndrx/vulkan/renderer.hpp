@@ -15,11 +15,18 @@
 #define RNDRX_VULKAN_RENDERER_HPP_
 #pragma once
 
+#include <optional>
+#include "rndrx/frame_graph_description.hpp"
 #include "rndrx/noncopyable.hpp"
+#include "rndrx/thread_pool.hpp"
 #include "rndrx/vulkan/composite_render_pass.hpp"
 #include "rndrx/vulkan/device.hpp"
 #include "rndrx/vulkan/frame_graph.hpp"
+#include "rndrx/vulkan/frame_graph_builder.hpp"
+#include "rndrx/vulkan/frame_graph_profiler.hpp"
+#include "rndrx/vulkan/frame_graph_resource_pool.hpp"
 #include "rndrx/vulkan/imgui_render_pass.hpp"
+#include "rndrx/vulkan/offscreen_queue.hpp"
 #include "rndrx/vulkan/shader_cache.hpp"
 #include "rndrx/vulkan/swapchain.hpp"
 
@@ -45,15 +52,78 @@ class Renderer : noncopyable {
     return shaders_;
   }
 
-  PresentationContext acquire_present_context();
+  // Shared by the renderer's frame graphs so switching between them
+  // reuses their images.
+  FrameGraphResourcePool& frame_graph_resources() {
+    return frame_graph_resources_;
+  }
+
+  // Draws the UI into a layer composited over the frame. Null when
+  // headless.
+  ImGuiRenderPass* ui() {
+    return headless_ ? nullptr : &imgui_render_pass_;
+  }
+
+  // Null unless ApplicationConfig::profile_frame_graphs is set. Rebuilt
+  // with the graphs, so only used by the thread rendering.
+  FrameGraphProfiler const* profiler() const {
+    return deferred_frame_graph_.profiler();
+  }
+
+  // Headless renderers have no swapchain and render into the offscreen
+  // queue's images instead.
+  bool is_headless() const {
+    return headless_;
+  }
+
+  // Empty when the swapchain is out of date and has to be recreated.
+  std::optional<PresentationContext> acquire_present_context();
+  // Renders the frame straight into the acquired image, which is left
+  // ready to present once sc's final submission has executed.
+  void render(SubmissionContext& sc, PresentationContext const& ctx);
+  void present(PresentationContext const& ctx);
+
+  bool needs_swapchain_recreation() const {
+    return present_queue_.needs_recreation();
+  }
+
+  // Rebuilds the swapchain and everything sized by it for the window's
+  // framebuffer size, as sampled by the thread owning the window. Waits
+  // for the GPU to go idle. Returns false while the surface has no area,
+  // in which case nothing can be presented and it has to be tried again.
+  bool recreate_swapchain(
+      Application const& app,
+      vk::Extent2D framebuffer_extent);
+
+  // Renders the frame into the next offscreen image and, if enabled,
+  // copies it back to the host.
+  void render_offscreen(SubmissionContext& sc);
+  std::optional<OffscreenReadback> poll_readback(FrameTimeline const& timeline);
+
+  // The format and size of the images frames are rendered into.
+  vk::Format output_format() const;
+  vk::Extent2D output_extent() const;
 
  private:
+  void create_frame_graphs();
+  FrameGraphBuilder frame_graph_builder();
+  FrameGraphDescription frame_graph_description() const;
+  // Points the composite at the graph's current attachments.
+  void update_composite_sources();
+
+  bool headless_ = false;
+  std::optional<FrameGraphProfiler::Options> profiling_;
   Device device_;
   Swapchain swapchain_;
+  PresentationQueue present_queue_;
+  OffscreenQueue offscreen_queue_;
   ShaderCache shaders_;
   CompositeRenderPass final_composite_pass_;
-  // PresentationQueue present_queue_;
   ImGuiRenderPass imgui_render_pass_;
+  // Records the graphs' nodes in parallel. Declared before the graphs.
+  ThreadPool recording_threads_;
+  // Declared before the graphs, which return their resources to it.
+  FrameGraphResourcePool frame_graph_resources_;
   FrameGraph deferred_frame_graph_;
   FrameGraph gbuffer_debug_frame_graph_;
 };
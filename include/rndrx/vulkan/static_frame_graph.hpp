@@ -0,0 +1,565 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_VULKAN_STATICFRAMEGRAPH_HPP_
+#define RNDRX_VULKAN_STATICFRAMEGRAPH_HPP_
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vulkan/vulkan.hpp>
+#include "glm/vec4.hpp"
+#include "rndrx/attachment_ops.hpp"
+#include "rndrx/frame_graph_description.hpp"
+#include "rndrx/noncopyable.hpp"
+#include "rndrx/vulkan/device.hpp"
+#include "rndrx/vulkan/frame_graph.hpp"
+#include "rndrx/vulkan/submission_context.hpp"
+
+// Frame graphs whose topology is fixed when the program is compiled.
+//
+// The schedule, image lifetimes and barrier plan are computed by
+// compile_static_frame_graph() during compilation; at run time the graph
+// only creates its images and records a flat sequence of barriers and
+// passes on the graphics queue. The passes are concrete types called
+// directly, so there is no name lookup and no virtual dispatch, whatever
+// RNDRX_STATIC_BACKEND is set to.
+//
+//   constexpr auto kPlan = compile_static_frame_graph(
+//       std::array{
+//           StaticFrameGraphImage{"depth", ImageFormat::D32Sfloat},
+//           StaticFrameGraphImage{"colour", ImageFormat::B8G8R8A8Unorm}},
+//       std::array{
+//           StaticFrameGraphPass{"scene", FrameGraphPassType::Graphics,
+//               {{{"depth", FrameGraphResourceUsage::DepthStencilAttachment},
+//                 {"colour", FrameGraphResourceUsage::ColourAttachment}}}},
+//           StaticFrameGraphPass{"post", FrameGraphPassType::Compute,
+//               {{{"colour", FrameGraphResourceUsage::SampledImage}}}}});
+//
+//   StaticFrameGraph<kPlan, ScenePass, PostPass> graph(
+//       device, extent, scene, post);
+//
+// Mistakes in the declaration, such as reading an image nothing writes or
+// a cycle, fail to compile. src/vulkan/static_frame_graph.cpp only
+// compile-checks an example plan shaped like the renderer's UI composite
+// and instantiates the graph for it; the renderer itself uses FrameGraph.
+
+namespace rndrx::vulkan {
+
+inline constexpr std::size_t kMaxStaticFrameGraphAccesses = 8;
+
+// Images are sized relative to the graph's output extent.
+struct StaticFrameGraphImage {
+  std::string_view name;
+  ImageFormat format = ImageFormat::Undefined;
+  float scale = 1.f;
+  AttachmentLoadOp load_op = AttachmentLoadOp::DontCare;
+  std::array<float, 4> clear_colour = {};
+  float clear_depth = 0.f;
+  int clear_stencil = 0;
+};
+
+// Images are read as SampledImage; there are no subpasses, so no input
+// attachments. Graphics passes write colour and depth attachments, compute
+// passes storage images.
+struct StaticFrameGraphAccess {
+  std::string_view image;
+  FrameGraphResourceUsage usage = FrameGraphResourceUsage::SampledImage;
+};
+
+struct StaticFrameGraphPass {
+  std::string_view name;
+  FrameGraphPassType type = FrameGraphPassType::Graphics;
+  // Unused entries have an empty image name.
+  std::array<StaticFrameGraphAccess, kMaxStaticFrameGraphAccesses> accesses =
+      {};
+};
+
+// A barrier recorded before the pass at dst_pass. Passes are indices into
+// the declaration order.
+struct StaticFrameGraphTransition {
+  std::size_t image = 0;
+  FrameGraphResourceUsage src = FrameGraphResourceUsage::SampledImage;
+  std::size_t src_pass = 0;
+  FrameGraphResourceUsage dst = FrameGraphResourceUsage::SampledImage;
+  std::size_t dst_pass = 0;
+  // The previous contents are dead so the image can be transitioned from
+  // an undefined layout.
+  bool discard = false;
+  // The image's first access of the frame. The source is where the
+  // previous frame left it.
+  bool first = false;
+};
+
+constexpr bool is_static_frame_graph_write(FrameGraphResourceUsage usage) {
+  return usage == FrameGraphResourceUsage::ColourAttachment ||
+         usage == FrameGraphResourceUsage::DepthStencilAttachment ||
+         usage == FrameGraphResourceUsage::StorageImage;
+}
+
+constexpr bool has_stencil(ImageFormat format) {
+  return format == ImageFormat::S8Uint ||
+         format == ImageFormat::D16UnormS8Uint ||
+         format == ImageFormat::D24UnormS8Uint ||
+         format == ImageFormat::D32SfloatS8Uint;
+}
+
+template <std::size_t NumImages, std::size_t NumPasses>
+struct StaticFrameGraphPlan {
+  static constexpr std::size_t kNumImages = NumImages;
+  static constexpr std::size_t kNumPasses = NumPasses;
+  static constexpr std::size_t kMaxTransitions =
+      NumPasses * kMaxStaticFrameGraphAccesses;
+
+  std::array<StaticFrameGraphImage, NumImages> images = {};
+  std::array<StaticFrameGraphPass, NumPasses> passes = {};
+  // Indices into passes in execution order.
+  std::array<std::size_t, NumPasses> order = {};
+  // Positions in order of each image's first and last access.
+  std::array<std::size_t, NumImages> first_use = {};
+  std::array<std::size_t, NumImages> last_use = {};
+  // The barriers before the pass at position p of order are
+  // transitions[transition_begin[p], transition_begin[p + 1]).
+  std::array<StaticFrameGraphTransition, kMaxTransitions> transitions = {};
+  std::array<std::size_t, NumPasses + 1> transition_begin = {};
+
+  constexpr std::size_t image_index(std::string_view name) const {
+    for(std::size_t i = 0; i < NumImages; ++i) {
+      if(images[i].name == name) {
+        return i;
+      }
+    }
+
+    throw std::invalid_argument("Static frame graph image not declared.");
+  }
+
+  constexpr std::size_t pass_index(std::string_view name) const {
+    for(std::size_t i = 0; i < NumPasses; ++i) {
+      if(passes[i].name == name) {
+        return i;
+      }
+    }
+
+    throw std::invalid_argument("Static frame graph pass not declared.");
+  }
+};
+
+// Each image is written by exactly one pass, which runs before the passes
+// reading it. Of the passes ready to run, the one declared first goes
+// first, so the order is the declaration order when that is valid.
+template <std::size_t NumImages, std::size_t NumPasses>
+consteval StaticFrameGraphPlan<NumImages, NumPasses> compile_static_frame_graph(
+    std::array<StaticFrameGraphImage, NumImages> const& images,
+    std::array<StaticFrameGraphPass, NumPasses> const& passes) {
+  using Plan = StaticFrameGraphPlan<NumImages, NumPasses>;
+  Plan plan;
+  plan.images = images;
+  plan.passes = passes;
+
+  for(auto&& image : images) {
+    if(image.scale <= 0.f) {
+      throw std::invalid_argument("Image scale must be positive.");
+    }
+  }
+
+  constexpr std::size_t kNone = ~std::size_t(0);
+  std::array<std::size_t, NumImages> writer = {};
+  writer.fill(kNone);
+  for(std::size_t p = 0; p < NumPasses; ++p) {
+    StaticFrameGraphPass const& pass = passes[p];
+    if(pass.type == FrameGraphPassType::AsyncCompute) {
+      throw std::invalid_argument("Static frame graphs run on one queue.");
+    }
+
+    float scale = 0.f;
+    for(std::size_t a = 0; a < kMaxStaticFrameGraphAccesses; ++a) {
+      StaticFrameGraphAccess const& access = pass.accesses[a];
+      if(access.image.empty()) {
+        continue;
+      }
+
+      std::size_t const image = plan.image_index(access.image);
+      for(std::size_t b = 0; b < a; ++b) {
+        if(pass.accesses[b].image == access.image) {
+          throw std::invalid_argument("Pass accesses an image twice.");
+        }
+      }
+
+      switch(access.usage) {
+        case FrameGraphResourceUsage::SampledImage:
+          continue;
+        case FrameGraphResourceUsage::ColourAttachment:
+        case FrameGraphResourceUsage::DepthStencilAttachment:
+          if(pass.type != FrameGraphPassType::Graphics) {
+            throw std::invalid_argument(
+                "Only graphics passes write attachments.");
+          }
+          // Everything rendered in one pass has to be the same size.
+          if(scale != 0.f && scale != images[image].scale) {
+            throw std::invalid_argument("Pass attachments differ in size.");
+          }
+          scale = images[image].scale;
+          break;
+        case FrameGraphResourceUsage::StorageImage:
+          if(pass.type == FrameGraphPassType::Graphics) {
+            throw std::invalid_argument(
+                "Graphics passes don't write storage images.");
+          }
+          break;
+        default:
+          throw std::invalid_argument(
+              "Static frame graphs only sample and write images.");
+      }
+
+      if(writer[image] != kNone) {
+        throw std::invalid_argument("Image written by more than one pass.");
+      }
+
+      writer[image] = p;
+    }
+  }
+
+  for(std::size_t i = 0; i < NumImages; ++i) {
+    if(writer[i] == kNone) {
+      throw std::invalid_argument("Image is never written.");
+    }
+  }
+
+  std::array<bool, NumPasses> scheduled = {};
+  for(std::size_t position = 0; position < NumPasses; ++position) {
+    std::size_t next = kNone;
+    for(std::size_t p = 0; p < NumPasses && next == kNone; ++p) {
+      if(scheduled[p]) {
+        continue;
+      }
+
+      bool ready = true;
+      for(auto&& access : passes[p].accesses) {
+        if(!access.image.empty() &&
+           !is_static_frame_graph_write(access.usage) &&
+           !scheduled[writer[plan.image_index(access.image)]]) {
+          ready = false;
+        }
+      }
+
+      if(ready) {
+        next = p;
+      }
+    }
+
+    if(next == kNone) {
+      throw std::invalid_argument("Static frame graph has a cycle.");
+    }
+
+    plan.order[position] = next;
+    scheduled[next] = true;
+  }
+
+  // Where each image is left at the end of a frame, which is where the
+  // first barrier of the next frame starts from.
+  std::array<FrameGraphResourceUsage, NumImages> final_usage = {};
+  std::array<std::size_t, NumImages> final_pass = {};
+  for(std::size_t position = 0; position < NumPasses; ++position) {
+    std::size_t const p = plan.order[position];
+    for(auto&& access : passes[p].accesses) {
+      if(!access.image.empty()) {
+        std::size_t const image = plan.image_index(access.image);
+        final_usage[image] = access.usage;
+        final_pass[image] = p;
+      }
+    }
+  }
+
+  std::array<bool, NumImages> seen = {};
+  std::array<FrameGraphResourceUsage, NumImages> current_usage = {};
+  std::array<std::size_t, NumImages> current_pass = {};
+  std::size_t num_transitions = 0;
+  for(std::size_t position = 0; position < NumPasses; ++position) {
+    std::size_t const p = plan.order[position];
+    plan.transition_begin[position] = num_transitions;
+    for(auto&& access : passes[p].accesses) {
+      if(access.image.empty()) {
+        continue;
+      }
+
+      std::size_t const image = plan.image_index(access.image);
+      StaticFrameGraphTransition transition;
+      transition.image = image;
+      transition.dst = access.usage;
+      transition.dst_pass = p;
+      if(!seen[image]) {
+        // Readers run after the writer, so the first access writes.
+        transition.src = final_usage[image];
+        transition.src_pass = final_pass[image];
+        transition.discard = images[image].load_op != AttachmentLoadOp::Load;
+        transition.first = true;
+        plan.transitions[num_transitions++] = transition;
+        plan.first_use[image] = position;
+        seen[image] = true;
+      }
+      // Reads in the same layout don't need a barrier between them.
+      else if(
+          current_usage[image] != access.usage ||
+          is_static_frame_graph_write(access.usage)) {
+        transition.src = current_usage[image];
+        transition.src_pass = current_pass[image];
+        plan.transitions[num_transitions++] = transition;
+      }
+
+      current_usage[image] = access.usage;
+      current_pass[image] = p;
+      plan.last_use[image] = position;
+    }
+  }
+
+  plan.transition_begin[NumPasses] = num_transitions;
+  return plan;
+}
+
+// Pass is any type with pre_render, render and post_render members taking
+// a SubmissionContext& and a vk::CommandBuffer, such as an implementation
+// of FrameGraphRenderPass. Graphics passes render inside a
+// vk::RenderingInfo made of their attachments, so their pipelines are
+// created for dynamic rendering. Passes are given in declaration order.
+template <auto const& kPlan, typename... Passes>
+class StaticFrameGraph : noncopyable {
+  using Plan = std::remove_cvref_t<decltype(kPlan)>;
+  static constexpr std::size_t kNumImages = Plan::kNumImages;
+  static constexpr std::size_t kNumPasses = Plan::kNumPasses;
+  static_assert(
+      sizeof...(Passes) == kNumPasses,
+      "One implementation per declared pass, in the same order.");
+
+ public:
+  StaticFrameGraph(
+      Device& device,
+      vk::Extent2D output_extent,
+      Passes&... passes)
+      : device_(&device)
+      , passes_(passes...) {
+    resize(output_extent);
+  }
+
+  // Recreates the images for a new output extent. The GPU must have
+  // finished with the graph.
+  void resize(vk::Extent2D output_extent) {
+    create_images(output_extent);
+    create_barriers();
+    create_rendering_infos();
+    first_frame_ = true;
+  }
+
+  // Records every pass into the context's graphics command buffer.
+  void render(SubmissionContext& sc) {
+    vk::CommandBuffer cmd = sc.command_buffer();
+    [&]<std::size_t... Positions>(std::index_sequence<Positions...>) {
+      (record_pass<Positions>(sc, cmd), ...);
+    }(std::make_index_sequence<kNumPasses>());
+    first_frame_ = false;
+  }
+
+  // Use kPlan.image_index() to find the index by name at compile time.
+  FrameGraphAttachment const& image(std::size_t image_idx) const {
+    return *images_[image_idx];
+  }
+
+ private:
+  static constexpr vk::PipelineStageFlags2 shader_stages(std::size_t pass) {
+    return kPlan.passes[pass].type == FrameGraphPassType::Graphics
+               ? vk::PipelineStageFlagBits2::eVertexShader |
+                     vk::PipelineStageFlagBits2::eFragmentShader
+               : vk::PipelineStageFlagBits2::eComputeShader;
+  }
+
+  void create_images(vk::Extent2D output_extent) {
+    std::array<vk::ImageUsageFlags, kNumImages> usages;
+    for(auto&& pass : kPlan.passes) {
+      for(auto&& access : pass.accesses) {
+        if(!access.image.empty()) {
+          usages[kPlan.image_index(access.image)] |= image_usage(access.usage);
+        }
+      }
+    }
+
+    for(std::size_t i = 0; i < kNumImages; ++i) {
+      StaticFrameGraphImage const& image = kPlan.images[i];
+      auto const& colour = image.clear_colour;
+      FrameGraphAttachmentOutputDescription description =
+          FrameGraphAttachmentOutputDescription(std::string(image.name))
+              .format(image.format)
+              .output_relative_resolution(image.scale)
+              .load_op(image.load_op)
+              .clear_colour(glm::vec4(colour[0], colour[1], colour[2], colour[3]))
+              .clear_depth(image.clear_depth)
+              .clear_stencil(image.clear_stencil);
+      auto scale = [&image](std::uint32_t size) {
+        return std::max(1u, static_cast<std::uint32_t>(size * image.scale + 0.5f));
+      };
+
+      images_[i].reset();
+      images_[i] = std::make_unique<FrameGraphAttachment>(
+          *device_,
+          description,
+          vk::Extent2D(scale(output_extent.width), scale(output_extent.height)),
+          usages[i]);
+    }
+  }
+
+  void create_barriers() {
+    for(std::size_t i = 0; i < kPlan.transition_begin[kNumPasses]; ++i) {
+      StaticFrameGraphTransition const& transition = kPlan.transitions[i];
+      FrameGraphAttachment const* image = images_[transition.image].get();
+      FrameGraphResourceState const src = required_state(
+          transition.src,
+          image,
+          shader_stages(transition.src_pass));
+      FrameGraphResourceState const dst = required_state(
+          transition.dst,
+          image,
+          shader_stages(transition.dst_pass));
+      barriers_[i] = vk::ImageMemoryBarrier2()
+                         .setSrcStageMask(src.stages)
+                         .setSrcAccessMask(src.access)
+                         .setDstStageMask(dst.stages)
+                         .setDstAccessMask(dst.access)
+                         .setOldLayout(
+                             transition.discard ? vk::ImageLayout::eUndefined
+                                                : src.layout)
+                         .setNewLayout(dst.layout)
+                         .setImage(*image->image().vk())
+                         .setSubresourceRange( //
+                             vk::ImageSubresourceRange()
+                                 .setAspectMask(image->aspect_mask())
+                                 .setLevelCount(1)
+                                 .setLayerCount(1));
+
+      // Nothing has been written yet on the first frame.
+      first_frame_barriers_[i] = barriers_[i];
+      if(transition.first) {
+        first_frame_barriers_[i].setOldLayout(vk::ImageLayout::eUndefined);
+      }
+    }
+  }
+
+  void create_rendering_infos() {
+    for(std::size_t p = 0; p < kNumPasses; ++p) {
+      RenderingInfo& info = rendering_infos_[p];
+      info = {};
+      for(auto&& access : kPlan.passes[p].accesses) {
+        if(access.image.empty() ||
+           (access.usage != FrameGraphResourceUsage::ColourAttachment &&
+            access.usage != FrameGraphResourceUsage::DepthStencilAttachment)) {
+          continue;
+        }
+
+        std::size_t const image_idx = kPlan.image_index(access.image);
+        FrameGraphAttachment const* image = images_[image_idx].get();
+        info.extent = vk::Extent2D(image->width(), image->height());
+        vk::RenderingAttachmentInfo attachment =
+            vk::RenderingAttachmentInfo()
+                .setImageView(*image->image_view())
+                .setImageLayout(required_state(access.usage, image, {}).layout)
+                .setLoadOp(image->load_op())
+                .setStoreOp(vk::AttachmentStoreOp::eStore)
+                .setClearValue(clear_value(access.usage, image));
+        if(access.usage == FrameGraphResourceUsage::ColourAttachment) {
+          info.colour[info.num_colour++] = attachment;
+        }
+        else {
+          info.depth = attachment;
+          info.has_depth = true;
+          info.has_stencil = has_stencil(kPlan.images[image_idx].format);
+        }
+      }
+    }
+  }
+
+  template <std::size_t Position>
+  void record_pass(SubmissionContext& sc, vk::CommandBuffer cmd) {
+    constexpr std::size_t kPass = kPlan.order[Position];
+    constexpr std::size_t kBegin = kPlan.transition_begin[Position];
+    constexpr std::size_t kEnd = kPlan.transition_begin[Position + 1];
+    auto& pass = std::get<kPass>(passes_);
+    using Pass = std::remove_cvref_t<decltype(pass)>;
+
+    if constexpr(kEnd > kBegin) {
+      auto const& barriers = first_frame_ ? first_frame_barriers_ : barriers_;
+      cmd.pipelineBarrier2(vk::DependencyInfo()
+                               .setImageMemoryBarrierCount(kEnd - kBegin)
+                               .setPImageMemoryBarriers(&barriers[kBegin]));
+    }
+
+    // Qualified calls, so they are never virtual.
+    pass.Pass::pre_render(sc, cmd);
+    if constexpr(kPlan.passes[kPass].type == FrameGraphPassType::Graphics) {
+      RenderingInfo const& info = rendering_infos_[kPass];
+      vk::Rect2D const area({0, 0}, info.extent);
+      cmd.beginRendering(
+          vk::RenderingInfo()
+              .setRenderArea(area)
+              .setLayerCount(1)
+              .setColorAttachmentCount(static_cast<std::uint32_t>(info.num_colour))
+              .setPColorAttachments(info.colour.data())
+              .setPDepthAttachment(info.has_depth ? &info.depth : nullptr)
+              .setPStencilAttachment(info.has_stencil ? &info.depth : nullptr));
+      cmd.setScissor(0, area);
+      cmd.setViewport(
+          0,
+          vk::Viewport(
+              0.f,
+              0.f,
+              static_cast<float>(info.extent.width),
+              static_cast<float>(info.extent.height),
+              0.f,
+              1.f));
+      pass.Pass::render(sc, cmd);
+      cmd.endRendering();
+    }
+    else {
+      pass.Pass::render(sc, cmd);
+    }
+    pass.Pass::post_render(sc, cmd);
+  }
+
+  struct RenderingInfo {
+    vk::Extent2D extent;
+    std::array<vk::RenderingAttachmentInfo, kMaxStaticFrameGraphAccesses>
+        colour;
+    std::size_t num_colour = 0;
+    vk::RenderingAttachmentInfo depth;
+    bool has_depth = false;
+    bool has_stencil = false;
+  };
+
+  Device* device_ = nullptr;
+  std::tuple<Passes&...> passes_;
+  std::array<std::unique_ptr<FrameGraphAttachment>, kNumImages> images_;
+  std::array<vk::ImageMemoryBarrier2, Plan::kMaxTransitions> barriers_;
+  std::array<vk::ImageMemoryBarrier2, Plan::kMaxTransitions>
+      first_frame_barriers_;
+  std::array<RenderingInfo, kNumPasses> rendering_infos_;
+  bool first_frame_ = true;
+};
+
+} // namespace rndrx::vulkan
+
+#endif // RNDRX_VULKAN_STATICFRAMEGRAPH_HPP_
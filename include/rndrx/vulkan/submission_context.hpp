@@ -15,52 +15,139 @@
 #define RNDRX_VULKAN_SUBMISSIONCONTEXT_HPP_
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <span>
 #include <vector>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_raii.hpp>
 #include "rndrx/noncopyable.hpp"
-
-namespace rndrx { namespace vulkan {
-class Device;
-}} // namespace rndrx::vulkan
+#include "rndrx/vulkan/device.hpp"
+#include "rndrx/vulkan/frame_timeline.hpp"
+#include "rndrx/vulkan/transient_buffer_allocator.hpp"
 
 namespace rndrx::vulkan {
 
+// Records and submits the work for one frame. Contexts sharing a timeline
+// can be used round robin to keep several frames in flight; a context is
+// only reused once the timeline shows the GPU has finished its last frame.
 class SubmissionContext : noncopyable {
  public:
-  explicit SubmissionContext(Device& device)
-      : device_(device) {
-    create_command_pool(device);
-    create_command_buffers(device);
-    create_sync_objects(device);
+  SubmissionContext(Device& device, FrameTimeline& timeline)
+      : device_(device)
+      , timeline_(&timeline)
+      , transient_buffers_(device) {
+    create_command_pools(device);
   }
 
   ~SubmissionContext();
 
   vk::CommandBuffer command_buffer() {
-    return *command_buffers_[0];
+    return command_buffer(QueueType::Graphics);
   };
 
+  // The command buffer currently being recorded for queue. Compute
+  // command buffers are begun on first use after each submit.
+  vk::CommandBuffer command_buffer(QueueType queue);
+
+  // Makes sure there is a secondary command pool for each recording thread.
+  // Must be called before recording from other threads.
+  void reserve_recording_threads(std::size_t count);
+
+  // Returns an unused secondary command buffer from the pool belonging to
+  // thread_idx. Only that thread may call this with its index.
+  vk::CommandBuffer secondary_command_buffer(
+      std::size_t thread_idx,
+      QueueType queue = QueueType::Graphics);
+
+  // Submits everything recorded for queue so far. Recording for the
+  // graphics queue continues in a fresh command buffer.
+  void submit(
+      QueueType queue,
+      std::span<vk::SemaphoreSubmitInfo const> waits,
+      std::span<vk::SemaphoreSubmitInfo const> signals);
+
+  // Adds a semaphore operation to the submission made by finish_rendering.
+  void wait_semaphore(vk::SemaphoreSubmitInfo const& wait);
+  void signal_semaphore(vk::SemaphoreSubmitInfo const& signal);
+
+  // Adds a wait to the frame's next submission to queue, for things every
+  // submission of the frame may depend on.
+  void wait_before_next_submit(
+      QueueType queue,
+      vk::SemaphoreSubmitInfo const& wait);
+
+  // Waits for the GPU to finish this context's previous frame and starts
+  // a new one on the timeline.
   void begin_rendering(vk::Rect2D extents);
+  // Submits the frame, signalling its index on every queue's timeline.
   void finish_rendering();
-  void wait_for_fence();
+  void wait_for_completion() const;
+
+  // Hands out count consecutive steps of the frame on the timeline, see
+  // FrameTimeline::step_signal_info(), and returns the first.
+  std::uint64_t reserve_timeline_steps(std::size_t count);
+
+  // The timeline index of the frame being recorded, or last recorded.
+  std::uint64_t frame_index() const {
+    return frame_index_;
+  }
+
+  FrameTimeline const& timeline() const {
+    return *timeline_;
+  }
 
   vk::Rect2D render_extents() const {
     return render_extents_;
   }
 
+  // Memory for buffers used only during this frame. Reset once the
+  // frame has finished on the GPU.
+  TransientBufferAllocator& transient_buffers() {
+    return transient_buffers_;
+  }
+
  private:
-  void create_command_pool(Device& device);
-  void create_command_buffers(Device& device);
-  void create_sync_objects(Device& device);
+  void create_command_pools(Device& device);
+
+  struct CommandPool {
+    vk::raii::CommandPool pool = nullptr;
+    std::vector<vk::raii::CommandBuffer> command_buffers;
+    std::size_t num_used = 0;
+  };
+
+  struct QueueCommands {
+    CommandPool primary_pool;
+    std::vector<CommandPool> recording_pools;
+    std::vector<vk::SemaphoreSubmitInfo> next_submit_waits;
+    bool recording = false;
+  };
+
+  CommandPool create_command_pool(QueueType queue) const;
+  vk::CommandBuffer next_command_buffer(
+      CommandPool& pool,
+      vk::CommandBufferLevel level) const;
+  void submit_to_queue(
+      QueueType queue,
+      std::span<vk::SemaphoreSubmitInfo const> waits,
+      std::span<vk::SemaphoreSubmitInfo const> signals);
+  void signal_compute_timeline();
+
+  QueueCommands& queue_commands(QueueType queue) {
+    return queues_[static_cast<std::size_t>(queue)];
+  }
 
   Device& device_;
-  vk::raii::CommandPool command_pool_ = nullptr;
-  vk::raii::CommandBuffers command_buffers_ = nullptr;
-  vk::raii::Fence submit_fence_ = nullptr;
+  FrameTimeline* timeline_;
+  std::uint64_t frame_index_ = 0;
+  std::uint64_t next_timeline_step_ = 1;
+  std::array<QueueCommands, 2> queues_;
+  std::vector<vk::SemaphoreSubmitInfo> final_waits_;
+  std::vector<vk::SemaphoreSubmitInfo> final_signals_;
   vk::Rect2D render_extents_;
+  TransientBufferAllocator transient_buffers_;
 };
 
 } // namespace rndrx::vulkan
 
-#endif // RNDRX_VULKAN_SUBMISSIONCONTEXT_HPP_
\ No newline at end of file
+#endif // RNDRX_VULKAN_SUBMISSIONCONTEXT_HPP_
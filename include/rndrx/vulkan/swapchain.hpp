@@ -16,6 +16,7 @@
 #pragma once
 
 #include <limits>
+#include <optional>
 #include <span>
 #include <vector>
 #include <vulkan/vulkan.hpp>
@@ -23,7 +24,6 @@
 #include <vulkan/vulkan_handles.hpp>
 #include <vulkan/vulkan_raii.hpp>
 #include <vulkan/vulkan_structs.hpp>
-#include "render_target.hpp"
 #include "rndrx/noncopyable.hpp"
 
 namespace rndrx::vulkan {
@@ -32,10 +32,38 @@ class Application;
 class Device;
 class Swapchain;
 
+// How presented images reach the display. Falls back to Fifo, the only
+// mode every device supports, when the requested one isn't available.
+enum class PresentMode {
+  // No vsync, tears, lowest latency.
+  Immediate,
+  // Vsync, the newest image replaces any queued one.
+  Mailbox,
+  // Vsync, images queue up and the CPU is throttled to the display.
+  Fifo,
+  // Like Fifo, but late images are shown immediately and may tear.
+  FifoRelaxed,
+};
+
+// An acquired swapchain image. Rendering to it has to wait on the acquire
+// semaphore, and the last submission writing it has to leave it in
+// ePresentSrcKHR and signal the present semaphore.
 class PresentationContext {
  public:
-  RenderTarget const& target() const {
-    return rt_;
+  vk::Image image() const {
+    return image_;
+  }
+
+  vk::ImageView image_view() const {
+    return image_view_;
+  }
+
+  vk::Semaphore acquire_semaphore() const {
+    return acquire_semaphore_;
+  }
+
+  vk::Semaphore present_semaphore() const {
+    return present_semaphore_;
   }
 
  private:
@@ -44,15 +72,22 @@ class PresentationContext {
   PresentationContext(
       vk::Image image,
       vk::ImageView image_view,
-      vk::Framebuffer framebuffer,
+      vk::Semaphore acquire_semaphore,
+      vk::Semaphore present_semaphore,
       std::uint32_t image_idx,
       std::uint32_t sync_idx)
-      : rt_(image, image_view, framebuffer)
+      : image_(image)
+      , image_view_(image_view)
+      , acquire_semaphore_(acquire_semaphore)
+      , present_semaphore_(present_semaphore)
       , image_idx_(image_idx)
       , sync_idx_(sync_idx) {
   }
 
-  RenderTarget rt_;
+  vk::Image image_;
+  vk::ImageView image_view_;
+  vk::Semaphore acquire_semaphore_;
+  vk::Semaphore present_semaphore_;
   std::uint32_t image_idx_;
   std::uint32_t sync_idx_;
 };
@@ -64,37 +99,58 @@ class PresentationQueue : noncopyable {
       Device const& device,
       Swapchain const& swapchain,
       vk::raii::Queue const& present_queue,
-      vk::RenderPass renderpass)
+      std::uint32_t frames_in_flight)
       : swapchain_(&swapchain)
-      , present_queue_(&present_queue) {
+      , present_queue_(&present_queue)
+      , frames_in_flight_(frames_in_flight) {
     create_image_views(device);
-    create_framebuffers(device, renderpass);
     create_sync_objects(device);
   }
 
   ~PresentationQueue();
 
-  PresentationContext acquire_context();
-  void present(PresentationContext const& ctx) const;
+  // Empty when the swapchain is out of date, in which case nothing was
+  // acquired and it has to be recreated before trying again.
+  std::optional<PresentationContext> acquire_context();
+  void present(PresentationContext const& ctx);
+
+  // Set once an acquire or present reports the swapchain as suboptimal or
+  // out of date. Frames can still be presented while it is only
+  // suboptimal.
+  bool needs_recreation() const {
+    return needs_recreation_;
+  }
+
+  // Picks up the images of a recreated swapchain. The GPU must be idle.
+  void recreate(Device const& device);
 
  private:
   void create_image_views(Device const& device);
-  void create_framebuffers(Device const& device, vk::RenderPass renderpass);
   void create_sync_objects(Device const& device);
 
   std::vector<vk::raii::ImageView> image_views_;
-  std::vector<vk::raii::Framebuffer> framebuffers_;
-  std::vector<vk::raii::Fence> image_ready_fences_;
-  Swapchain const* swapchain_;
-  vk::raii::Queue const* present_queue_;
+  // Acquires cycle through these as the image isn't known until the
+  // acquire returns. Present semaphores belong to an image.
+  std::vector<vk::raii::Semaphore> acquire_semaphores_;
+  std::vector<vk::raii::Semaphore> present_semaphores_;
+  Swapchain const* swapchain_ = nullptr;
+  vk::raii::Queue const* present_queue_ = nullptr;
+  std::uint32_t frames_in_flight_ = 0;
   std::uint32_t image_idx_ = std::numeric_limits<std::uint32_t>::max();
   std::uint32_t sync_idx_ = 0;
+  bool needs_recreation_ = false;
 };
 
 class Swapchain : noncopyable {
  public:
   Swapchain() = default;
-  Swapchain(Application const& app, Device& device);
+  // framebuffer_extent is the window's size in pixels, which is used when
+  // the surface leaves the size up to the swapchain. It's passed in so the
+  // swapchain can be created away from the thread that owns the window.
+  Swapchain(
+      Application const& app,
+      Device& device,
+      vk::Extent2D framebuffer_extent);
   Swapchain(Swapchain&&) = default;
   ~Swapchain() = default;
   Swapchain& operator=(Swapchain&&) = default;
@@ -115,8 +171,20 @@ class Swapchain : noncopyable {
     return swapchain_;
   }
 
+  // Replaces the swapchain with one matching the surface's current size,
+  // handing the old one over through oldSwapchain. None of the old images
+  // may still be in use. Returns false, keeping the old swapchain, while
+  // the surface has no area.
+  bool recreate(
+      Application const& app,
+      Device& device,
+      vk::Extent2D framebuffer_extent);
+
  private:
-  void create_swapchain(Application const& app, Device& device);
+  bool create_swapchain(
+      Application const& app,
+      Device& device,
+      vk::Extent2D framebuffer_extent);
 
   vk::raii::SwapchainKHR swapchain_ = nullptr;
   std::vector<vk::Image> images_;
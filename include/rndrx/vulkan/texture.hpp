@@ -41,11 +41,18 @@ class Texture : noncopyable {
   Texture(std::nullptr_t) {
   }
 
+  // Records the upload into the device's upload queue without waiting
+  // for it.
   Texture(Device& device, TextureCreateInfo const& create_info);
   vk::DescriptorImageInfo descriptor() const;
 
+  // The upload queue token the image contents are ready at.
+  std::uint64_t upload_token() const {
+    return upload_token_;
+  }
+
  private:
-  void generate_mip_maps(Device& device, vk::raii::CommandBuffer& cmd_buf);
+  void generate_mip_maps(Device& device, vk::CommandBuffer cmd_buf);
 
   vma::Image image_ = nullptr;
   vk::raii::ImageView image_view_ = nullptr;
@@ -57,6 +64,7 @@ class Texture : noncopyable {
   std::uint32_t height_ = 0;
   std::uint32_t mip_count_ = 0;
   std::uint32_t layer_count_ = 0;
+  std::uint64_t upload_token_ = 0;
 };
 
 } // namespace rndrx::vulkan
@@ -0,0 +1,83 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_VULKAN_TRANSIENTBUFFERALLOCATOR_HPP_
+#define RNDRX_VULKAN_TRANSIENTBUFFERALLOCATOR_HPP_
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include "rndrx/noncopyable.hpp"
+#include "rndrx/vulkan/vma/buffer.hpp"
+
+namespace rndrx::vulkan {
+
+class Device;
+
+// Linear allocator for buffers that only live for a single frame.
+// Allocations are carved out of a few large device local buffers and are
+// all released at once by reset, which must wait until the GPU has
+// finished with them. The buffers are shared between the graphics and
+// compute queue families so no ownership transfers are needed.
+class TransientBufferAllocator : noncopyable {
+ public:
+  struct Allocation {
+    vk::Buffer buffer;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+  };
+
+  static constexpr vk::DeviceSize kDefaultBlockSize = 16 * 1024 * 1024;
+  static constexpr vk::BufferUsageFlags kSupportedUsage =
+      vk::BufferUsageFlagBits::eUniformBuffer |
+      vk::BufferUsageFlagBits::eStorageBuffer |
+      vk::BufferUsageFlagBits::eIndirectBuffer |
+      vk::BufferUsageFlagBits::eVertexBuffer |
+      vk::BufferUsageFlagBits::eIndexBuffer |
+      vk::BufferUsageFlagBits::eTransferSrc |
+      vk::BufferUsageFlagBits::eTransferDst;
+
+  explicit TransientBufferAllocator(
+      Device& device,
+      vk::DeviceSize block_size = kDefaultBlockSize);
+
+  Allocation allocate(vk::DeviceSize size, vk::BufferUsageFlags usage);
+  void reset();
+
+  // Bytes handed out since the last reset.
+  vk::DeviceSize allocated_bytes() const;
+
+  std::size_t num_blocks() const {
+    return blocks_.size();
+  }
+
+ private:
+  struct Block {
+    vma::Buffer buffer = nullptr;
+    vk::DeviceSize size = 0;
+    vk::DeviceSize used = 0;
+  };
+
+  void add_block(vk::DeviceSize min_size);
+
+  Device& device_;
+  vk::DeviceSize block_size_ = 0;
+  vk::DeviceSize alignment_ = 0;
+  std::vector<Block> blocks_;
+  std::size_t current_block_ = 0;
+};
+
+} // namespace rndrx::vulkan
+
+#endif // RNDRX_VULKAN_TRANSIENTBUFFERALLOCATOR_HPP_
@@ -0,0 +1,137 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_VULKAN_UPLOADQUEUE_HPP_
+#define RNDRX_VULKAN_UPLOADQUEUE_HPP_
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include "rndrx/noncopyable.hpp"
+#include "rndrx/vulkan/vma/buffer.hpp"
+
+namespace rndrx::vulkan {
+
+class Device;
+
+// Copies data from the host into device resources through a persistently
+// mapped staging ring. Copies are recorded into a batch that is submitted
+// to the graphics queue as one unit, and each batch signals a timeline
+// semaphore with its token when it completes, so callers poll or wait on
+// the token instead of blocking on every upload. Batches go to the
+// graphics queue as they can also generate mips with blits, which a
+// dedicated transfer queue doesn't support.
+//
+// Not thread safe. As it submits to the graphics queue, uploads have to
+// be made on the thread that renders, which with pipelined rendering is
+// the render thread.
+class UploadQueue : noncopyable {
+ public:
+  static constexpr vk::DeviceSize kDefaultRingSize = 64 * 1024 * 1024;
+
+  UploadQueue() = default;
+  explicit UploadQueue(
+      Device& device,
+      vk::DeviceSize ring_size = kDefaultRingSize);
+  ~UploadQueue();
+
+  UploadQueue(UploadQueue&&) = default;
+  UploadQueue& operator=(UploadQueue&&) = default;
+
+  struct Staging {
+    std::span<std::byte> data;
+    vk::Buffer buffer;
+    vk::DeviceSize offset = 0;
+  };
+
+  // Reserves size bytes of staging memory in the current batch. Making
+  // room can submit the current batch, so fetch command_buffer() after
+  // staging. Anything larger than the ring gets a buffer of its own that
+  // lives as long as the batch.
+  Staging stage(vk::DeviceSize size, vk::DeviceSize alignment = 16);
+
+  // The command buffer the current batch is recorded into.
+  vk::CommandBuffer command_buffer();
+
+  // Stages data and records a copy of it into dst. Returns the token of
+  // the batch the copy is in.
+  std::uint64_t upload(
+      vk::Buffer dst,
+      vk::DeviceSize dst_offset,
+      std::span<std::byte const> data);
+
+  // The token the current batch signals when it completes.
+  std::uint64_t batch_token() const {
+    return submitted_token_ + 1;
+  }
+
+  // Submits the current batch if anything was recorded into it. Returns
+  // the token of the last submitted batch.
+  std::uint64_t flush();
+
+  std::uint64_t completed_token() const;
+
+  bool is_complete(std::uint64_t token) const {
+    return completed_token() >= token;
+  }
+
+  // Blocks until the batch with token completes, submitting it first if
+  // it's still being recorded.
+  void wait(std::uint64_t token);
+
+  // Lets a submission wait for the batch with token on the GPU instead,
+  // submitting the batch first if it's still being recorded.
+  vk::SemaphoreSubmitInfo wait_info(
+      std::uint64_t token,
+      vk::PipelineStageFlags2 stages);
+
+ private:
+  struct Batch {
+    std::uint64_t token = 0;
+    // Ring position one past the batch's last staged byte.
+    std::uint64_t ring_end = 0;
+    vk::DeviceSize staged_bytes = 0;
+    vk::raii::CommandBuffer command_buffer = nullptr;
+    std::vector<vma::Buffer> dedicated_staging;
+  };
+
+  void begin_batch();
+  Staging stage_dedicated(vk::DeviceSize size);
+  void make_room();
+  bool retire_completed();
+
+  Device* device_ = nullptr;
+  vma::Buffer ring_ = nullptr;
+  std::byte* ring_data_ = nullptr;
+  vk::DeviceSize ring_size_ = 0;
+  // Positions only ever grow; the offset into the ring is the position
+  // modulo its size. Everything from tail to head is still in use.
+  std::uint64_t ring_head_ = 0;
+  std::uint64_t ring_tail_ = 0;
+  vk::raii::Semaphore timeline_ = nullptr;
+  vk::raii::CommandPool command_pool_ = nullptr;
+  std::vector<vk::raii::CommandBuffer> free_command_buffers_;
+  std::deque<Batch> in_flight_;
+  std::optional<Batch> current_;
+  std::uint64_t submitted_token_ = 0;
+};
+
+} // namespace rndrx::vulkan
+
+#endif // RNDRX_VULKAN_UPLOADQUEUE_HPP_
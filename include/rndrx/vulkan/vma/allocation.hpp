@@ -0,0 +1,59 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef RNDRX_VULKAN_VMA_ALLOCATION_HPP_
+#define RNDRX_VULKAN_VMA_ALLOCATION_HPP_
+#pragma once
+
+#include <cstddef>
+#include <vulkan/vulkan.hpp>
+#include "rndrx/noncopyable.hpp"
+#include "vk_mem_alloc.h"
+
+namespace rndrx::vulkan::vma {
+
+class Allocator;
+
+// A raw block of device memory that resources can be bound into at
+// arbitrary offsets. Used to alias resources whose lifetimes don't overlap.
+class Allocation : noncopyable {
+ public:
+  Allocation(std::nullptr_t){};
+  Allocation(Allocator& allocator, vk::MemoryRequirements const& requirements);
+  ~Allocation();
+
+  Allocation(Allocation&&);
+  Allocation& operator=(Allocation&&);
+
+  VmaAllocation vma() const {
+    return allocation_;
+  }
+
+  vk::DeviceSize size() const {
+    return info_.size;
+  }
+
+  std::uint32_t memory_type() const {
+    return info_.memoryType;
+  }
+
+ private:
+  void clear();
+  Allocator* allocator_ = nullptr;
+  VmaAllocation allocation_ = nullptr;
+  VmaAllocationInfo info_ = {};
+};
+
+} // namespace rndrx::vulkan::vma
+
+#endif // RNDRX_VULKAN_VMA_ALLOCATION_HPP_
@@ -36,6 +36,7 @@ class Device;
 
 namespace rndrx::vulkan::vma {
 
+class Allocation;
 class Image;
 class Buffer;
 
@@ -59,7 +60,15 @@ class Allocator : noncopyable {
     return allocator_;
   }
 
+  Allocation allocate_memory(vk::MemoryRequirements const& requirements);
   Image create_image(vk::ImageCreateInfo const& create_info);
+  Image create_image(
+      vk::ImageCreateInfo const& create_info,
+      VmaAllocationCreateInfo const& allocation_create_info);
+  Image create_image(
+      vk::ImageCreateInfo const& create_info,
+      Allocation const& memory,
+      vk::DeviceSize offset);
   Buffer create_buffer(vk::BufferCreateInfo const& create_info);
 
  private:
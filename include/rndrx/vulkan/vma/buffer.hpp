@@ -31,7 +31,12 @@ class Allocator;
 class Buffer : noncopyable {
  public:
   Buffer(std::nullptr_t){};
+  // Host visible and persistently mapped.
   Buffer(Allocator& allocator, vk::BufferCreateInfo const& create_info);
+  Buffer(
+      Allocator& allocator,
+      vk::BufferCreateInfo const& create_info,
+      VmaAllocationCreateInfo const& allocation_create_info);
   ~Buffer();
 
   Buffer(Buffer&&) = default;
@@ -41,6 +46,13 @@ class Buffer : noncopyable {
     return info_.pMappedData;
   }
 
+  // Makes device writes visible through mapped_data() on memory that
+  // isn't host coherent.
+  void invalidate();
+  // Makes host writes through mapped_data() visible to the device on
+  // memory that isn't host coherent.
+  void flush();
+
   vk::raii::Buffer const& vk() const {
     return buffer_;
   }
@@ -29,12 +29,24 @@ namespace rndrx::vulkan {
 class Device;
 
 namespace vma {
+class Allocation;
 class Allocator;
 
 class Image : noncopyable {
  public:
   Image(std::nullptr_t){};
   Image(Allocator& allocator, vk::ImageCreateInfo const& create_info);
+  Image(
+      Allocator& allocator,
+      vk::ImageCreateInfo const& create_info,
+      VmaAllocationCreateInfo const& allocation_create_info);
+  // Creates an image placed at offset within memory. The image does not own
+  // the memory, which must outlive it.
+  Image(
+      Allocator& allocator,
+      vk::ImageCreateInfo const& create_info,
+      Allocation const& memory,
+      vk::DeviceSize offset);
   ~Image();
 
   Image(Image&&) = default;
@@ -35,11 +35,29 @@ FrameGraphAttachmentOutputDescription& FrameGraphAttachmentOutputDescription::fo
 
 FrameGraphAttachmentOutputDescription&
 FrameGraphAttachmentOutputDescription::resolution(int width, int height) {
+  size_mode_ = FrameGraphSizeMode::Absolute;
   width_ = width;
   height_ = height;
   return *this;
 }
 
+FrameGraphAttachmentOutputDescription&
+FrameGraphAttachmentOutputDescription::output_relative_resolution(
+    float scale_x,
+    float scale_y) {
+  RNDRX_ASSERT(scale_x > 0.f && scale_y > 0.f);
+  size_mode_ = FrameGraphSizeMode::OutputRelative;
+  scale_x_ = scale_x;
+  scale_y_ = scale_y;
+  return *this;
+}
+
+FrameGraphAttachmentOutputDescription&
+FrameGraphAttachmentOutputDescription::output_relative_resolution(
+    float scale) {
+  return output_relative_resolution(scale, scale);
+}
+
 FrameGraphAttachmentOutputDescription& FrameGraphAttachmentOutputDescription::load_op(
     AttachmentLoadOp op) {
   load_op_ = op;
@@ -64,6 +82,36 @@ FrameGraphAttachmentOutputDescription::clear_stencil(int stencil) {
   return *this;
 }
 
+FrameGraphAttachmentOutputDescription&
+FrameGraphAttachmentOutputDescription::history(bool enabled) {
+  history_ = enabled;
+  return *this;
+}
+
+FrameGraphAttachmentOutputDescription&
+FrameGraphAttachmentOutputDescription::imported(bool enabled) {
+  imported_ = enabled;
+  return *this;
+}
+
+FrameGraphInputImageDescription&
+FrameGraphInputImageDescription::previous_frame(bool enabled) {
+  previous_frame_ = enabled;
+  return *this;
+}
+
+FrameGraphBufferDescription& FrameGraphBufferDescription::size(
+    std::size_t bytes) {
+  size_ = bytes;
+  return *this;
+}
+
+FrameGraphBufferDescription& FrameGraphBufferDescription::usage(
+    BufferUsage usage) {
+  usage_ = usage;
+  return *this;
+}
+
 FrameGraphRenderPassDescription& FrameGraphRenderPassDescription::add_input(
     FrameGraphInputDescription desc) {
   inputs_.push_back(std::move(desc));
@@ -76,10 +124,21 @@ FrameGraphRenderPassDescription& FrameGraphRenderPassDescription::add_output(
   return *this;
 }
 
+FrameGraphRenderPassDescription& FrameGraphRenderPassDescription::type(
+    FrameGraphPassType type) {
+  type_ = type;
+  return *this;
+}
+
 FrameGraphDescription& FrameGraphDescription::add_render_pass(
     FrameGraphRenderPassDescription render_pass) {
   render_passes_.push_back(std::move(render_pass));
   return *this;
 }
 
+FrameGraphDescription& FrameGraphDescription::add_sink(std::string resource_name) {
+  sinks_.push_back(std::move(resource_name));
+  return *this;
+}
+
 } // namespace rndrx
\ No newline at end of file
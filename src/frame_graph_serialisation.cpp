@@ -0,0 +1,399 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "rndrx/frame_graph_serialisation.hpp"
+
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include "json.hpp" // nlohmann::json, which comes with tinygltf.
+#include "rndrx/assert.hpp"
+#include "rndrx/log.hpp"
+#include "rndrx/throw_exception.hpp"
+
+namespace rndrx {
+
+namespace {
+using json = nlohmann::json;
+
+template <typename Enum>
+struct EnumName {
+  Enum value;
+  std::string_view name;
+};
+
+constexpr EnumName<FrameGraphPassType> kPassTypeNames[] = {
+    {FrameGraphPassType::Graphics, "Graphics"},
+    {FrameGraphPassType::Compute, "Compute"},
+    {FrameGraphPassType::AsyncCompute, "AsyncCompute"},
+};
+
+constexpr EnumName<AttachmentLoadOp> kLoadOpNames[] = {
+    {AttachmentLoadOp::Load, "Load"},
+    {AttachmentLoadOp::Clear, "Clear"},
+    {AttachmentLoadOp::DontCare, "DontCare"},
+    {AttachmentLoadOp::None, "None"},
+};
+
+constexpr EnumName<BufferUsage> kBufferUsageNames[] = {
+    {BufferUsage::Uniform, "Uniform"},
+    {BufferUsage::Storage, "Storage"},
+    {BufferUsage::Indirect, "Indirect"},
+    {BufferUsage::Vertex, "Vertex"},
+    {BufferUsage::Index, "Index"},
+    {BufferUsage::TransferSrc, "TransferSrc"},
+    {BufferUsage::TransferDst, "TransferDst"},
+};
+
+template <typename Enum, std::size_t N>
+std::string enum_name(EnumName<Enum> const (&names)[N], Enum value) {
+  for(auto&& name : names) {
+    if(name.value == value) {
+      return std::string(name.name);
+    }
+  }
+
+  RNDRX_UNREACHABLE;
+}
+
+template <typename Enum, std::size_t N>
+Enum enum_value(
+    EnumName<Enum> const (&names)[N],
+    std::string_view name,
+    std::string_view what) {
+  for(auto&& entry : names) {
+    if(entry.name == name) {
+      return entry.value;
+    }
+  }
+
+  RNDRX_THROW_RUNTIME_ERROR() << "Unknown " << what << " " << quote(name)
+                              << ".";
+}
+
+json write_buffer_usage(BufferUsage usage) {
+  json out = json::array();
+  for(auto&& entry : kBufferUsageNames) {
+    if(has_usage(usage, entry.value)) {
+      out.push_back(std::string(entry.name));
+    }
+  }
+
+  return out;
+}
+
+BufferUsage read_buffer_usage(json const& in) {
+  BufferUsage usage = BufferUsage::None;
+  for(auto&& name : in) {
+    usage = usage | enum_value(
+                        kBufferUsageNames,
+                        name.get<std::string>(),
+                        "buffer usage");
+  }
+
+  return usage;
+}
+
+struct ResourceWriter {
+  json operator()(FrameGraphAttachmentInputDescription const& input) const {
+    return {{"kind", "attachment"}, {"name", std::string(input.name())}};
+  }
+
+  json operator()(FrameGraphInputImageDescription const& input) const {
+    json out = {{"kind", "image"}, {"name", std::string(input.name())}};
+    if(input.previous_frame()) {
+      out["previous_frame"] = true;
+    }
+
+    return out;
+  }
+
+  json operator()(FrameGraphBufferDescription const& buffer) const {
+    // Only the name is used when the buffer is an input, but writing the
+    // rest either way keeps the two cases alike.
+    json out = {{"kind", "buffer"}, {"name", std::string(buffer.name())}};
+    if(buffer.size() != 0) {
+      out["size"] = buffer.size();
+    }
+
+    if(buffer.usage() != BufferUsage::Storage) {
+      out["usage"] = write_buffer_usage(buffer.usage());
+    }
+
+    return out;
+  }
+
+  json operator()(FrameGraphAttachmentOutputDescription const& output) const {
+    json out = {
+        {"kind", "attachment"},
+        {"name", std::string(output.name())},
+        {"format", std::string(to_string(output.format()))}};
+    if(output.size_mode() == FrameGraphSizeMode::Absolute) {
+      out["resolution"] = {output.width(), output.height()};
+    }
+    else if(output.scale_x() != 1.f || output.scale_y() != 1.f) {
+      out["scale"] = {output.scale_x(), output.scale_y()};
+    }
+
+    if(output.load_op() != AttachmentLoadOp::DontCare) {
+      out["load_op"] = enum_name(kLoadOpNames, output.load_op());
+    }
+
+    glm::vec4 const colour = output.clear_colour();
+    if(colour != glm::vec4(0.f)) {
+      out["clear_colour"] = {colour.r, colour.g, colour.b, colour.a};
+    }
+
+    if(output.clear_depth() != 0.f) {
+      out["clear_depth"] = output.clear_depth();
+    }
+
+    if(output.clear_stencil() != 0) {
+      out["clear_stencil"] = output.clear_stencil();
+    }
+
+    if(output.history()) {
+      out["history"] = true;
+    }
+
+    if(output.imported()) {
+      out["imported"] = true;
+    }
+
+    return out;
+  }
+};
+
+FrameGraphBufferDescription read_buffer(json const& in) {
+  FrameGraphBufferDescription buffer(in.at("name").get<std::string>());
+  buffer.size(in.value("size", std::size_t(0)));
+  if(in.contains("usage")) {
+    buffer.usage(read_buffer_usage(in.at("usage")));
+  }
+
+  return buffer;
+}
+
+FrameGraphAttachmentOutputDescription read_attachment(json const& in) {
+  FrameGraphAttachmentOutputDescription attachment(
+      in.at("name").get<std::string>());
+
+  std::string const format_name = in.at("format").get<std::string>();
+  std::optional<ImageFormat> format = image_format_from_string(format_name);
+  if(!format) {
+    RNDRX_THROW_RUNTIME_ERROR() << "Unknown format " << quote(format_name)
+                                << " for attachment "
+                                << quote(attachment.name()) << ".";
+  }
+
+  attachment.format(*format);
+
+  if(in.contains("resolution")) {
+    json const& resolution = in.at("resolution");
+    attachment.resolution(
+        resolution.at(0).get<int>(),
+        resolution.at(1).get<int>());
+  }
+  else if(in.contains("scale")) {
+    json const& scale = in.at("scale");
+    float const scale_x = scale.at(0).get<float>();
+    float const scale_y = scale.at(1).get<float>();
+    if(scale_x <= 0.f || scale_y <= 0.f) {
+      RNDRX_THROW_RUNTIME_ERROR() << "Attachment " << quote(attachment.name())
+                                  << " has a non-positive scale.";
+    }
+
+    attachment.output_relative_resolution(scale_x, scale_y);
+  }
+
+  if(in.contains("load_op")) {
+    attachment.load_op(enum_value(
+        kLoadOpNames,
+        in.at("load_op").get<std::string>(),
+        "load op"));
+  }
+
+  if(in.contains("clear_colour")) {
+    json const& colour = in.at("clear_colour");
+    attachment.clear_colour(glm::vec4(
+        colour.at(0).get<float>(),
+        colour.at(1).get<float>(),
+        colour.at(2).get<float>(),
+        colour.at(3).get<float>()));
+  }
+
+  attachment.clear_depth(in.value("clear_depth", 0.f));
+  attachment.clear_stencil(in.value("clear_stencil", 0));
+  attachment.history(in.value("history", false));
+  attachment.imported(in.value("imported", false));
+  return attachment;
+}
+
+FrameGraphInputDescription read_input(json const& in) {
+  std::string const kind = in.at("kind").get<std::string>();
+  if(kind == "attachment") {
+    return FrameGraphAttachmentInputDescription(
+        in.at("name").get<std::string>());
+  }
+
+  if(kind == "image") {
+    return FrameGraphInputImageDescription(in.at("name").get<std::string>())
+        .previous_frame(in.value("previous_frame", false));
+  }
+
+  if(kind == "buffer") {
+    return read_buffer(in);
+  }
+
+  RNDRX_THROW_RUNTIME_ERROR() << "Unknown input kind " << quote(kind) << ".";
+}
+
+FrameGraphOutputDescription read_output(json const& in) {
+  std::string const kind = in.at("kind").get<std::string>();
+  if(kind == "attachment") {
+    return read_attachment(in);
+  }
+
+  if(kind == "buffer") {
+    return read_buffer(in);
+  }
+
+  RNDRX_THROW_RUNTIME_ERROR() << "Unknown output kind " << quote(kind) << ".";
+}
+} // namespace
+
+std::string to_json(FrameGraphDescription const& description) {
+  json passes = json::array();
+  for(auto&& pass : description.passes()) {
+    json out = {{"name", std::string(pass.name())}};
+    if(pass.type() != FrameGraphPassType::Graphics) {
+      out["type"] = enum_name(kPassTypeNames, pass.type());
+    }
+
+    json inputs = json::array();
+    for(auto&& input : pass.inputs()) {
+      inputs.push_back(std::visit(ResourceWriter(), input));
+    }
+
+    json outputs = json::array();
+    for(auto&& output : pass.outputs()) {
+      outputs.push_back(std::visit(ResourceWriter(), output));
+    }
+
+    out["inputs"] = std::move(inputs);
+    out["outputs"] = std::move(outputs);
+    passes.push_back(std::move(out));
+  }
+
+  json root = {{"passes", std::move(passes)}};
+  if(!description.sinks().empty()) {
+    json sinks = json::array();
+    for(auto&& sink : description.sinks()) {
+      sinks.push_back(sink);
+    }
+
+    root["sinks"] = std::move(sinks);
+  }
+
+  return root.dump(2);
+}
+
+FrameGraphDescription parse_frame_graph_description(std::string_view text) {
+  FrameGraphDescription description;
+  try {
+    json const root = json::parse(text.begin(), text.end());
+    for(auto&& in : root.at("passes")) {
+      FrameGraphRenderPassDescription pass(in.at("name").get<std::string>());
+      if(in.contains("type")) {
+        pass.type(enum_value(
+            kPassTypeNames,
+            in.at("type").get<std::string>(),
+            "pass type"));
+      }
+
+      for(auto&& input : in.value("inputs", json::array())) {
+        pass.add_input(read_input(input));
+      }
+
+      for(auto&& output : in.value("outputs", json::array())) {
+        pass.add_output(read_output(output));
+      }
+
+      description.add_render_pass(std::move(pass));
+    }
+
+    for(auto&& sink : root.value("sinks", json::array())) {
+      description.add_sink(sink.get<std::string>());
+    }
+  }
+  catch(json::exception const& e) {
+    RNDRX_THROW_RUNTIME_ERROR() << "Malformed frame graph: " << e.what();
+  }
+
+  return description;
+}
+
+void save_frame_graph_description(
+    FrameGraphDescription const& description,
+    std::filesystem::path const& path) {
+  std::ofstream outstream(path);
+  outstream << to_json(description);
+  if(!outstream) {
+    RNDRX_THROW_RUNTIME_ERROR() << "Failed to write " << quote(path.string())
+                                << ".";
+  }
+}
+
+FrameGraphDescription load_frame_graph_description(
+    std::filesystem::path const& path) {
+  std::ifstream instream(path);
+  if(!instream) {
+    RNDRX_THROW_RUNTIME_ERROR() << "Failed to open " << quote(path.string())
+                                << ".";
+  }
+
+  std::stringstream text;
+  text << instream.rdbuf();
+  return parse_frame_graph_description(text.str());
+}
+
+FrameGraphDescriptionWatcher::FrameGraphDescriptionWatcher(
+    std::filesystem::path path)
+    : path_(std::move(path)) {
+  // Only changes from here on are reported.
+  std::error_code ec;
+  last_write_time_ = std::filesystem::last_write_time(path_, ec);
+}
+
+std::optional<FrameGraphDescription> FrameGraphDescriptionWatcher::poll() {
+  std::error_code ec;
+  std::filesystem::file_time_type write_time =
+      std::filesystem::last_write_time(path_, ec);
+  if(ec || write_time == last_write_time_) {
+    return std::nullopt;
+  }
+
+  last_write_time_ = write_time;
+  try {
+    return load_frame_graph_description(path_);
+  }
+  catch(std::exception const& e) {
+    LOG(Error) << "Failed to reload " << quote(path_.string()) << ": "
+               << e.what();
+    return std::nullopt;
+  }
+}
+
+} // namespace rndrx
@@ -0,0 +1,53 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "rndrx/frame_limiter.hpp"
+
+#include <thread>
+
+namespace rndrx {
+
+FrameLimiter::FrameLimiter(double max_fps, Clock::duration spin_threshold)
+    : spin_threshold_(spin_threshold) {
+  if(max_fps > 0) {
+    period_ = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / max_fps));
+  }
+}
+
+void FrameLimiter::wait() {
+  if(!is_enabled()) {
+    return;
+  }
+
+  Clock::time_point now = Clock::now();
+  if(next_frame_ == Clock::time_point()) {
+    next_frame_ = now + period_;
+    return;
+  }
+
+  if(next_frame_ - now > spin_threshold_) {
+    std::this_thread::sleep_for(next_frame_ - now - spin_threshold_);
+  }
+
+  while((now = Clock::now()) < next_frame_) {
+    std::this_thread::yield();
+  }
+
+  next_frame_ += period_;
+  if(next_frame_ < now) {
+    next_frame_ = now + period_;
+  }
+}
+
+} // namespace rndrx
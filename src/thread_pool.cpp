@@ -0,0 +1,117 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "rndrx/thread_pool.hpp"
+
+#include <utility>
+
+namespace rndrx {
+
+ThreadPool::ThreadPool(std::size_t num_workers) {
+  workers_.reserve(num_workers);
+  for(std::size_t i = 0; i < num_workers; ++i) {
+    workers_.emplace_back([this, i] { worker_main(i + 1); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+
+  work_available_.notify_all();
+  for(auto&& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::parallel_for(std::size_t count, Job const& job) {
+  if(count == 0) {
+    return;
+  }
+
+  // Not worth waking anyone.
+  if(workers_.empty() || count == 1) {
+    for(std::size_t i = 0; i < count; ++i) {
+      job(i, 0);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job_ = &job;
+    job_count_ = count;
+    next_job_ = 0;
+    active_workers_ = workers_.size();
+    exception_ = nullptr;
+    ++generation_;
+  }
+
+  work_available_.notify_all();
+  run_jobs(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  work_done_.wait(lock, [this] { return active_workers_ == 0; });
+  job_ = nullptr;
+  if(exception_) {
+    std::rethrow_exception(std::exchange(exception_, nullptr));
+  }
+}
+
+void ThreadPool::worker_main(std::size_t thread_idx) {
+  std::uint64_t seen_generation = 0;
+  while(true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_available_.wait(lock, [this, seen_generation] {
+        return stop_ || generation_ != seen_generation;
+      });
+
+      if(stop_) {
+        return;
+      }
+
+      seen_generation = generation_;
+    }
+
+    run_jobs(thread_idx);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(--active_workers_ == 0) {
+      work_done_.notify_one();
+    }
+  }
+}
+
+void ThreadPool::run_jobs(std::size_t thread_idx) {
+  while(true) {
+    std::size_t job_idx = next_job_.fetch_add(1);
+    if(job_idx >= job_count_) {
+      return;
+    }
+
+    try {
+      (*job_)(job_idx, thread_idx);
+    }
+    catch(...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if(!exception_) {
+        exception_ = std::current_exception();
+      }
+    }
+  }
+}
+
+} // namespace rndrx
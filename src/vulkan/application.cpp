@@ -16,12 +16,19 @@
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan_core.h>
 #include <chrono>
+#include <deque>
+#include <exception>
 #include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
 #include "glm/ext/vector_float4.hpp"
 #include "imgui.h"
 #include "rndrx/assert.hpp"
 #include "rndrx/attachment_ops.hpp"
 #include "rndrx/frame_graph_description.hpp"
+#include "rndrx/frame_limiter.hpp"
+#include "rndrx/handoff.hpp"
 #include "rndrx/log.hpp"
 #include "rndrx/scope_exit.hpp"
 #include "rndrx/throw_exception.hpp"
@@ -30,13 +37,17 @@
 #include "rndrx/vulkan/device.hpp"
 #include "rndrx/vulkan/frame_graph.hpp"
 #include "rndrx/vulkan/frame_graph_builder.hpp"
+#include "rndrx/vulkan/frame_graph_profiler.hpp"
+#include "rndrx/vulkan/frame_timeline.hpp"
 #include "rndrx/vulkan/imgui_render_pass.hpp"
 #include "rndrx/vulkan/model.hpp"
+#include "rndrx/vulkan/offscreen_queue.hpp"
 #include "rndrx/vulkan/render_context.hpp"
 #include "rndrx/vulkan/renderer.hpp"
 #include "rndrx/vulkan/shader_cache.hpp"
 #include "rndrx/vulkan/submission_context.hpp"
 #include "rndrx/vulkan/swapchain.hpp"
+#include "rndrx/vulkan/upload_queue.hpp"
 #include "rndrx/vulkan/window.hpp"
 
 #include "rndrx/vulkan/gltf_model_creator.hpp"
@@ -76,9 +87,17 @@ std::array<char const*, 1> constexpr kValidationLayers = {
 
 } // namespace
 
-Application::Application() {
+Application::Application(ApplicationConfig const& config)
+    : config_(config) {
+  if(!config_.headless) {
+    window_.emplace();
+  }
+
   create_instance();
-  create_surface();
+  if(!config_.headless) {
+    create_surface();
+  }
+
   select_device();
 }
 
@@ -97,6 +116,29 @@ std::uint32_t Application::find_graphics_queue_family_idx() const {
   return std::distance(queue_family_properties.begin(), graphics_queue);
 }
 
+std::uint32_t Application::find_compute_queue_family_idx() const {
+  auto queue_family_properties = selected_device().getQueueFamilyProperties();
+
+  // Prefer a family without graphics so work can overlap with rendering.
+  auto compute_queue = std::ranges::find_if(
+      queue_family_properties,
+      [](vk::QueueFamilyProperties const& props) {
+        if(props.queueFlags & vk::QueueFlagBits::eGraphics) {
+          return false;
+        }
+
+        return (props.queueFlags & vk::QueueFlagBits::eCompute) ==
+               vk::QueueFlagBits::eCompute;
+      });
+
+  // Otherwise, compute work shares the graphics queue.
+  if(compute_queue == queue_family_properties.end()) {
+    return find_graphics_queue_family_idx();
+  }
+
+  return std::distance(queue_family_properties.begin(), compute_queue);
+}
+
 std::uint32_t Application::find_transfer_queue_family_idx() const {
   auto queue_family_properties = selected_device().getQueueFamilyProperties();
 
@@ -157,9 +199,14 @@ std::uint32_t Application::find_transfer_queue_family_idx() const {
 }
 
 std::vector<char const*> Application::get_required_instance_extensions() const {
-  std::uint32_t glfw_ext_count = 0;
-  char const** glfw_exts = glfwGetRequiredInstanceExtensions(&glfw_ext_count);
-  std::vector<char const*> extensions(glfw_exts, glfw_exts + glfw_ext_count);
+  std::vector<char const*> extensions;
+  if(!config_.headless) {
+    std::uint32_t glfw_ext_count = 0;
+    char const** glfw_exts = glfwGetRequiredInstanceExtensions(
+        &glfw_ext_count);
+    extensions.assign(glfw_exts, glfw_exts + glfw_ext_count);
+  }
+
 #if RNDRX_ENABLE_VULKAN_DEBUG_LAYER
   extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #endif
@@ -168,14 +215,12 @@ std::vector<char const*> Application::get_required_instance_extensions() const {
 }
 
 std::vector<char const*> Application::get_required_device_extensions() const {
-  std::vector<char const*> extensions = {
-      VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-      VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
-      VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
-      VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,
-      VK_KHR_MULTIVIEW_EXTENSION_NAME,
-      VK_KHR_MAINTENANCE_2_EXTENSION_NAME,
-  };
+  // Everything else is core in Vulkan 1.3.
+  std::vector<char const*> extensions;
+  if(!config_.headless) {
+    extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+  }
+
   return extensions;
 }
 
@@ -222,11 +267,14 @@ void Application::run() {
 }
 
 void Application::main_loop() {
-  std::array<SubmissionContext, 3> submission_contexts = {{
-      SubmissionContext(device()),
-      SubmissionContext(device()),
-      SubmissionContext(device()),
-  }};
+  // Declared first so the contexts are destroyed, waiting for their
+  // frames, before the timeline.
+  FrameTimeline timeline(device());
+  // A deque as contexts can't be moved once constructed.
+  std::deque<SubmissionContext> submission_contexts;
+  for(std::uint32_t i = 0; i < frames_in_flight_; ++i) {
+    submission_contexts.emplace_back(device(), timeline);
+  }
 
   initialise_device_resources(submission_contexts[0]);
 
@@ -234,10 +282,69 @@ void Application::main_loop() {
   auto scope_exit_set_status = on_scope_exit(
       [this] { run_status_ = RunStatus::ShuttingDown; });
 
+  // Each context waits in begin_rendering for the frame it recorded
+  // frames_in_flight frames ago, which is what paces the CPU.
+  auto render_frame = [&](FrameSnapshot const& snapshot) {
+    auto submission_index = timeline.current_frame() %
+                            submission_contexts.size();
+    render(submission_contexts[submission_index], snapshot);
+  };
+
+  // When pipelined, the render thread records frame N while this thread
+  // updates frame N+1. The single slot handoff keeps the update from
+  // getting more than one frame ahead.
+  Handoff<FrameSnapshot> snapshots;
+  std::exception_ptr render_error;
+  std::thread render_thread;
+  if(config_.pipelined_rendering) {
+    render_thread = std::thread([&] {
+      try {
+        while(auto snapshot = snapshots.pop()) {
+          render_frame(*snapshot);
+        }
+      }
+      catch(...) {
+        render_error = std::current_exception();
+      }
+
+      snapshots.close();
+    });
+  }
+
+  auto stop_render_thread = [&] {
+    if(render_thread.joinable()) {
+      snapshots.close();
+      render_thread.join();
+    }
+  };
+  auto scope_exit_stop_render_thread = on_scope_exit(stop_render_thread);
+
+  FrameLimiter limiter(config_.max_fps);
+  std::uint64_t const first_frame_index = timeline.current_frame() + 1;
   auto last_frame_ts = std::chrono::high_resolution_clock::now();
-  std::uint32_t frame_id = 0;
-  while(!glfwWindowShouldClose(window_.glfw())) {
-    glfwPollEvents();
+  std::uint64_t frame_count = 0;
+  bool resized = false;
+  while(!should_exit(frame_count)) {
+    limiter.wait();
+
+    // The same wait begin_rendering would do, moved ahead of sampling
+    // input so the frame is recorded right after it.
+    std::uint64_t const frame_index = first_frame_index + frame_count;
+    if(config_.low_latency && frame_index > frames_in_flight_) {
+      timeline.wait(frame_index - frames_in_flight_);
+    }
+
+    auto input_time = std::chrono::steady_clock::now();
+    if(window_) {
+      glfwPollEvents();
+      resized |= window_->handle_window_size() == Window::SizeEvent::Changed;
+
+      // Nothing can be presented to a minimised window.
+      if(window_->width() == 0 || window_->height() == 0) {
+        glfwWaitEvents();
+        continue;
+      }
+    }
 
     on_begin_frame();
 
@@ -250,19 +357,81 @@ void Application::main_loop() {
     update(dt_s);
 
     if(run_result_ != RunResult::None) {
-      return;
+      break;
     }
 
-    auto submission_index = frame_id % submission_contexts.size();
-    SubmissionContext& sc = submission_contexts[submission_index];
-    render(sc);
+    FrameSnapshot snapshot;
+    snapshot.frame_number = frame_count;
+    snapshot.dt_s = dt_s;
+    snapshot.extents = render_extents();
+    snapshot.resized = resized;
+    snapshot.input_time = input_time;
+    snapshot.ui = std::move(ui_frame_);
+    resized = false;
+    if(!config_.pipelined_rendering) {
+      render_frame(snapshot);
+    }
+    else if(!snapshots.push(snapshot)) {
+      // The render thread stopped on an error.
+      break;
+    }
 
     on_end_frame();
+    ++frame_count;
+  }
 
-    ++frame_id;
+  stop_render_thread();
+  if(render_error) {
+    std::rethrow_exception(render_error);
   }
 
-  run_result_ = RunResult::Exit;
+  // Hand out the frames still in flight.
+  if(renderer_->is_headless()) {
+    timeline.wait_idle();
+    poll_readbacks(timeline);
+  }
+
+  if(run_result_ == RunResult::None) {
+    run_result_ = RunResult::Exit;
+  }
+}
+
+bool Application::should_exit(std::uint64_t frame_count) const {
+  if(config_.max_frames != 0 && frame_count >= config_.max_frames) {
+    return true;
+  }
+
+  return window_ && glfwWindowShouldClose(window_->glfw());
+}
+
+vk::Rect2D Application::render_extents() const {
+  if(!window_) {
+    return vk::Rect2D({0, 0}, config_.headless_extent);
+  }
+
+  return window_->extents();
+}
+
+void Application::record_input_latency(FrameSnapshot const& snapshot) {
+  // Weight of the latest frame in the moving average.
+  constexpr double kAverageWeight = 0.05;
+  double const latency_ms = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() -
+                                snapshot.input_time)
+                                .count();
+  double const average = average_input_latency_ms_.load(
+      std::memory_order_relaxed);
+  input_latency_ms_.store(latency_ms, std::memory_order_relaxed);
+  average_input_latency_ms_.store(
+      average == 0 ? latency_ms
+                   : average + (latency_ms - average) * kAverageWeight,
+      std::memory_order_relaxed);
+}
+
+void Application::poll_readbacks(FrameTimeline const& timeline) {
+  while(auto readback = renderer_->poll_readback(timeline)) {
+    on_readback(*readback);
+  }
 }
 
 Device& Application::device() {
@@ -326,7 +495,7 @@ void Application::create_instance() {
 
 void Application::create_surface() {
   VkSurfaceKHR surface;
-  if(glfwCreateWindowSurface(*instance_, window_.glfw(), nullptr, &surface) !=
+  if(glfwCreateWindowSurface(*instance_, window_->glfw(), nullptr, &surface) !=
      VK_SUCCESS) {
     throw_runtime_error("failed to create window surface!");
   }
@@ -353,7 +522,8 @@ void Application::select_device() {
             });
 
         auto features = dev.getFeatures();
-        return has_all_required_extensions && features.samplerAnisotropy;
+        return has_all_required_extensions && features.samplerAnisotropy &&
+               dev.getProperties().apiVersion >= VK_API_VERSION_1_3;
       }) |
       to_vector;
 }
@@ -375,14 +545,16 @@ void Application::initialise_device_resources(SubmissionContext& ctx) {
   ctx.begin_rendering(vk::Rect2D());
   on_begin_initialise_device_resources(ctx);
   ctx.finish_rendering();
-  ctx.wait_for_fence();
+  ctx.wait_for_completion();
   on_end_initialise_device_resources();
 }
 
 void Application::update(float dt_s) {
   on_begin_update();
 
-  update_adapter_info(dt_s);
+  if(renderer_->ui()) {
+    update_adapter_info(dt_s);
+  }
 
   on_end_update();
 }
@@ -390,6 +562,11 @@ void Application::update(float dt_s) {
 void Application::update_adapter_info(float dt_s) {
   if(ImGui::Begin("Adapter Info")) {
     ImGui::LabelText("", "Framerate: %3.1ffps (%3.2fms)", 1 / dt_s, dt_s * 1000);
+    ImGui::LabelText(
+        "",
+        "Input latency: %3.2fms (avg %3.2fms)",
+        input_latency_ms(),
+        average_input_latency_ms());
     auto const& selected = selected_device();
     auto selected_properties = selected.getProperties();
     if(ImGui::BeginCombo("##name", selected_properties.deviceName)) {
@@ -409,19 +586,79 @@ void Application::update_adapter_info(float dt_s) {
     }
     ImGui::End();
   }
+
+  // The render thread owns the profiler when rendering is pipelined.
+  if(!config_.pipelined_rendering) {
+    if(FrameGraphProfiler const* profiler = renderer_->profiler()) {
+      profiler->draw_ui();
+    }
+  }
 }
 
-void Application::render(SubmissionContext& ctx) {
-  ctx.begin_rendering(window_.extents());
+void Application::render(
+    SubmissionContext& ctx,
+    FrameSnapshot const& snapshot) {
+  // Recreation also has to wait while the surface has no area, which the
+  // main loop's check of the window size doesn't always catch.
+  bool can_present = true;
+  if(!renderer_->is_headless() &&
+     (snapshot.resized || renderer_->needs_swapchain_recreation())) {
+    can_present = renderer_->recreate_swapchain(
+        *this,
+        snapshot.extents.extent);
+  }
+
+  ctx.begin_rendering(snapshot.extents);
   on_begin_render(ctx);
 
-  // PresentationContext present_ctx = device_objects_->present_queue.acquire_context();
-  // render_objects_->deferred_frame_graph->render(ctx);
-  // on_pre_present(ctx, present_ctx);
-  // ctx.finish_rendering();
-  // on_end_render(ctx);
-  // device_objects_->present_queue.present(present_ctx);
-  // on_post_present(present_ctx);
+  // The frame may use anything uploaded so far, including in
+  // on_begin_render.
+  UploadQueue& uploads = device().upload_queue();
+  std::uint64_t const upload_token = uploads.flush();
+  if(!uploads.is_complete(upload_token)) {
+    vk::SemaphoreSubmitInfo const wait = uploads.wait_info(
+        upload_token,
+        vk::PipelineStageFlagBits2::eAllCommands);
+    ctx.wait_before_next_submit(QueueType::Graphics, wait);
+    if(device().has_async_compute()) {
+      ctx.wait_before_next_submit(QueueType::Compute, wait);
+    }
+  }
+
+  if(renderer_->is_headless()) {
+    // Readbacks of the frame whose image is about to be reused have to be
+    // handed out first.
+    poll_readbacks(ctx.timeline());
+    renderer_->render_offscreen(ctx);
+    ctx.finish_rendering();
+    on_end_render(ctx);
+    return;
+  }
+
+  if(ImGuiRenderPass* ui = renderer_->ui()) {
+    ui->set_frame(snapshot.ui);
+  }
+
+  std::optional<PresentationContext> present_ctx;
+  if(can_present) {
+    present_ctx = renderer_->acquire_present_context();
+  }
+
+  if(!present_ctx) {
+    // Submitted anyway so the frame still reaches the timeline. The
+    // swapchain is recreated at the start of the next frame.
+    ctx.finish_rendering();
+    on_end_render(ctx);
+    return;
+  }
+
+  renderer_->render(ctx, *present_ctx);
+  on_pre_present(ctx, *present_ctx);
+  ctx.finish_rendering();
+  on_end_render(ctx);
+  renderer_->present(*present_ctx);
+  record_input_latency(snapshot);
+  on_post_present(*present_ctx);
 }
 
 void Application::on_pre_create_renderer(){};
@@ -508,21 +745,29 @@ void Application::on_renderer_created() {
 
 void Application::on_begin_initialise_device_resources(
     rndrx::vulkan::SubmissionContext& ctx) {
-  //render_objects_->imgui_render_pass.create_fonts_texture(ctx);
+  if(ImGuiRenderPass* ui = renderer_->ui()) {
+    ui->create_fonts_texture(ctx);
+  }
 }
 
 void Application::on_end_initialise_device_resources() {
-  //render_objects_->imgui_render_pass.finish_font_texture_creation();
+  if(ImGuiRenderPass* ui = renderer_->ui()) {
+    ui->finish_font_texture_creation();
+  }
 }
 
 void Application::on_begin_frame(){};
 
 void Application::on_begin_update() {
-  //render_objects_->imgui_render_pass.begin_frame();
+  if(ImGuiRenderPass* ui = renderer_->ui()) {
+    ui->begin_frame();
+  }
 }
 
 void Application::on_end_update() {
-  //render_objects_->imgui_render_pass.end_frame();
+  if(ImGuiRenderPass* ui = renderer_->ui()) {
+    ui_frame_ = ui->end_frame();
+  }
 }
 
 void Application::on_begin_render(rndrx::vulkan::SubmissionContext& sc) {
@@ -533,18 +778,23 @@ void Application::on_end_render(SubmissionContext&){};
 void Application::on_pre_present(
     rndrx::vulkan::SubmissionContext& sc,
     rndrx::vulkan::PresentationContext& pc) {
-  // rndrx::vulkan::RenderContext rc;
-  // rc.set_targets(window().extents(), pc.target().view(),
-  // pc.target().framebuffer()); final_composite_pass().render(rc, sc,
-  // {&render_objects_->composite_imgui, 1});
 }
 
 void Application::on_post_present(PresentationContext&){};
 
+void Application::on_readback(OffscreenReadback const&){};
+
 void Application::on_end_frame(){};
 
 void Application::on_pre_destroy_renderer() {
-
+  if(FrameGraphProfiler const* profiler = renderer_->profiler()) {
+    for(auto&& timing : profiler->timings()) {
+      if(timing.has_timestamps) {
+        LOG(Info) << "Frame graph node " << quote(timing.name) << ": "
+                  << timing.average_gpu_ms << "ms";
+      }
+    }
+  }
 }
 
 void Application::on_renderer_destroyed(){};
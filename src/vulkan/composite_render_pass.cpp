@@ -24,37 +24,67 @@
 
 namespace rndrx::vulkan {
 
-// void CompositeRenderPass::render(
-//     RenderContext& rc,
-//     SubmissionContext& sc,
-//     std::span<DrawItem> draw_list) {
-//   auto&& cb = sc.command_buffer();
-
-//   vk::ClearValue clear_value;
-//   clear_value.color.setFloat32({0, 1, 1, 0});
-
-//   sc.command_buffer().beginRenderPass(
-//       vk::RenderPassBeginInfo()
-//           .setRenderPass(*render_pass_)
-//           .setFramebuffer(rc.framebuffer())
-//           .setRenderArea(rc.extents())
-//           .setClearValues(clear_value),
-//       vk::SubpassContents::eInline);
-
-//   cb.bindPipeline(vk::PipelineBindPoint::eGraphics, *copy_image_pipeline_);
-
-//   for(auto&& item : draw_list) {
-//     item.draw(*this, sc);
-//   }
-
-//   sc.command_buffer().endRenderPass();
-// }
-
-void CompositeRenderPass::pre_render(SubmissionContext& sc) {
+void CompositeRenderPass::pre_render(
+    SubmissionContext& sc,
+    vk::CommandBuffer cmd) {
+}
+void CompositeRenderPass::render(
+    SubmissionContext& sc,
+    vk::CommandBuffer cmd) {
+  cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, *copy_image_pipeline_);
+  for(auto&& source_set : source_sets_) {
+    cmd.bindDescriptorSets(
+        vk::PipelineBindPoint::eGraphics,
+        *pipeline_layout_,
+        0,
+        *source_set,
+        {});
+    cmd.draw(3, 1, 0, 0);
+  }
 }
-void CompositeRenderPass::render(SubmissionContext& sc) {
+void CompositeRenderPass::post_render(
+    SubmissionContext& sc,
+    vk::CommandBuffer cmd) {
 }
-void CompositeRenderPass::post_render(SubmissionContext& sc) {
+
+void CompositeRenderPass::set_sources(
+    Device const& device,
+    std::span<vk::ImageView const> sources) {
+  if(!source_sets_.empty()) {
+    device.vk().waitIdle();
+    source_sets_.clear();
+  }
+
+  if(sources.empty()) {
+    return;
+  }
+
+  std::vector<vk::DescriptorSetLayout> layouts(
+      sources.size(),
+      *descriptor_layout_);
+  source_sets_ = device.vk().allocateDescriptorSets(
+      vk::DescriptorSetAllocateInfo()
+          .setDescriptorPool(device.descriptor_pool())
+          .setSetLayouts(layouts));
+
+  std::vector<vk::DescriptorImageInfo> image_infos;
+  std::vector<vk::WriteDescriptorSet> writes;
+  image_infos.reserve(sources.size());
+  writes.reserve(sources.size());
+  for(std::size_t i = 0; i < sources.size(); ++i) {
+    image_infos.push_back(
+        vk::DescriptorImageInfo()
+            .setImageView(sources[i])
+            .setImageLayout(vk::ImageLayout::eReadOnlyOptimal));
+    writes.push_back(
+        vk::WriteDescriptorSet()
+            .setDstSet(*source_sets_[i])
+            .setDstBinding(0)
+            .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+            .setImageInfo(image_infos.back()));
+  }
+
+  device.vk().updateDescriptorSets(writes, {});
 }
 
 // void CompositeRenderPass::create_render_pass(Device const& device, vk::Format present_format) {
@@ -109,7 +139,10 @@ void CompositeRenderPass::create_pipeline_layout(Device const& device) {
   pipeline_layout_ = device.vk().createPipelineLayout(layout_create_info);
 }
 
-void CompositeRenderPass::create_pipeline(Device const& device, ShaderCache const& sc) {
+void CompositeRenderPass::create_pipeline(
+    Device const& device,
+    vk::Format present_format,
+    ShaderCache const& sc) {
   std::array<vk::PipelineShaderStageCreateInfo, 2> stage_info;
   stage_info[0] //
       .setStage(vk::ShaderStageFlagBits::eVertex)
@@ -167,8 +200,14 @@ void CompositeRenderPass::create_pipeline(Device const& device, ShaderCache cons
   multisample_state_create_info //
       .setRasterizationSamples(vk::SampleCountFlagBits::e1);
 
+  // Drawn with dynamic rendering so there's no render pass to create the
+  // pipeline against, only the format of the target.
+  vk::PipelineRenderingCreateInfo rendering_create_info;
+  rendering_create_info.setColorAttachmentFormats(present_format);
+
   vk::GraphicsPipelineCreateInfo create_info;
   create_info //
+      .setPNext(&rendering_create_info)
       .setStages(stage_info)
       .setPVertexInputState(&vertex_input_state_create_info)
       .setPInputAssemblyState(&input_assembly_state_create_info)
@@ -177,57 +216,9 @@ void CompositeRenderPass::create_pipeline(Device const& device, ShaderCache cons
       .setPViewportState(&viewport_state_create_info)
       .setPMultisampleState(&multisample_state_create_info)
       .setPDynamicState(&dynamic_state_create_info)
-      .setLayout(*pipeline_layout_)
-      .setRenderPass(*render_pass_);
+      .setLayout(*pipeline_layout_);
 
   copy_image_pipeline_ = device.vk().createGraphicsPipeline(nullptr, create_info);
 }
 
-// void CompositeRenderPass::DrawItem::draw(
-//     CompositeRenderPass const& pass,
-//     SubmissionContext& sc) {
-//   auto&& cb = sc.command_buffer();
-//   cb.bindDescriptorSets(
-//       vk::PipelineBindPoint::eGraphics,
-//       *pass.pipeline_layout_,
-//       0,
-//       1,
-//       &*descriptor_set_,
-//       0,
-//       nullptr);
-//   sc.command_buffer().draw(3, 1, 0, 0);
-// }
-
-// void CompositeRenderPass::DrawItem::create_descriptor_set(
-//     Device& device,
-//     CompositeRenderPass const& parent_pass) {
-//   vk::DescriptorSetAllocateInfo alloc_info;
-//   alloc_info //
-//       .setDescriptorPool(device.descriptor_pool())
-//       .setSetLayouts(*parent_pass.descriptor_layout_);
-
-//   auto v = device.vk().allocateDescriptorSets(alloc_info);
-//   descriptor_set_ = std::move(v[0]);
-// }
-
-// void CompositeRenderPass::DrawItem::update_descriptor_set(
-//     Device& device,
-//     CompositeRenderPass const& parent_pass,
-//     vk::ImageView source) {
-//   vk::DescriptorImageInfo image_info;
-//   image_info //
-//       .setSampler(*parent_pass.sampler_)
-//       .setImageView(source)
-//       .setImageLayout(vk::ImageLayout::eReadOnlyOptimal);
-
-//   vk::WriteDescriptorSet write;
-//   write //
-//       .setDstSet(*descriptor_set_)
-//       .setDstBinding(0)
-//       .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-//       .setImageInfo(image_info);
-
-//   device.vk().updateDescriptorSets(write, {});
-// }
-
 } // namespace rndrx::vulkan
\ No newline at end of file
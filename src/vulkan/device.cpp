@@ -14,6 +14,7 @@
 #include "rndrx/vulkan/device.hpp"
 
 #include <vulkan/vulkan_core.h>
+#include <algorithm>
 #include <array>
 #include <vulkan/vulkan.hpp>
 #include "rndrx/vulkan/application.hpp"
@@ -24,60 +25,96 @@ Device::Device(Application const& app) {
   create_device(app);
   create_descriptor_pool();
   create_command_pools();
+  upload_queue_ = UploadQueue(*this);
 }
 
 void Device::create_device(Application const& app) {
   physical_device_ = *app.selected_device();
 
   queue_family_indices_.graphics = app.find_graphics_queue_family_idx();
+  queue_family_indices_.compute = app.find_compute_queue_family_idx();
   queue_family_indices_.transfer = app.find_transfer_queue_family_idx();
+
+  // Each role gets its own queue where the family has enough of them,
+  // otherwise roles in the same family share its last queue.
+  auto queue_family_properties = physical_device_.getQueueFamilyProperties();
+  std::vector<std::uint32_t> queue_counts(queue_family_properties.size(), 0);
+  auto request_queue = [&](std::uint32_t family) {
+    std::uint32_t queue_idx = std::min(
+        queue_counts[family],
+        queue_family_properties[family].queueCount - 1);
+    queue_counts[family] = queue_idx + 1;
+    return queue_idx;
+  };
+
+  std::uint32_t const graphics_queue_idx = request_queue(
+      queue_family_indices_.graphics);
+  std::uint32_t const compute_queue_idx =
+      queue_family_indices_.compute == queue_family_indices_.graphics
+          ? graphics_queue_idx
+          : request_queue(queue_family_indices_.compute);
+  std::uint32_t const transfer_queue_idx = request_queue(
+      queue_family_indices_.transfer);
+
+  std::vector<std::vector<float>> priorities(queue_counts.size());
   std::vector<vk::DeviceQueueCreateInfo> queue_create_infos;
+  for(std::uint32_t family = 0; family < queue_counts.size(); ++family) {
+    if(queue_counts[family] == 0) {
+      continue;
+    }
 
-  if(queue_family_indices_.graphics != queue_family_indices_.transfer) {
-    float const priority = 1.f;
+    priorities[family].resize(queue_counts[family], 1.f);
     queue_create_infos.push_back(
         vk::DeviceQueueCreateInfo()
-            .setQueueFamilyIndex(queue_family_indices_.graphics)
-            .setQueueCount(1)
-            .setPQueuePriorities(&priority));
-    queue_create_infos.push_back(
-        vk::DeviceQueueCreateInfo()
-            .setQueueFamilyIndex(queue_family_indices_.transfer)
-            .setQueueCount(1)
-            .setPQueuePriorities(&priority));
-  }
-  else {
-    std::array<float, 2> priorities = {1.f, 1.f};
-    queue_create_infos.push_back(
-        vk::DeviceQueueCreateInfo()
-            .setQueueFamilyIndex(queue_family_indices_.graphics)
-            .setQueueCount(2)
-            .setQueuePriorities(priorities));
+            .setQueueFamilyIndex(family)
+            .setQueuePriorities(priorities[family]));
   }
 
   auto required_extensions = app.get_required_device_extensions();
 
-  vk::StructureChain<vk::DeviceCreateInfo, vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan13Features>
+  // Optional, only used for profiling.
+  pipeline_statistics_query_ =
+      physical_device_.getFeatures().pipelineStatisticsQuery == VK_TRUE;
+
+  vk::PhysicalDeviceMemoryProperties memory_properties =
+      physical_device_.getMemoryProperties();
+  for(std::uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i) {
+    if(memory_properties.memoryTypes[i].propertyFlags &
+       vk::MemoryPropertyFlagBits::eLazilyAllocated) {
+      lazily_allocated_memory_ = true;
+    }
+  }
+
+  vk::StructureChain<
+      vk::DeviceCreateInfo,
+      vk::PhysicalDeviceFeatures2,
+      vk::PhysicalDeviceVulkan12Features,
+      vk::PhysicalDeviceVulkan13Features>
       create_info(               //
           vk::DeviceCreateInfo() //
               .setQueueCreateInfos(queue_create_infos)
               .setPEnabledExtensionNames(required_extensions),
           vk::PhysicalDeviceFeatures2().setFeatures( //
               vk::PhysicalDeviceFeatures()           //
-                  .setSamplerAnisotropy(VK_TRUE)),
+                  .setSamplerAnisotropy(VK_TRUE)
+                  .setPipelineStatisticsQuery(
+                      pipeline_statistics_query_ ? VK_TRUE : VK_FALSE)),
+          vk::PhysicalDeviceVulkan12Features() //
+              .setTimelineSemaphore(VK_TRUE),
           vk::PhysicalDeviceVulkan13Features() //
               .setSynchronization2(VK_TRUE)
               .setDynamicRendering(VK_TRUE));
 
   device_ = app.selected_device().createDevice(create_info.get());
-  if(queue_family_indices_.graphics != queue_family_indices_.transfer) {
-    graphics_queue_ = device_.getQueue(queue_family_indices_.graphics, 0);
-    transfer_queue_ = device_.getQueue(queue_family_indices_.transfer, 0);
-  }
-  else {
-    graphics_queue_ = device_.getQueue(queue_family_indices_.graphics, 0);
-    transfer_queue_ = device_.getQueue(queue_family_indices_.transfer, 1);
-  }
+  graphics_queue_ = device_.getQueue(
+      queue_family_indices_.graphics,
+      graphics_queue_idx);
+  compute_queue_ = device_.getQueue(
+      queue_family_indices_.compute,
+      compute_queue_idx);
+  transfer_queue_ = device_.getQueue(
+      queue_family_indices_.transfer,
+      transfer_queue_idx);
 
   allocator_ = vma::Allocator(app.vk_instance(), device_, physical_device_);
 }
@@ -14,9 +14,16 @@
 #include "rndrx/vulkan/frame_graph.hpp"
 
 #include <algorithm>
+#include <array>
+#include <compare>
+#include <cstdint>
 #include <iterator>
 #include <memory>
+#include <numeric>
+#include <optional>
 #include <ranges>
+#include <span>
+#include <sstream>
 #include <string_view>
 #include <unordered_map>
 #include <variant>
@@ -27,6 +34,7 @@
 #include "rndrx/assert.hpp"
 #include "rndrx/frame_graph_description.hpp"
 #include "rndrx/log.hpp"
+#include "rndrx/thread_pool.hpp"
 #include "rndrx/throw_exception.hpp"
 #include "rndrx/to_vector.hpp"
 #include "rndrx/vulkan/device.hpp"
@@ -66,29 +74,404 @@ vk::AttachmentStoreOp to_vulkan_store_op(AttachmentStoreOp op) {
   };
 }
 
+vk::BufferUsageFlags to_vulkan_buffer_usage(BufferUsage usage) {
+  vk::BufferUsageFlags flags;
+  if(has_usage(usage, BufferUsage::Uniform)) {
+    flags |= vk::BufferUsageFlagBits::eUniformBuffer;
+  }
+  if(has_usage(usage, BufferUsage::Storage)) {
+    flags |= vk::BufferUsageFlagBits::eStorageBuffer;
+  }
+  if(has_usage(usage, BufferUsage::Indirect)) {
+    flags |= vk::BufferUsageFlagBits::eIndirectBuffer;
+  }
+  if(has_usage(usage, BufferUsage::Vertex)) {
+    flags |= vk::BufferUsageFlagBits::eVertexBuffer;
+  }
+  if(has_usage(usage, BufferUsage::Index)) {
+    flags |= vk::BufferUsageFlagBits::eIndexBuffer;
+  }
+  if(has_usage(usage, BufferUsage::TransferSrc)) {
+    flags |= vk::BufferUsageFlagBits::eTransferSrc;
+  }
+  if(has_usage(usage, BufferUsage::TransferDst)) {
+    flags |= vk::BufferUsageFlagBits::eTransferDst;
+  }
+  return flags;
+}
+
+bool is_depth_format(vk::Format format) {
+  switch(format) {
+    case vk::Format::eD16Unorm:
+    case vk::Format::eX8D24UnormPack32:
+    case vk::Format::eD32Sfloat:
+    case vk::Format::eS8Uint:
+    case vk::Format::eD16UnormS8Uint:
+    case vk::Format::eD24UnormS8Uint:
+    case vk::Format::eD32SfloatS8Uint:
+      return true;
+    default:
+      return false;
+  }
+}
+
+vk::ImageAspectFlags aspect_mask_from_format(vk::Format format) {
+  switch(format) {
+    case vk::Format::eD16Unorm:
+    case vk::Format::eX8D24UnormPack32:
+    case vk::Format::eD32Sfloat:
+      return vk::ImageAspectFlagBits::eDepth;
+    case vk::Format::eS8Uint:
+      return vk::ImageAspectFlagBits::eStencil;
+    case vk::Format::eD16UnormS8Uint:
+    case vk::Format::eD24UnormS8Uint:
+    case vk::Format::eD32SfloatS8Uint:
+      return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+    default:
+      return vk::ImageAspectFlagBits::eColor;
+  }
+}
+
+vk::AccessFlags2 constexpr kWriteAccess =
+    vk::AccessFlagBits2::eShaderWrite | vk::AccessFlagBits2::eShaderStorageWrite |
+    vk::AccessFlagBits2::eColorAttachmentWrite |
+    vk::AccessFlagBits2::eDepthStencilAttachmentWrite |
+    vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eHostWrite |
+    vk::AccessFlagBits2::eMemoryWrite;
+
+// Render pass objects take the original flags. The synchronization2 bits
+// the graph uses for attachments share their values with those.
+vk::PipelineStageFlags legacy_stages(vk::PipelineStageFlags2 stages) {
+  return vk::PipelineStageFlags(static_cast<VkPipelineStageFlags>(
+      static_cast<VkPipelineStageFlags2>(stages)));
+}
+
+vk::AccessFlags legacy_access(vk::AccessFlags2 access) {
+  return vk::AccessFlags(
+      static_cast<VkAccessFlags>(static_cast<VkAccessFlags2>(access)));
+}
+
+struct InputUsageFromDescription {
+  FrameGraphResourceUsage operator()(FrameGraphAttachmentInputDescription const&) const {
+    return FrameGraphResourceUsage::InputAttachment;
+  }
+
+  FrameGraphResourceUsage operator()(FrameGraphInputImageDescription const&) const {
+    return FrameGraphResourceUsage::SampledImage;
+  }
+
+  FrameGraphResourceUsage operator()(FrameGraphBufferDescription const&) const {
+    return FrameGraphResourceUsage::BufferRead;
+  }
+};
+
+struct OutputUsageFromDescription {
+  bool is_compute = false;
+
+  FrameGraphResourceUsage operator()(
+      FrameGraphAttachmentOutputDescription const& description) const {
+    if(is_compute) {
+      return FrameGraphResourceUsage::StorageImage;
+    }
+
+    if(is_depth_format(to_vulkan_format(description.format()))) {
+      return FrameGraphResourceUsage::DepthStencilAttachment;
+    }
+
+    return FrameGraphResourceUsage::ColourAttachment;
+  }
+
+  FrameGraphResourceUsage operator()(FrameGraphBufferDescription const&) const {
+    return FrameGraphResourceUsage::BufferWrite;
+  }
+};
+
+// Buffers have no layout; the stages and access come from what the buffer
+// was declared to be used for. Graphics nodes may read buffers from any of
+// their shaders.
+FrameGraphResourceState required_buffer_state(
+    FrameGraphResourceUsage usage,
+    FrameGraphBuffer const& buffer,
+    bool is_compute) {
+  vk::PipelineStageFlags2 const shader_stages =
+      is_compute ? vk::PipelineStageFlagBits2::eComputeShader
+                 : vk::PipelineStageFlagBits2::eVertexShader |
+                       vk::PipelineStageFlagBits2::eFragmentShader;
+  vk::BufferUsageFlags const flags = buffer.usage();
+  FrameGraphResourceState state;
+  auto add = [&state, flags](
+                 vk::BufferUsageFlagBits flag,
+                 vk::PipelineStageFlags2 stages,
+                 vk::AccessFlags2 access) {
+    if(flags & flag) {
+      state.stages |= stages;
+      state.access |= access;
+    }
+  };
+
+  if(usage == FrameGraphResourceUsage::BufferWrite) {
+    add(vk::BufferUsageFlagBits::eStorageBuffer,
+        shader_stages,
+        vk::AccessFlagBits2::eShaderStorageWrite);
+    add(vk::BufferUsageFlagBits::eTransferDst,
+        vk::PipelineStageFlagBits2::eTransfer,
+        vk::AccessFlagBits2::eTransferWrite);
+  }
+  else {
+    add(vk::BufferUsageFlagBits::eUniformBuffer,
+        shader_stages,
+        vk::AccessFlagBits2::eUniformRead);
+    add(vk::BufferUsageFlagBits::eStorageBuffer,
+        shader_stages,
+        vk::AccessFlagBits2::eShaderStorageRead);
+    add(vk::BufferUsageFlagBits::eIndirectBuffer,
+        vk::PipelineStageFlagBits2::eDrawIndirect,
+        vk::AccessFlagBits2::eIndirectCommandRead);
+    add(vk::BufferUsageFlagBits::eVertexBuffer,
+        vk::PipelineStageFlagBits2::eVertexAttributeInput,
+        vk::AccessFlagBits2::eVertexAttributeRead);
+    add(vk::BufferUsageFlagBits::eIndexBuffer,
+        vk::PipelineStageFlagBits2::eIndexInput,
+        vk::AccessFlagBits2::eIndexRead);
+    add(vk::BufferUsageFlagBits::eTransferSrc,
+        vk::PipelineStageFlagBits2::eTransfer,
+        vk::AccessFlagBits2::eTransferRead);
+  }
+
+  // Nothing the graph knows how to describe, so be conservative.
+  if(!state.stages) {
+    bool const is_write = usage == FrameGraphResourceUsage::BufferWrite;
+    state.stages = vk::PipelineStageFlagBits2::eAllCommands;
+    state.access = is_write ? vk::AccessFlagBits2::eMemoryWrite
+                            : vk::AccessFlagBits2::eMemoryRead;
+  }
+
+  return state;
+}
+
+// Transient images may only be rendered to and read as input attachments.
+bool is_transient_usage(vk::ImageUsageFlags usage) {
+  vk::ImageUsageFlags const attachment_usage =
+      vk::ImageUsageFlagBits::eColorAttachment |
+      vk::ImageUsageFlagBits::eDepthStencilAttachment |
+      vk::ImageUsageFlagBits::eInputAttachment;
+  return usage && !(usage & ~attachment_usage);
+}
+
+bool discards_contents(FrameGraphResourceUsage usage, FrameGraphAttachment const* attachment) {
+  bool is_output = usage == FrameGraphResourceUsage::ColourAttachment ||
+                   usage == FrameGraphResourceUsage::DepthStencilAttachment ||
+                   usage == FrameGraphResourceUsage::StorageImage;
+  return is_output && attachment->load_op() != vk::AttachmentLoadOp::eLoad;
+}
+
+// Moves current to next, returning true if a barrier is needed to do so.
+// Reads in the same layout don't need a barrier, they are merged into the
+// current state so a later write waits for all of them.
+bool transition(FrameGraphResourceState& current, FrameGraphResourceState const& next) {
+  bool layout_change = current.layout != next.layout;
+  bool read_after_write = (current.access & kWriteAccess) != vk::AccessFlags2();
+  bool write_after_read = (next.access & kWriteAccess) != vk::AccessFlags2() &&
+                          current.stages != vk::PipelineStageFlags2();
+  if(layout_change || read_after_write || write_after_read) {
+    current = next;
+    return true;
+  }
+
+  current.stages |= next.stages;
+  current.access |= next.access;
+  return false;
+}
+
+vk::Extent2D resolve_extent(
+    FrameGraphAttachmentOutputDescription const& description,
+    vk::Extent2D output_extent) {
+  if(description.size_mode() == FrameGraphSizeMode::Absolute) {
+    return vk::Extent2D(description.width(), description.height());
+  }
+
+  if(output_extent.width == 0 || output_extent.height == 0) {
+    RNDRX_THROW_RUNTIME_ERROR()
+        << "Attachment " << quote(description.name())
+        << " is sized relative to the output but the builder has no "
+           "output extent.";
+  }
+
+  auto scale = [](std::uint32_t size, float scale) {
+    return std::max(1u, static_cast<std::uint32_t>(size * scale + 0.5f));
+  };
+
+  return vk::Extent2D(
+      scale(output_extent.width, description.scale_x()),
+      scale(output_extent.height, description.scale_y()));
+}
+
 } // namespace
 
+FrameGraphResourceState required_state(
+    FrameGraphResourceUsage usage,
+    FrameGraphAttachment const* attachment,
+    vk::PipelineStageFlags2 shader_stages) {
+  switch(usage) {
+    // Only fragment shaders can read input attachments.
+    case FrameGraphResourceUsage::InputAttachment:
+      return {
+          vk::ImageLayout::eReadOnlyOptimal,
+          vk::PipelineStageFlagBits2::eFragmentShader,
+          vk::AccessFlagBits2::eInputAttachmentRead};
+    case FrameGraphResourceUsage::SampledImage:
+      return {
+          vk::ImageLayout::eReadOnlyOptimal,
+          shader_stages,
+          vk::AccessFlagBits2::eShaderSampledRead};
+    case FrameGraphResourceUsage::ColourAttachment: {
+      vk::AccessFlags2 access = vk::AccessFlagBits2::eColorAttachmentWrite;
+      if(attachment->load_op() == vk::AttachmentLoadOp::eLoad) {
+        access |= vk::AccessFlagBits2::eColorAttachmentRead;
+      }
+      return {
+          vk::ImageLayout::eColorAttachmentOptimal,
+          vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+          access};
+    }
+    case FrameGraphResourceUsage::DepthStencilAttachment:
+      return {
+          vk::ImageLayout::eDepthStencilAttachmentOptimal,
+          vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+              vk::PipelineStageFlagBits2::eLateFragmentTests,
+          vk::AccessFlagBits2::eDepthStencilAttachmentRead |
+              vk::AccessFlagBits2::eDepthStencilAttachmentWrite};
+    case FrameGraphResourceUsage::StorageImage: {
+      vk::AccessFlags2 access = vk::AccessFlagBits2::eShaderStorageWrite;
+      if(attachment->load_op() == vk::AttachmentLoadOp::eLoad) {
+        access |= vk::AccessFlagBits2::eShaderStorageRead;
+      }
+      return {
+          vk::ImageLayout::eGeneral,
+          vk::PipelineStageFlagBits2::eComputeShader,
+          access};
+    }
+    case FrameGraphResourceUsage::BufferRead:
+    case FrameGraphResourceUsage::BufferWrite:
+      return {};
+    default:
+      RNDRX_UNREACHABLE;
+  }
+}
+
+vk::ImageUsageFlags image_usage(FrameGraphResourceUsage usage) {
+  switch(usage) {
+    case FrameGraphResourceUsage::InputAttachment:
+      return vk::ImageUsageFlagBits::eInputAttachment;
+    case FrameGraphResourceUsage::SampledImage:
+      return vk::ImageUsageFlagBits::eSampled;
+    case FrameGraphResourceUsage::ColourAttachment:
+      return vk::ImageUsageFlagBits::eColorAttachment;
+    case FrameGraphResourceUsage::DepthStencilAttachment:
+      return vk::ImageUsageFlagBits::eDepthStencilAttachment;
+    case FrameGraphResourceUsage::StorageImage:
+      return vk::ImageUsageFlagBits::eStorage;
+    case FrameGraphResourceUsage::BufferRead:
+    case FrameGraphResourceUsage::BufferWrite:
+      return {};
+    default:
+      RNDRX_UNREACHABLE;
+  }
+}
+
+vk::ClearValue clear_value(
+    FrameGraphResourceUsage usage,
+    FrameGraphAttachment const* attachment) {
+  vk::ClearValue value;
+  if(usage == FrameGraphResourceUsage::DepthStencilAttachment) {
+    value.setDepthStencil(vk::ClearDepthStencilValue(
+        attachment->clear_depth(),
+        attachment->clear_stencil()));
+  }
+  else {
+    glm::vec4 colour = attachment->clear_colour();
+    value.setColor(vk::ClearColorValue(
+        std::array<float, 4>{colour.r, colour.g, colour.b, colour.a}));
+  }
+  return value;
+}
+
+FrameGraphAttachment::FrameGraphAttachment(
+    Device& device,
+    FrameGraphAttachmentOutputDescription const& description,
+    vk::Extent2D extent,
+    vk::ImageUsageFlags usage)
+    : usage_(usage) {
+  if(usage & vk::ImageUsageFlagBits::eTransientAttachment) {
+    VmaAllocationCreateInfo allocation_create_info = {};
+    allocation_create_info.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+    image_ = device.allocator().create_image(
+        image_create_info(description, extent, usage),
+        allocation_create_info);
+  }
+  else {
+    image_ = device.allocator().create_image(
+        image_create_info(description, extent, usage));
+  }
+  create_image_view(device, description, extent);
+}
+
 FrameGraphAttachment::FrameGraphAttachment(
     Device& device,
+    FrameGraphAttachmentOutputDescription const& description,
+    vk::Extent2D extent,
+    vk::ImageUsageFlags usage,
+    vma::Allocation const& memory,
+    vk::DeviceSize offset)
+    : usage_(usage) {
+  image_ = device.allocator().create_image(
+      image_create_info(description, extent, usage),
+      memory,
+      offset);
+  create_image_view(device, description, extent);
+}
+
+FrameGraphAttachment::FrameGraphAttachment(
+    FrameGraphAttachmentOutputDescription const& description,
+    vk::Extent2D extent,
+    vk::ImageUsageFlags usage)
+    : format_(to_vulkan_format(description.format()))
+    , width_(static_cast<int>(extent.width))
+    , height_(static_cast<int>(extent.height))
+    , usage_(usage)
+    , imported_(true) {
+  set_load_state(description);
+}
+
+vk::ImageCreateInfo FrameGraphAttachment::image_create_info(
+    FrameGraphAttachmentOutputDescription const& description,
+    vk::Extent2D extent,
+    vk::ImageUsageFlags usage) {
+  return vk::ImageCreateInfo()
+      .setFormat(to_vulkan_format(description.format()))
+      .setImageType(vk::ImageType::e2D)
+      .setExtent(vk::Extent3D(extent, 1))
+      .setUsage(usage)
+      .setMipLevels(1)
+      .setArrayLayers(1);
+}
+
+void FrameGraphAttachment::set_load_state(
     FrameGraphAttachmentOutputDescription const& description) {
-  format_ = to_vulkan_format(description.format());
-  width_ = description.width();
-  height_ = description.height();
   load_op_ = to_vulkan_load_op(description.load_op());
   clear_colour_ = description.clear_colour();
   clear_depth_ = description.clear_depth();
   clear_stencil_ = description.clear_stencil();
+}
 
-  image_ = device.allocator().create_image( //
-      vk::ImageCreateInfo()
-          .setFormat(format_)
-          .setImageType(vk::ImageType::e2D)
-          .setExtent(vk::Extent3D(width_, height_, 1))
-          .setUsage(
-              vk::ImageUsageFlagBits::eColorAttachment |
-              vk::ImageUsageFlagBits::eInputAttachment)
-          .setMipLevels(1)
-          .setArrayLayers(1));
+void FrameGraphAttachment::create_image_view(
+    Device& device,
+    FrameGraphAttachmentOutputDescription const& description,
+    vk::Extent2D extent) {
+  format_ = to_vulkan_format(description.format());
+  width_ = static_cast<int>(extent.width);
+  height_ = static_cast<int>(extent.height);
+  set_load_state(description);
 
   image_view_ = device.vk().createImageView(
       vk::ImageViewCreateInfo()
@@ -97,7 +480,7 @@ FrameGraphAttachment::FrameGraphAttachment(
           .setFormat(format_)
           .setSubresourceRange( //
               vk::ImageSubresourceRange()
-                  .setAspectMask(vk::ImageAspectFlagBits::eColor)
+                  .setAspectMask(aspect_mask())
                   .setBaseMipLevel(0)
                   .setLevelCount(1)
                   .setBaseArrayLayer(0)
@@ -130,6 +513,14 @@ vk::raii::ImageView const& FrameGraphAttachment::image_view() const {
   return image_view_;
 }
 
+vk::Image FrameGraphAttachment::vk_image() const {
+  return imported_ ? imported_image_ : *image_.vk();
+}
+
+vk::ImageView FrameGraphAttachment::vk_image_view() const {
+  return imported_ ? imported_view_ : *image_view_;
+}
+
 vk::Format FrameGraphAttachment::format() const {
   return format_;
 }
@@ -142,6 +533,10 @@ int FrameGraphAttachment::height() const {
   return height_;
 }
 
+vk::ImageUsageFlags FrameGraphAttachment::usage() const {
+  return usage_;
+}
+
 vk::AttachmentLoadOp FrameGraphAttachment::load_op() const {
   return load_op_;
 }
@@ -158,11 +553,18 @@ int FrameGraphAttachment::clear_stencil() const {
   return clear_stencil_;
 }
 
+vk::ImageAspectFlags FrameGraphAttachment::aspect_mask() const {
+  return aspect_mask_from_format(format_);
+}
+
 FrameGraphBuffer::FrameGraphBuffer(
-    Device& device,
-    FrameGraphBufferDescription const& description) {
-  RNDRX_ASSERT(false && "Not implemented");
-  buffer_ = vma::Buffer(device.allocator(), vk::BufferCreateInfo());
+    FrameGraphBufferDescription const& description)
+    : size_(description.size())
+    , usage_(to_vulkan_buffer_usage(description.usage())) {
+  if(size_ == 0) {
+    RNDRX_THROW_RUNTIME_ERROR()
+        << "Buffer " << quote(description.name()) << " has no size.";
+  }
 }
 
 void FrameGraphResource::set_render_resource(FrameGraphAttachment* attachment) {
@@ -182,309 +584,2179 @@ FrameGraphAttachment* FrameGraphResource::get_attachment() const {
   return nullptr;
 }
 
-FrameGraphNode::FrameGraphNode(std::string name, FrameGraphRenderPass* render_pass)
+void FrameGraphResource::set_history_attachments(
+    FrameGraphAttachment* even_frames,
+    FrameGraphAttachment* odd_frames) {
+  history_attachments_ = {even_frames, odd_frames};
+  render_resource_ = even_frames;
+}
+
+void FrameGraphResource::select_history(std::size_t parity) {
+  if(history_attachments_[0] != nullptr) {
+    render_resource_ = history_attachments_[parity];
+  }
+}
+
+FrameGraphAttachment* FrameGraphResource::get_attachment(
+    std::size_t parity) const {
+  if(history_attachments_[0] != nullptr) {
+    return history_attachments_[parity];
+  }
+
+  return get_attachment();
+}
+
+FrameGraphBuffer* FrameGraphResource::get_buffer() const {
+  FrameGraphBuffer* const* ret_ref = std::get_if<FrameGraphBuffer*>(
+      &render_resource_);
+  if(ret_ref) {
+    return *ret_ref;
+  }
+  return nullptr;
+}
+
+FrameGraphNode::FrameGraphNode(
+    std::string name,
+    FrameGraphRenderPass* render_pass,
+    bool is_compute,
+    QueueType queue)
     : name_(std::move(name))
-    , render_pass_(render_pass) {
+    , render_pass_(render_pass)
+    , is_compute_(is_compute)
+    , queue_(queue) {
 }
 
-void FrameGraphNode::create_vk_render_pass(Device& device) {
-  int pass_width = outputs_[0]->get_attachment()->width();
-  int pass_height = outputs_[0]->get_attachment()->height();
+vk::PipelineStageFlags2 FrameGraphNode::shader_stages() const {
+  return is_compute_ ? vk::PipelineStageFlagBits2::eComputeShader
+                     : vk::PipelineStageFlagBits2::eVertexShader |
+                           vk::PipelineStageFlagBits2::eFragmentShader;
+}
 
-  std::vector<vk::AttachmentReference> input_attachment_references;
-  input_attachment_references.reserve(inputs_.size());
+FrameGraphPhysicalPass::FrameGraphPhysicalPass(
+    std::size_t first_node,
+    std::vector<FrameGraphNode*> nodes)
+    : first_node_(first_node)
+    , nodes_(std::move(nodes)) {
+  for(std::uint32_t i = 0; i < nodes_.size(); ++i) {
+    nodes_[i]->set_physical_pass(this, i);
+  }
+}
 
-  std::vector<vk::AttachmentReference> output_attachment_references;
-  input_attachment_references.reserve(outputs_.size());
+void FrameGraphPhysicalPass::create_vk_render_pass(
+    Device& device,
+    std::span<FrameGraphResource const> resources,
+    std::vector<bool> const& internal_resources) {
+  extent_ = nodes_[0]->extent();
+  std::uint32_t const num_subpasses = static_cast<std::uint32_t>(nodes_.size());
 
   std::vector<vk::AttachmentDescription> attachments;
-  attachments.reserve(inputs_.size() + outputs_.size());
+  framebuffer_views_ = {};
+  clear_values_.clear();
+  imported_slots_.clear();
+  release_imported_framebuffers();
+  has_history_ = false;
+
+  std::vector<std::vector<vk::AttachmentReference>> input_references(
+      num_subpasses);
+  std::vector<std::vector<vk::AttachmentReference>> output_references(
+      num_subpasses);
+  std::vector<std::optional<vk::AttachmentReference>> depth_stencil_references(
+      num_subpasses);
+  std::vector<std::vector<std::uint32_t>> preserve_references(num_subpasses);
+  std::vector<vk::SubpassDependency> dependencies;
+
+  // The most recent subpass to use each attachment and how it did so.
+  struct LastUse {
+    std::uint32_t subpass = 0;
+    FrameGraphResourceState state;
+  };
 
-  std::vector<vk::ImageView> framebuffer_views;
-  framebuffer_views.reserve(inputs_.size() + outputs_.size());
-  for(auto&& input : inputs_) {
-    FrameGraphAttachment* attachment = input->get_attachment();
-    // Could be a buffer or image which are not created as part of the render pass.
-    if(attachment == nullptr) {
-      continue;
+  std::unordered_map<FrameGraphResourceHandle, std::uint32_t> attachment_indices;
+  std::vector<LastUse> last_uses;
+  std::vector<std::uint32_t> first_subpasses;
+
+  auto add_dependency = [&dependencies](
+                            std::uint32_t src_subpass,
+                            std::uint32_t dst_subpass,
+                            FrameGraphResourceState const& src,
+                            FrameGraphResourceState const& dst) {
+    auto dependency = std::ranges::find_if(
+        dependencies,
+        [src_subpass, dst_subpass](vk::SubpassDependency const& dep) {
+          return dep.srcSubpass == src_subpass && dep.dstSubpass == dst_subpass;
+        });
+
+    if(dependency == dependencies.end()) {
+      dependencies.push_back(
+          vk::SubpassDependency()
+              .setSrcSubpass(src_subpass)
+              .setDstSubpass(dst_subpass)
+              .setDependencyFlags(vk::DependencyFlagBits::eByRegion));
+      dependency = dependencies.end() - 1;
     }
 
-    RNDRX_ASSERT(attachment->width() == pass_width);
-    RNDRX_ASSERT(attachment->height() == pass_height);
+    dependency->srcStageMask |= legacy_stages(src.stages);
+    dependency->srcAccessMask |= legacy_access(src.access & kWriteAccess);
+    dependency->dstStageMask |= legacy_stages(dst.stages);
+    dependency->dstAccessMask |= legacy_access(dst.access);
+  };
+
+  // The graph transitions every attachment into the layout its first
+  // subpass wants before the pass begins; after that the render pass
+  // moves it between subpass layouts and leaves it in the last one.
+  auto reference = [&](std::uint32_t subpass,
+                       FrameGraphResourceHandle resource,
+                       FrameGraphResourceUsage usage) {
+    FrameGraphNode const& node = *nodes_[subpass];
+    FrameGraphAttachment const* attachment =
+        resources[index(resource)].get_attachment();
+    RNDRX_ASSERT(attachment);
+    RNDRX_ASSERT(attachment->width() == static_cast<int>(extent_.width));
+    RNDRX_ASSERT(attachment->height() == static_cast<int>(extent_.height));
+
+    FrameGraphResourceState state = required_state(
+        usage,
+        attachment,
+        node.shader_stages());
+    auto found = attachment_indices.find(resource);
+    if(found != attachment_indices.end()) {
+      std::uint32_t const idx = found->second;
+      LastUse& last_use = last_uses[idx];
+      bool const has_write = ((last_use.state.access | state.access) &
+                              kWriteAccess) != vk::AccessFlags2();
+      if(last_use.subpass != subpass && has_write) {
+        add_dependency(last_use.subpass, subpass, last_use.state, state);
+      }
+
+      attachments[idx].setFinalLayout(state.layout);
+      last_use = {subpass, state};
+      return vk::AttachmentReference(idx, state.layout);
+    }
 
-    input_attachment_references.push_back(
-        vk::AttachmentReference()
-            .setAttachment(attachments.size())
-            .setLayout(vk::ImageLayout::eReadOnlyOptimal));
+    std::uint32_t const idx = static_cast<std::uint32_t>(attachments.size());
+    attachment_indices[resource] = idx;
+    last_uses.push_back({subpass, state});
+    first_subpasses.push_back(subpass);
+
+    vk::AttachmentLoadOp load_op = vk::AttachmentLoadOp::eLoad;
+    vk::AttachmentStoreOp store_op = vk::AttachmentStoreOp::eNone;
+    vk::ClearValue clear;
+    if(usage == FrameGraphResourceUsage::ColourAttachment ||
+       usage == FrameGraphResourceUsage::DepthStencilAttachment) {
+      load_op = attachment->load_op();
+      store_op = internal_resources[index(resource)]
+                     ? vk::AttachmentStoreOp::eDontCare
+                     : vk::AttachmentStoreOp::eStore;
+      clear = clear_value(usage, attachment);
+    }
 
     attachments.push_back(vk::AttachmentDescription()
                               .setFormat(attachment->format())
-                              .setLoadOp(vk::AttachmentLoadOp::eLoad)
-                              .setStoreOp(vk::AttachmentStoreOp::eNone)
+                              .setLoadOp(load_op)
+                              .setStoreOp(store_op)
+                              .setStencilLoadOp(load_op)
+                              .setStencilStoreOp(store_op)
                               .setSamples(vk::SampleCountFlagBits::e1)
-                              .setInitialLayout(vk::ImageLayout::eReadOnlyOptimal)
-                              .setFinalLayout(vk::ImageLayout::eReadOnlyOptimal));
+                              .setInitialLayout(state.layout)
+                              .setFinalLayout(state.layout));
+
+    // Imported views change every frame and are filled in by
+    // bind_imported_attachments().
+    for(std::size_t parity = 0; parity < 2; ++parity) {
+      framebuffer_views_[parity].push_back(
+          resources[index(resource)].get_attachment(parity)->vk_image_view());
+    }
 
-    framebuffer_views.push_back(*attachment->image_view());
-  }
+    if(attachment->is_imported()) {
+      imported_slots_.push_back({attachment, idx, false});
+    }
 
-  for(auto&& output : outputs_) {
-    FrameGraphAttachment* attachment = output->get_attachment();
-    // Could be a buffer or image which are not created as part of the render pass.
-    if(attachment == nullptr) {
-      continue;
+    has_history_ |= framebuffer_views_[0].back() != framebuffer_views_[1].back();
+    clear_values_.push_back(clear);
+    return vk::AttachmentReference(idx, state.layout);
+  };
+
+  for(std::uint32_t subpass = 0; subpass < num_subpasses; ++subpass) {
+    FrameGraphNode const& node = *nodes_[subpass];
+    RNDRX_ASSERT(node.extent() == extent_);
+
+    // Only input attachments are bound to the render pass, sampled images
+    // and buffers are bound by the pass implementation.
+    for(std::size_t i = 0; i < node.inputs().size(); ++i) {
+      if(node.input_usages()[i] == FrameGraphResourceUsage::InputAttachment) {
+        input_references[subpass].push_back(reference(
+            subpass,
+            node.inputs()[i],
+            FrameGraphResourceUsage::InputAttachment));
+      }
     }
 
-    RNDRX_ASSERT(attachment->width() == pass_width);
-    RNDRX_ASSERT(attachment->height() == pass_height);
+    for(std::size_t i = 0; i < node.outputs().size(); ++i) {
+      // Could be a buffer which is not part of the render pass.
+      FrameGraphResourceUsage usage = node.output_usage(i);
+      if(usage == FrameGraphResourceUsage::BufferWrite) {
+        continue;
+      }
 
-    output_attachment_references.push_back(
-        vk::AttachmentReference()
-            .setAttachment(attachments.size())
-            .setLayout(vk::ImageLayout::eColorAttachmentOptimal));
+      vk::AttachmentReference output_reference = reference(
+          subpass,
+          node.outputs()[i],
+          usage);
+      if(usage == FrameGraphResourceUsage::DepthStencilAttachment) {
+        RNDRX_ASSERT(
+            !depth_stencil_references[subpass] &&
+            "Only one depth target per pass.");
+        depth_stencil_references[subpass] = output_reference;
+      }
+      else {
+        output_references[subpass].push_back(output_reference);
+      }
+    }
+  }
 
-    attachments.push_back(
-        vk::AttachmentDescription()
-            .setFormat(attachment->format())
-            .setLoadOp(attachment->load_op())
-            .setStoreOp(vk::AttachmentStoreOp::eStore)
-            .setSamples(vk::SampleCountFlagBits::e1)
-            .setInitialLayout(vk::ImageLayout::eColorAttachmentOptimal)
-            .setFinalLayout(vk::ImageLayout::eReadOnlyOptimal));
+  // Attachments still needed by a later subpass have to be preserved by
+  // the subpasses in between that don't use them.
+  for(std::uint32_t idx = 0; idx < attachments.size(); ++idx) {
+    for(std::uint32_t subpass = first_subpasses[idx] + 1;
+        subpass < last_uses[idx].subpass;
+        ++subpass) {
+      auto uses_attachment = [idx](vk::AttachmentReference const& ref) {
+        return ref.attachment == idx;
+      };
+
+      auto const& depth_stencil = depth_stencil_references[subpass];
+      bool used =
+          std::ranges::any_of(input_references[subpass], uses_attachment) ||
+          std::ranges::any_of(output_references[subpass], uses_attachment) ||
+          (depth_stencil && depth_stencil->attachment == idx);
+      if(!used) {
+        preserve_references[subpass].push_back(idx);
+      }
+    }
+  }
 
-    framebuffer_views.push_back(*attachment->image_view());
+  std::vector<vk::SubpassDescription> subpasses;
+  subpasses.reserve(num_subpasses);
+  for(std::uint32_t subpass = 0; subpass < num_subpasses; ++subpass) {
+    subpasses.push_back(
+        vk::SubpassDescription()
+            .setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+            .setInputAttachments(input_references[subpass])
+            .setColorAttachments(output_references[subpass])
+            .setPreserveAttachments(preserve_references[subpass]));
+    if(depth_stencil_references[subpass]) {
+      subpasses.back().setPDepthStencilAttachment(
+          &*depth_stencil_references[subpass]);
+    }
   }
 
   vk_render_pass_ = device.vk().createRenderPass( //
       vk::RenderPassCreateInfo()
           .setAttachments(attachments)
-          .setSubpasses( //
-              vk::SubpassDescription()
-                  .setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
-                  .setInputAttachments(input_attachment_references)
-                  .setColorAttachments(output_attachment_references)));
-
-  vk_frame_buffer_ = device.vk().createFramebuffer( //
-      vk::FramebufferCreateInfo()
-          .setRenderPass(*vk_render_pass_)
-          .setWidth(pass_width)
-          .setHeight(pass_height)
-          .setLayers(1)
-          .setAttachments(framebuffer_views));
-}
+          .setSubpasses(subpasses)
+          .setDependencies(dependencies));
 
-void FrameGraphNode::set_resources(
-    std::vector<FrameGraphResource const*> inputs,
-    std::vector<FrameGraphResource const*> outputs) {
-  inputs_ = std::move(inputs);
-  outputs_ = std::move(outputs);
-}
-
-FrameGraph::FrameGraph(
-    FrameGraphBuilder const& builder,
-    FrameGraphDescription const& description) {
-  parse_description(builder, description);
-  build_edges();
-  sort_nodes();
-  allocate_graphics_resources(builder.device(), description);
-}
+  vk_frame_buffers_ = {nullptr, nullptr};
+  for(std::size_t parity = 0; parity < (has_history_ ? 2 : 1); ++parity) {
+    if(has_imported_attachments()) {
+      break;
+    }
 
-FrameGraphNode* FrameGraph::find_node(std::string_view name) {
-  auto node = nodes_.find(name);
-  if(node != nodes_.end()) {
-    // const_cast required because a value is const in a set.
-    // It's safe as long as we don't change the name.
-    return const_cast<FrameGraphNode*>(&*node);
+    vk_frame_buffers_[parity] = device.vk().createFramebuffer( //
+        vk::FramebufferCreateInfo()
+            .setRenderPass(*vk_render_pass_)
+            .setWidth(extent_.width)
+            .setHeight(extent_.height)
+            .setLayers(1)
+            .setAttachments(framebuffer_views_[parity]));
   }
 
-  return nullptr;
-}
-
-void FrameGraph::render(SubmissionContext& sc) {
-  auto cmd = sc.command_buffer();
-  for(auto&& node : sorted_nodes_) {
-    // for(auto&& input : node->inputs()) {
-    //   if(FrameGraphAttachment const* attachment = input->attachment()) {
-    //     // Transition image accordingly.
-    //   }
-    // }
-
-    vk::Extent2D image_size = sc.render_extents().extent;
-    // for(auto&& output : node->outputs()) {
-    //   if(FrameGraphAttachment const* attachment = output->attachment()) {
-    //     // Transition image accordingly.
-    //     attachment->image();
-    //   }
-    // }
-
-    vk::Rect2D scissor{{0, 0}, image_size};
-    cmd.setScissor(0, scissor);
-
-    vk::Viewport viewport{
-        0,
-        0,
-        static_cast<float>(image_size.width),
-        static_cast<float>(image_size.height),
-        0.f,
-        1.f};
-    cmd.setViewport(0, viewport);
-
-    node->render_pass()->pre_render(sc);
-
-    // Begin rendering
-
-    node->render_pass()->render(sc);
-
-    // Finish rendering
-
-    node->render_pass()->post_render(sc);
+  if(num_subpasses > 1) {
+    LOG(Info) << "Frame graph merged " << num_subpasses
+              << " passes into one render pass starting at "
+              << quote(nodes_[0]->name()) << ".";
   }
 }
 
-void FrameGraph::parse_description(
-    FrameGraphBuilder const& builder,
-    FrameGraphDescription const& description) {
-  nodes_.reserve(description.passes().size());
-  for(auto&& pass : description.passes()) {
-    auto render_impl = builder.find_render_pass(pass.name());
-    if(render_impl == nullptr) {
-      RNDRX_THROW_RUNTIME_ERROR()
-          << "Failed to find render pass implementation named " << pass.name()
-          << ". Did you forget at call add_render_pass()?";
+void FrameGraphPhysicalPass::create_rendering_info(
+    std::span<FrameGraphResource const> resources,
+    std::vector<bool> const& internal_resources) {
+  RNDRX_ASSERT(nodes_.size() == 1 && "Dynamic rendering has no subpasses.");
+  FrameGraphNode const& node = *nodes_[0];
+  extent_ = node.extent();
+  dynamic_rendering_ = true;
+  has_history_ = false;
+  colour_attachments_ = {};
+  colour_formats_.clear();
+  depth_stencil_attachments_ = {};
+  depth_format_ = vk::Format::eUndefined;
+  stencil_format_ = vk::Format::eUndefined;
+  imported_slots_.clear();
+
+  // As with render passes the graph has already moved every attachment
+  // into the layout the node wants, so it stays there throughout.
+  for(std::size_t i = 0; i < node.outputs().size(); ++i) {
+    FrameGraphResourceHandle resource = node.outputs()[i];
+    FrameGraphAttachment const* attachment =
+        resources[index(resource)].get_attachment();
+    if(attachment == nullptr) {
+      continue;
     }
 
-    nodes_.insert(FrameGraphNode(std::string(pass.name()), render_impl));
-  }
+    RNDRX_ASSERT(attachment->width() == static_cast<int>(extent_.width));
+    RNDRX_ASSERT(attachment->height() == static_cast<int>(extent_.height));
+
+    FrameGraphResourceUsage usage = node.output_usage(i);
+    FrameGraphResourceState state = required_state(
+        usage,
+        attachment,
+        node.shader_stages());
+    vk::RenderingAttachmentInfo info =
+        vk::RenderingAttachmentInfo()
+            .setImageView(attachment->vk_image_view())
+            .setImageLayout(state.layout)
+            .setLoadOp(attachment->load_op())
+            .setStoreOp(
+                internal_resources[index(resource)]
+                    ? vk::AttachmentStoreOp::eDontCare
+                    : vk::AttachmentStoreOp::eStore)
+            .setClearValue(clear_value(usage, attachment));
+
+    // Only the image differs between the two frame parities.
+    std::array<vk::RenderingAttachmentInfo, 2> infos = {info, info};
+    vk::ImageView odd_view =
+        resources[index(resource)].get_attachment(1)->vk_image_view();
+    infos[1].setImageView(odd_view);
+    has_history_ |= info.imageView != odd_view;
+
+    if(usage == FrameGraphResourceUsage::DepthStencilAttachment) {
+      RNDRX_ASSERT(
+          !depth_stencil_attachments_[0].imageView &&
+          "Only one depth target per pass.");
+      depth_stencil_attachments_ = infos;
+      if(attachment->is_imported()) {
+        imported_slots_.push_back({attachment, 0, true});
+      }
 
-  for(auto&& pass : description.passes()) {
-    auto producer = find_node(pass.name());
-    for(auto&& output : pass.outputs()) {
-      auto& output_named_object = std::visit(
-          FrameGraphNamedObjectFromResourceDescription(),
-          output);
-      std::string output_name{output_named_object.name()};
-      if(resources_.contains(output_name)) {
-        RNDRX_THROW_RUNTIME_ERROR()
-            << "Found duplicate output " << quote(output_name) << " on pass "
-            << quote(pass.name());
+      vk::ImageAspectFlags aspect = attachment->aspect_mask();
+      if(aspect & vk::ImageAspectFlagBits::eDepth) {
+        depth_format_ = attachment->format();
+      }
+      if(aspect & vk::ImageAspectFlagBits::eStencil) {
+        stencil_format_ = attachment->format();
+      }
+    }
+    else {
+      if(attachment->is_imported()) {
+        imported_slots_.push_back(
+            {attachment,
+             static_cast<std::uint32_t>(colour_attachments_[0].size()),
+             false});
       }
 
-      resources_.insert(FrameGraphResource(std::move(output_name), producer));
+      colour_attachments_[0].push_back(infos[0]);
+      colour_attachments_[1].push_back(infos[1]);
+      colour_formats_.push_back(attachment->format());
     }
   }
+}
 
-  for(auto&& pass : description.passes()) {
-    std::vector<FrameGraphResource const*> inputs =
-        pass.inputs() |
-        std::views::transform([this, &pass](auto const& description) {
-          auto& named_object = std::visit(
-              FrameGraphNamedObjectFromResourceDescription(),
-              description);
-          FrameGraphResource const* input = find_resource(named_object.name());
-          if(input == nullptr) {
-            RNDRX_THROW_RUNTIME_ERROR()
-                << "Failed to find output named " << quote(named_object.name())
-                << " for pass " << quote(pass.name());
-          }
-          return input;
-        }) |
-        to_vector;
+vk::PipelineRenderingCreateInfo
+FrameGraphPhysicalPass::pipeline_rendering_create_info() const {
+  return vk::PipelineRenderingCreateInfo()
+      .setColorAttachmentFormats(colour_formats_)
+      .setDepthAttachmentFormat(depth_format_)
+      .setStencilAttachmentFormat(stencil_format_);
+}
 
-    std::vector<FrameGraphResource const*> outputs =
-        pass.outputs() |
-        std::views::transform([this, &pass](auto const& description) {
-          auto& named_object = std::visit(
-              FrameGraphNamedObjectFromResourceDescription(),
-              description);
-          FrameGraphResource const* output = find_resource(named_object.name());
-          RNDRX_ASSERT(
-              output && "Output should have been found due to first pass.");
-          return output;
-        }) |
-        to_vector;
+void FrameGraphPhysicalPass::begin(
+    vk::CommandBuffer cmd,
+    vk::SubpassContents contents,
+    std::size_t parity) const {
+  std::size_t const slot = has_history_ ? parity : 0;
+  if(dynamic_rendering_) {
+    vk::RenderingInfo info =
+        vk::RenderingInfo()
+            .setRenderArea(vk::Rect2D({0, 0}, extent_))
+            .setLayerCount(1)
+            .setColorAttachments(colour_attachments_[slot]);
+    if(contents == vk::SubpassContents::eSecondaryCommandBuffers) {
+      info.setFlags(vk::RenderingFlagBits::eContentsSecondaryCommandBuffers);
+    }
+    if(depth_format_ != vk::Format::eUndefined) {
+      info.setPDepthAttachment(&depth_stencil_attachments_[slot]);
+    }
+    if(stencil_format_ != vk::Format::eUndefined) {
+      info.setPStencilAttachment(&depth_stencil_attachments_[slot]);
+    }
 
-    auto node = find_node(pass.name());
-    node->set_resources(std::move(inputs), std::move(outputs));
+    cmd.beginRendering(info);
+    return;
   }
+
+  cmd.beginRenderPass(
+      vk::RenderPassBeginInfo()
+          .setRenderPass(*vk_render_pass_)
+          .setFramebuffer(vk_frame_buffer(parity))
+          .setRenderArea(vk::Rect2D({0, 0}, extent_))
+          .setClearValues(clear_values_),
+      contents);
 }
 
-void FrameGraph::build_edges() {
-  for(auto&& node : nodes_) {
-    for(auto&& input : node.inputs()) {
-      FrameGraphNode* producer = input->producer();
-      producer->add_dependent(const_cast<FrameGraphNode*>(&node));
-    }
+void FrameGraphPhysicalPass::next_subpass(
+    vk::CommandBuffer cmd,
+    vk::SubpassContents contents) const {
+  RNDRX_ASSERT(!dynamic_rendering_);
+  cmd.nextSubpass(contents);
+}
+
+void FrameGraphPhysicalPass::end(vk::CommandBuffer cmd) const {
+  if(dynamic_rendering_) {
+    cmd.endRendering();
+  }
+  else {
+    cmd.endRenderPass();
   }
 }
 
-namespace {
-void sort_nodes_recursive(
-    FrameGraphNode* node,
-    std::vector<FrameGraphNode*>& sorted_nodes,
-    std::unordered_map<FrameGraphNode const*, bool>& added) {
-  if(node->dependents().empty()) {
-    auto is_added = added.find(node);
-    if(!is_added->second) {
-      is_added->second = true;
-      sorted_nodes.push_back(node);
+void FrameGraphPhysicalPass::bind_imported_attachments(
+    Device& device,
+    std::size_t parity) {
+  if(dynamic_rendering_) {
+    for(auto&& imported : imported_slots_) {
+      vk::ImageView const view = imported.attachment->vk_image_view();
+      for(std::size_t slot = 0; slot < 2; ++slot) {
+        if(imported.depth_stencil) {
+          depth_stencil_attachments_[slot].setImageView(view);
+        }
+        else {
+          colour_attachments_[slot][imported.index].setImageView(view);
+        }
+      }
     }
     return;
   }
 
-  for(auto child : node->dependents()) {
-    sort_nodes_recursive(child, sorted_nodes, added);
+  std::vector<vk::ImageView>& views =
+      framebuffer_views_[has_history_ ? parity : 0];
+  for(auto&& imported : imported_slots_) {
+    views[imported.index] = imported.attachment->vk_image_view();
   }
 
-  auto is_added = added.find(node);
-  if(!is_added->second) {
-    is_added->second = true;
-    sorted_nodes.push_back(node);
+  auto cached = std::ranges::find(
+      imported_frame_buffers_,
+      views,
+      &ImportedFramebuffer::views);
+  if(cached == imported_frame_buffers_.end()) {
+    imported_frame_buffers_.push_back(
+        {views,
+         device.vk().createFramebuffer( //
+             vk::FramebufferCreateInfo()
+                 .setRenderPass(*vk_render_pass_)
+                 .setWidth(extent_.width)
+                 .setHeight(extent_.height)
+                 .setLayers(1)
+                 .setAttachments(views))});
+    cached = imported_frame_buffers_.end() - 1;
   }
+
+  imported_frame_buffer_ = *cached->framebuffer;
 }
 
-} // namespace
+void FrameGraphPhysicalPass::release_imported_framebuffers() {
+  imported_frame_buffers_.clear();
+  imported_frame_buffer_ = nullptr;
+}
 
-void FrameGraph::sort_nodes() {
-  std::unordered_map<FrameGraphNode const*, bool> added;
-  for(auto&& node : nodes_) {
-    added.insert(std::make_pair(&node, false));
-  }
+void FrameGraphNode::set_resources(
+    std::span<FrameGraphResourceHandle const> inputs,
+    std::span<FrameGraphResourceUsage const> input_usages,
+    std::span<FrameGraphResourceHandle const> outputs,
+    std::span<FrameGraphResourceUsage const> output_usages) {
+  RNDRX_ASSERT(inputs.size() == input_usages.size());
+  RNDRX_ASSERT(outputs.size() == output_usages.size());
+  inputs_ = inputs;
+  input_usages_ = input_usages;
+  outputs_ = outputs;
+  output_usages_ = output_usages;
+}
 
-  sorted_nodes_.reserve(nodes_.size());
-  for(auto&& node : nodes_) {
-    sort_nodes_recursive(const_cast<FrameGraphNode*>(&node), sorted_nodes_, added);
+FrameGraph::FrameGraph(
+    FrameGraphBuilder const& builder,
+    FrameGraphDescription const& description)
+    : device_(&builder.device())
+    , thread_pool_(builder.thread_pool())
+    , resource_pool_(builder.resource_pool())
+    , dynamic_rendering_(builder.dynamic_rendering())
+    , output_extent_(builder.output_extent())
+    , description_(description) {
+  parse_description(builder, description);
+  compact_nodes(sort_nodes(cull_nodes(description)));
+  build_edges();
+  build_physical_passes();
+  build_batches();
+  compute_resource_lifetimes();
+  allocate_graphics_resources(builder.device(), description);
+  build_barriers(builder.device());
+  if(builder.profiling()) {
+    profiler_ = std::make_unique<FrameGraphProfiler>(
+        builder.device(),
+        nodes_,
+        *builder.profiling());
   }
-
-  std::ranges::reverse(sorted_nodes_);
 }
 
-void FrameGraph::allocate_graphics_resources(
-    Device& device,
-    FrameGraphDescription const& description) {
-  struct ResourceAllocator {
-    ResourceAllocator(Device& device, FrameGraph& target)
-        : device_(device)
-        , target_(target) {
-    }
+namespace {
+// Whether two descriptions differ only in the attachment and buffer
+// parameters that FrameGraph::update can apply in place.
+bool same_structure(
+    FrameGraphDescription const& a,
+    FrameGraphDescription const& b) {
+  if(a.passes().size() != b.passes().size() ||
+     !std::ranges::equal(a.sinks(), b.sinks())) {
+    return false;
+  }
 
-    void operator()(FrameGraphAttachmentOutputDescription const& description) {
-      FrameGraphResource* resource = target_.find_resource(description.name());
-      RNDRX_ASSERT(resource);
-      target_.attachments_.push_back(
-          std::make_unique<FrameGraphAttachment>(device_, description));
-      resource->set_render_resource(target_.attachments_.back().get());
+  auto same_resource = [](auto const& x, auto const& y) {
+    if(x.index() != y.index()) {
+      return false;
     }
 
-    void operator()(FrameGraphBufferDescription const& description) {
-      FrameGraphResource* resource = target_.find_resource(description.name());
-      RNDRX_ASSERT(resource);
-      target_.buffers_.push_back(
-          std::make_unique<FrameGraphBuffer>(device_, description));
-      resource->set_render_resource(target_.buffers_.back().get());
+    FrameGraphNamedObjectFromResourceDescription named_object;
+    return std::visit(named_object, x).name() ==
+           std::visit(named_object, y).name();
+  };
+
+  for(std::size_t i = 0; i < a.passes().size(); ++i) {
+    FrameGraphRenderPassDescription const& pa = a.passes()[i];
+    FrameGraphRenderPassDescription const& pb = b.passes()[i];
+    if(pa.name() != pb.name() || pa.type() != pb.type() ||
+       !std::ranges::equal(pa.inputs(), pb.inputs(), same_resource) ||
+       !std::ranges::equal(pa.outputs(), pb.outputs(), same_resource)) {
+      return false;
     }
 
-    FrameGraph& target_;
+    // Buffer usage decides the barriers, history adds resources and
+    // imported attachments have no images of their own.
+    for(std::size_t j = 0; j < pa.outputs().size(); ++j) {
+      auto buffer_a = std::get_if<FrameGraphBufferDescription>(
+          &pa.outputs()[j]);
+      auto buffer_b = std::get_if<FrameGraphBufferDescription>(
+          &pb.outputs()[j]);
+      if(buffer_a != nullptr && buffer_a->usage() != buffer_b->usage()) {
+        return false;
+      }
+
+      auto attachment_a = std::get_if<FrameGraphAttachmentOutputDescription>(
+          &pa.outputs()[j]);
+      auto attachment_b = std::get_if<FrameGraphAttachmentOutputDescription>(
+          &pb.outputs()[j]);
+      if(attachment_a != nullptr &&
+         (attachment_a->history() != attachment_b->history() ||
+          attachment_a->imported() != attachment_b->imported())) {
+        return false;
+      }
+    }
+
+    for(std::size_t j = 0; j < pa.inputs().size(); ++j) {
+      auto image_a = std::get_if<FrameGraphInputImageDescription>(
+          &pa.inputs()[j]);
+      auto image_b = std::get_if<FrameGraphInputImageDescription>(
+          &pb.inputs()[j]);
+      if(image_a != nullptr &&
+         image_a->previous_frame() != image_b->previous_frame()) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool same_load_state(
+    FrameGraphAttachmentOutputDescription const& a,
+    FrameGraphAttachmentOutputDescription const& b) {
+  return a.load_op() == b.load_op() && a.clear_colour() == b.clear_colour() &&
+         a.clear_depth() == b.clear_depth() &&
+         a.clear_stencil() == b.clear_stencil();
+}
+} // namespace
+
+void FrameGraph::rebuild(
+    FrameGraphBuilder const& builder,
+    FrameGraphDescription const& description) {
+  // Release the current resources first so the new graph can take them
+  // from the pool.
+  *this = FrameGraph();
+  *this = FrameGraph(builder, description);
+}
+
+void FrameGraph::update(
+    FrameGraphBuilder const& builder,
+    FrameGraphDescription const& description) {
+  bool const same_options =
+      builder.thread_pool() == thread_pool_ &&
+      builder.resource_pool() == resource_pool_ &&
+      builder.dynamic_rendering() == dynamic_rendering_ &&
+      builder.profiling().has_value() == (profiler_ != nullptr);
+  if(!same_options || !same_structure(description_, description)) {
+    rebuild(builder, description);
+    return;
+  }
+
+  // Nodes were only merged into a render pass when their extents matched,
+  // if that no longer holds the passes have to be rebuilt.
+  std::vector<vk::Extent2D> extents(nodes_.size());
+  for(auto&& pass : description.passes()) {
+    auto node = node_names_.find(pass.name());
+    if(node == node_names_.end()) {
+      // Culled
+      continue;
+    }
+
+    for(auto&& output : pass.outputs()) {
+      auto attachment = std::get_if<FrameGraphAttachmentOutputDescription>(
+          &output);
+      if(attachment != nullptr) {
+        extents[index(node->second)] = resolve_extent(
+            *attachment,
+            builder.output_extent());
+        break;
+      }
+    }
+  }
+
+  for(auto&& pass : physical_passes_) {
+    vk::Extent2D const pass_extent = extents[pass->first_node()];
+    for(auto&& node : pass->nodes()) {
+      if(extents[node - nodes_.data()] != pass_extent) {
+        rebuild(builder, description);
+        return;
+      }
+    }
+  }
+
+  output_extent_ = builder.output_extent();
+  for(std::size_t i = 0; i < nodes_.size(); ++i) {
+    nodes_[i].set_extent(extents[i]);
+  }
+
+  // Find the attachments whose images have to be recreated, and those
+  // where only the render pass changes.
+  std::vector<FrameGraphAttachmentOutputDescription const*> next_descriptions(
+      resources_.size(),
+      nullptr);
+  std::vector<bool> recreate(resources_.size(), false);
+  std::vector<bool> dirty(resources_.size(), false);
+  bool realias = false;
+  for(std::size_t i = 0; i < description.passes().size(); ++i) {
+    auto previous_outputs = description_.passes()[i].outputs();
+    auto next_outputs = description.passes()[i].outputs();
+    for(std::size_t j = 0; j < next_outputs.size(); ++j) {
+      auto& named_object = std::visit(
+          FrameGraphNamedObjectFromResourceDescription(),
+          next_outputs[j]);
+      FrameGraphResource* resource = find_resource(named_object.name());
+      if(resource == nullptr) {
+        // Culled
+        continue;
+      }
+
+      std::size_t const resource_idx = resource - resources_.data();
+      if(auto buffer = std::get_if<FrameGraphBufferDescription>(
+             &next_outputs[j])) {
+        // Buffers get their memory every frame so only the size is kept.
+        auto const& previous = std::get<FrameGraphBufferDescription>(
+            previous_outputs[j]);
+        if(buffer->size() != previous.size()) {
+          auto old = std::ranges::find_if(
+              buffers_,
+              [resource](std::unique_ptr<FrameGraphBuffer> const& existing) {
+                return existing.get() == resource->get_buffer();
+              });
+          *old = std::make_unique<FrameGraphBuffer>(*buffer);
+          resource->set_render_resource(old->get());
+        }
+        continue;
+      }
+
+      auto const& next = std::get<FrameGraphAttachmentOutputDescription>(
+          next_outputs[j]);
+      auto const& previous = std::get<FrameGraphAttachmentOutputDescription>(
+          previous_outputs[j]);
+      FrameGraphAttachment* attachment = resource->get_attachment();
+      vk::Extent2D const extent = resolve_extent(next, output_extent_);
+      next_descriptions[resource_idx] = &next;
+      if(next.format() != previous.format() ||
+         static_cast<int>(extent.width) != attachment->width() ||
+         static_cast<int>(extent.height) != attachment->height()) {
+        recreate[resource_idx] = true;
+        dirty[resource_idx] = true;
+        realias |= attachment->memory_block() !=
+                   FrameGraphAttachment::kDedicatedMemory;
+      }
+      else if((next.load_op() == AttachmentLoadOp::Load) !=
+              (previous.load_op() == AttachmentLoadOp::Load)) {
+        // Loading decides whether the image can be aliased or transient,
+        // so it moves in or out of the packed attachments.
+        recreate[resource_idx] = true;
+        dirty[resource_idx] = true;
+        realias = true;
+      }
+      else if(!same_load_state(next, previous)) {
+        resource->get_attachment(0)->set_load_state(next);
+        resource->get_attachment(1)->set_load_state(next);
+        dirty[resource_idx] = true;
+      }
+    }
+  }
+
+  // The aliased attachments are packed together, so changing one means
+  // placing all of them again.
+  if(realias) {
+    for(std::size_t i = 0; i < resources_.size(); ++i) {
+      FrameGraphAttachment const* attachment = resources_[i].get_attachment();
+      if(attachment != nullptr && attachment->memory_block() !=
+                                      FrameGraphAttachment::kDedicatedMemory) {
+        recreate[i] = true;
+        dirty[i] = true;
+      }
+    }
+  }
+
+  std::vector<FrameGraphAttachmentOutputDescription const*> recreated;
+  std::vector<FrameGraphAttachment const*> replaced;
+  for(std::size_t i = 0; i < resources_.size(); ++i) {
+    if(!recreate[i]) {
+      continue;
+    }
+
+    recreated.push_back(next_descriptions[i]);
+    // Both images of history resources.
+    replaced.push_back(resources_[i].get_attachment(0));
+    replaced.push_back(resources_[i].get_attachment(1));
+    if(std::optional<FrameGraphResourceHandle> history =
+           resources_[i].history()) {
+      dirty[index(*history)] = true;
+    }
+  }
+
+  if(!recreated.empty()) {
+    // Images go before the memory they are placed in.
+    std::erase_if(
+        attachments_,
+        [&replaced](FrameGraphResourcePool::Attachment const& attachment) {
+          return std::ranges::find(replaced, attachment.get()) !=
+                 replaced.end();
+        });
+    if(realias) {
+      transient_memory_.clear();
+    }
+
+    allocate_attachments(builder.device(), recreated);
+  }
+
+  auto internal_resources = find_pass_internal_resources();
+  auto is_dirty = [&dirty](FrameGraphResourceHandle resource) {
+    return dirty[index(resource)];
+  };
+
+  for(auto&& pass : physical_passes_) {
+    bool const affected = std::ranges::any_of(
+        pass->nodes(),
+        [&is_dirty](FrameGraphNode const* node) {
+          return std::ranges::any_of(node->inputs(), is_dirty) ||
+                 std::ranges::any_of(node->outputs(), is_dirty);
+        });
+    if(!affected) {
+      continue;
+    }
+
+    if(dynamic_rendering_) {
+      pass->create_rendering_info(resources_, internal_resources);
+    }
+    else {
+      pass->create_vk_render_pass(
+          builder.device(),
+          resources_,
+          internal_resources);
+    }
+  }
+
+  if(!recreated.empty()) {
+    // Memory blocks may have changed, and nothing survives in the new
+    // images, so the next frame starts from scratch.
+    build_barriers(builder.device());
+    first_frame_ = true;
+  }
+
+  description_ = description;
+}
+
+void FrameGraph::import_image(
+    std::string_view name,
+    FrameGraphImportedImage const& image) {
+  FrameGraphResource const* resource = find_resource(name);
+  if(resource == nullptr || !resource->is_imported()) {
+    RNDRX_THROW_RUNTIME_ERROR()
+        << "Frame graph has no imported attachment named " << quote(name);
+  }
+
+  auto imported = std::ranges::find(
+      imports_,
+      FrameGraphResourceHandle(resource - resources_.data()),
+      &ImportedAttachment::resource);
+  RNDRX_ASSERT(imported != imports_.end());
+  imported->attachment->import(image.image, image.view);
+  imported->image = image;
+  imported->bound = true;
+}
+
+void FrameGraph::release_imported_images() {
+  for(auto&& pass : physical_passes_) {
+    pass->release_imported_framebuffers();
+  }
+
+  for(auto&& imported : imports_) {
+    imported.attachment->import(nullptr, nullptr);
+    imported.bound = false;
+  }
+}
+
+FrameGraphNode* FrameGraph::find_node(std::string_view name) {
+  auto node = node_names_.find(name);
+  if(node != node_names_.end()) {
+    return &nodes_[index(node->second)];
+  }
+
+  return nullptr;
+}
+
+FrameGraphAttachment const* FrameGraph::find_attachment(
+    std::string_view name) const {
+  auto resource = resource_names_.find(name);
+  if(resource != resource_names_.end()) {
+    return resources_[index(resource->second)].get_attachment();
+  }
+
+  return nullptr;
+}
+
+namespace {
+void set_full_viewport(vk::CommandBuffer cmd, vk::Extent2D image_size) {
+  vk::Rect2D scissor{{0, 0}, image_size};
+  cmd.setScissor(0, scissor);
+
+  vk::Viewport viewport{
+      0,
+      0,
+      static_cast<float>(image_size.width),
+      static_cast<float>(image_size.height),
+      0.f,
+      1.f};
+  cmd.setViewport(0, viewport);
+}
+} // namespace
+
+void FrameGraph::render(SubmissionContext& sc) {
+  // The context's allocator was reset when its previous frame finished,
+  // so buffers get fresh memory every frame.
+  for(auto&& buffer : buffers_) {
+    buffer->bind(
+        sc.transient_buffers().allocate(buffer->size(), buffer->usage()));
+  }
+
+  for(auto&& resource : resources_) {
+    resource.select_history(frame_parity_);
+  }
+
+  for(auto&& imported : imports_) {
+    if(!imported.bound) {
+      RNDRX_THROW_RUNTIME_ERROR()
+          << "No image was imported for "
+          << quote(resources_[index(imported.resource)].name())
+          << " this frame.";
+    }
+  }
+
+  for(auto&& pass : physical_passes_) {
+    if(pass->has_imported_attachments()) {
+      pass->bind_imported_attachments(*device_, frame_parity_);
+    }
+  }
+
+  if(profiler_) {
+    profiler_->begin_frame();
+  }
+
+  bool const parallel = thread_pool_ != nullptr &&
+                        thread_pool_->concurrency() > 1 &&
+                        nodes_.size() > 1;
+  if(parallel) {
+    sc.reserve_recording_threads(thread_pool_->concurrency());
+    node_commands_.resize(nodes_.size());
+    // Nodes of a level don't depend on each other and are recorded
+    // together. Levels are recorded in order so a pass's callbacks still
+    // run after those of the passes it reads from, as they do inline.
+    // Execution order is decided when stitching below.
+    for(std::size_t level = 0; level + 1 < level_begins_.size(); ++level) {
+      std::span<std::uint32_t const> level_nodes =
+          std::span(level_nodes_).subspan(
+              level_begins_[level],
+              level_begins_[level + 1] - level_begins_[level]);
+      thread_pool_->parallel_for(
+          level_nodes.size(),
+          [this, &sc, level_nodes](
+              std::size_t job_idx,
+              std::size_t thread_idx) {
+            record_node_secondaries(sc, level_nodes[job_idx], thread_idx);
+          });
+    }
+  }
+
+  std::uint64_t first_step = 0;
+  if(uses_compute_queue_) {
+    first_step = sc.reserve_timeline_steps(batches_.size());
+  }
+
+  for(std::size_t batch_idx = 0; batch_idx < batches_.size(); ++batch_idx) {
+    QueueBatch const& batch = batches_[batch_idx];
+    // Barriers sit outside of the render passes so they go on the primary.
+    vk::CommandBuffer cmd = sc.command_buffer(batch.queue);
+    if(profiler_) {
+      profiler_->reset_queries(
+          cmd,
+          batch.queue,
+          batch.begin,
+          batch.end - batch.begin);
+    }
+
+    std::size_t i = batch.begin;
+    while(i < batch.end) {
+      FrameGraphNode const& node = nodes_[i];
+      if(node.is_compute()) {
+        record_compute_node(sc, cmd, i, parallel);
+        ++i;
+      }
+      else {
+        record_physical_pass(sc, cmd, *node.physical_pass(), parallel);
+        i += node.physical_pass()->nodes().size();
+      }
+    }
+
+    if(uses_compute_queue_) {
+      submit_batch(sc, batch_idx, first_step);
+    }
+  }
+
+  if(!uses_compute_queue_) {
+    // Everything goes in the caller's final submission.
+    add_import_waits(0, wait_scratch_);
+    for(auto&& wait : wait_scratch_) {
+      sc.wait_semaphore(wait);
+    }
+  }
+
+  // Separate calls so the releases are ordered after the acquires.
+  record_barriers(sc.command_buffer(), tail_acquires_);
+  record_barriers(sc.command_buffer(), tail_releases_);
+  finish_imports(sc);
+  if(profiler_) {
+    profiler_->end_frame();
+  }
+  frame_parity_ ^= 1;
+  first_frame_ = false;
+}
+
+void FrameGraph::add_import_waits(
+    std::size_t batch_idx,
+    std::vector<vk::SemaphoreSubmitInfo>& waits) const {
+  waits.clear();
+  for(auto&& imported : imports_) {
+    if(imported.first_batch == batch_idx && imported.image.acquire_semaphore) {
+      waits.push_back(vk::SemaphoreSubmitInfo()
+                          .setSemaphore(imported.image.acquire_semaphore)
+                          .setStageMask(imported.first_stages));
+    }
+  }
+}
+
+void FrameGraph::finish_imports(SubmissionContext& sc) {
+  if(imports_.empty()) {
+    return;
+  }
+
+  // Recorded in the caller's final submission, which is the one to signal
+  // the release semaphores.
+  for(std::size_t i = 0; i < imports_.size(); ++i) {
+    import_releases_[i].dst.layout = imports_[i].image.final_layout;
+    import_releases_[i].dst.stages = imports_[i].image.final_stages;
+    import_releases_[i].dst.access = imports_[i].image.final_access;
+  }
+
+  record_barriers(sc.command_buffer(), import_releases_);
+  for(auto&& imported : imports_) {
+    if(imported.image.release_semaphore) {
+      sc.signal_semaphore(
+          vk::SemaphoreSubmitInfo()
+              .setSemaphore(imported.image.release_semaphore)
+              .setStageMask(vk::PipelineStageFlagBits2::eAllCommands));
+    }
+
+    imported.bound = false;
+  }
+}
+
+void FrameGraph::submit_batch(
+    SubmissionContext& sc,
+    std::size_t batch_idx,
+    std::uint64_t first_step) {
+  QueueBatch const& batch = batches_[batch_idx];
+  FrameTimeline const& timeline = sc.timeline();
+  std::uint64_t const frame = sc.frame_index();
+
+  add_import_waits(batch_idx, wait_scratch_);
+  for(auto&& wait : batch.waits) {
+    wait_scratch_.push_back(timeline.step_wait_info(
+        batches_[wait.batch].queue,
+        frame,
+        first_step + wait.batch,
+        wait.stages));
+  }
+
+  // The first batch on each queue waits for the whole of the previous
+  // frame; resources are reused across frames without any other
+  // cross-queue synchronisation.
+  bool const first_on_queue = std::ranges::none_of(
+      std::span(batches_).first(batch_idx),
+      [&batch](QueueBatch const& other) { return other.queue == batch.queue; });
+  if(first_on_queue && frame > 1) {
+    for(QueueType queue : {QueueType::Graphics, QueueType::Compute}) {
+      wait_scratch_.push_back(timeline.wait_info(
+          queue,
+          frame - 1,
+          vk::PipelineStageFlagBits2::eAllCommands));
+    }
+  }
+
+  bool const is_last = batch_idx + 1 == batches_.size();
+  if(is_last && batch.queue == QueueType::Graphics) {
+    // Left open so whatever else the caller records this frame goes into
+    // the same submission. Nothing in the frame waits for it, and its
+    // signal of the frame is what the next one waits for.
+    for(auto&& wait : wait_scratch_) {
+      sc.wait_semaphore(wait);
+    }
+
+    return;
+  }
+
+  vk::SemaphoreSubmitInfo const signal = timeline.step_signal_info(
+      batch.queue,
+      frame,
+      first_step + batch_idx);
+  sc.submit(batch.queue, wait_scratch_, std::span(&signal, 1));
+
+  // The caller's final submission waits for the compute queue so sinks
+  // can be acquired on the graphics queue.
+  if(is_last) {
+    sc.wait_semaphore(timeline.step_wait_info(
+        batch.queue,
+        frame,
+        first_step + batch_idx,
+        vk::PipelineStageFlagBits2::eAllCommands));
+  }
+}
+
+void FrameGraph::record_compute_node(
+    SubmissionContext& sc,
+    vk::CommandBuffer cmd,
+    std::size_t node_idx,
+    bool parallel) {
+  FrameGraphNode const& node = nodes_[node_idx];
+  record_barriers(cmd, node.barriers());
+  if(parallel) {
+    cmd.executeCommands(node_commands_[node_idx].render);
+  }
+  else {
+    begin_profiling(cmd, node_idx);
+    node.render_pass()->pre_render(sc, cmd);
+    node.render_pass()->render(sc, cmd);
+    node.render_pass()->post_render(sc, cmd);
+    end_profiling(cmd, node_idx);
+  }
+  record_barriers(cmd, node.release_barriers());
+}
+
+void FrameGraph::record_physical_pass(
+    SubmissionContext& sc,
+    vk::CommandBuffer cmd,
+    FrameGraphPhysicalPass const& pass,
+    bool parallel) {
+  // Nothing but the subpasses themselves can go inside the render pass, so
+  // barriers and the pre and post work of every node are recorded around it.
+  for(auto&& node : pass.nodes()) {
+    record_barriers(cmd, node->barriers());
+  }
+
+  if(parallel) {
+    std::span<NodeCommands const> commands(
+        node_commands_.data() + pass.first_node(),
+        pass.nodes().size());
+    for(auto&& node_commands : commands) {
+      cmd.executeCommands(node_commands.pre_render);
+    }
+
+    pass.begin(
+        cmd,
+        vk::SubpassContents::eSecondaryCommandBuffers,
+        frame_parity_);
+    for(std::size_t i = 0; i < commands.size(); ++i) {
+      if(i > 0) {
+        pass.next_subpass(cmd, vk::SubpassContents::eSecondaryCommandBuffers);
+      }
+      cmd.executeCommands(commands[i].render);
+    }
+    pass.end(cmd);
+
+    for(auto&& node_commands : commands) {
+      cmd.executeCommands(node_commands.post_render);
+    }
+  }
+  else {
+    set_full_viewport(cmd, sc.render_extents().extent);
+    for(auto&& node : pass.nodes()) {
+      node->render_pass()->pre_render(sc, cmd);
+    }
+
+    pass.begin(cmd, vk::SubpassContents::eInline, frame_parity_);
+    for(std::size_t i = 0; i < pass.nodes().size(); ++i) {
+      if(i > 0) {
+        pass.next_subpass(cmd, vk::SubpassContents::eInline);
+      }
+      begin_profiling(cmd, pass.first_node() + i);
+      pass.nodes()[i]->render_pass()->render(sc, cmd);
+      end_profiling(cmd, pass.first_node() + i);
+    }
+    pass.end(cmd);
+
+    for(auto&& node : pass.nodes()) {
+      node->render_pass()->post_render(sc, cmd);
+    }
+  }
+
+  for(auto&& node : pass.nodes()) {
+    record_barriers(cmd, node->release_barriers());
+  }
+}
+
+void FrameGraph::record_node_secondaries(
+    SubmissionContext& sc,
+    std::size_t node_idx,
+    std::size_t thread_idx) {
+  FrameGraphNode const& node = nodes_[node_idx];
+  NodeCommands& commands = node_commands_[node_idx];
+
+  vk::CommandBufferInheritanceInfo outside_pass_inheritance;
+  if(node.is_compute()) {
+    // Nothing needs splitting around a render pass.
+    commands.pre_render = nullptr;
+    commands.post_render = nullptr;
+    commands.render = sc.secondary_command_buffer(thread_idx, node.queue());
+    commands.render.begin(
+        vk::CommandBufferBeginInfo()
+            .setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit)
+            .setPInheritanceInfo(&outside_pass_inheritance));
+    begin_profiling(commands.render, node_idx);
+    node.render_pass()->pre_render(sc, commands.render);
+    node.render_pass()->render(sc, commands.render);
+    node.render_pass()->post_render(sc, commands.render);
+    end_profiling(commands.render, node_idx);
+    commands.render.end();
+    return;
+  }
+
+  FrameGraphPhysicalPass const& pass = *node.physical_pass();
+  vk::CommandBufferInheritanceRenderingInfo rendering_inheritance;
+  vk::CommandBufferInheritanceInfo inside_pass_inheritance;
+  if(pass.dynamic_rendering()) {
+    rendering_inheritance //
+        .setColorAttachmentFormats(pass.colour_formats())
+        .setDepthAttachmentFormat(pass.depth_format())
+        .setStencilAttachmentFormat(pass.stencil_format())
+        .setRasterizationSamples(vk::SampleCountFlagBits::e1);
+    inside_pass_inheritance.setPNext(&rendering_inheritance);
+  }
+  else {
+    inside_pass_inheritance //
+        .setRenderPass(pass.vk_render_pass())
+        .setSubpass(node.subpass())
+        .setFramebuffer(pass.vk_frame_buffer(frame_parity_));
+  }
+
+  commands.pre_render = sc.secondary_command_buffer(thread_idx);
+  commands.pre_render.begin(
+      vk::CommandBufferBeginInfo()
+          .setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit)
+          .setPInheritanceInfo(&outside_pass_inheritance));
+  node.render_pass()->pre_render(sc, commands.pre_render);
+  commands.pre_render.end();
+
+  // Dynamic state isn't inherited, so each secondary sets its own viewport.
+  commands.render = sc.secondary_command_buffer(thread_idx);
+  commands.render.begin(
+      vk::CommandBufferBeginInfo()
+          .setFlags(
+              vk::CommandBufferUsageFlagBits::eOneTimeSubmit |
+              vk::CommandBufferUsageFlagBits::eRenderPassContinue)
+          .setPInheritanceInfo(&inside_pass_inheritance));
+  set_full_viewport(commands.render, sc.render_extents().extent);
+  begin_profiling(commands.render, node_idx);
+  node.render_pass()->render(sc, commands.render);
+  end_profiling(commands.render, node_idx);
+  commands.render.end();
+
+  commands.post_render = sc.secondary_command_buffer(thread_idx);
+  commands.post_render.begin(
+      vk::CommandBufferBeginInfo()
+          .setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit)
+          .setPInheritanceInfo(&outside_pass_inheritance));
+  node.render_pass()->post_render(sc, commands.post_render);
+  commands.post_render.end();
+}
+
+void FrameGraph::begin_profiling(
+    vk::CommandBuffer cmd,
+    std::size_t node_idx) const {
+  if(profiler_) {
+    profiler_->begin_node(cmd, node_idx);
+  }
+}
+
+void FrameGraph::end_profiling(
+    vk::CommandBuffer cmd,
+    std::size_t node_idx) const {
+  if(profiler_) {
+    profiler_->end_node(cmd, node_idx);
+  }
+}
+
+void FrameGraph::record_barriers(
+    vk::CommandBuffer cmd,
+    std::span<FrameGraphBarrier const> barriers) {
+  if(barriers.empty()) {
+    return;
+  }
+
+  image_barrier_scratch_.clear();
+  buffer_barrier_scratch_.clear();
+  for(auto&& barrier : barriers) {
+    FrameGraphResource const& resource = resources_[index(barrier.resource)];
+    if(FrameGraphBuffer const* buffer = resource.get_buffer()) {
+      buffer_barrier_scratch_.push_back(
+          vk::BufferMemoryBarrier2()
+              .setSrcStageMask(barrier.src.stages)
+              .setSrcAccessMask(barrier.src.access)
+              .setDstStageMask(barrier.dst.stages)
+              .setDstAccessMask(barrier.dst.access)
+              .setBuffer(buffer->vk_buffer())
+              .setOffset(buffer->offset())
+              .setSize(buffer->size()));
+      continue;
+    }
+
+    FrameGraphAttachment const* attachment = resource.get_attachment();
+    if(attachment == nullptr) {
+      continue;
+    }
+
+    // Nothing has been written yet on the first frame so the layout
+    // from the end of the previous frame doesn't exist, and neither does
+    // the release of an ownership transfer.
+    bool const no_previous_frame = barrier.across_frames && first_frame_;
+    vk::ImageLayout old_layout = barrier.discard || no_previous_frame
+                                     ? vk::ImageLayout::eUndefined
+                                     : barrier.src.layout;
+    image_barrier_scratch_.push_back(
+        vk::ImageMemoryBarrier2()
+            .setSrcStageMask(barrier.src.stages)
+            .setSrcAccessMask(barrier.src.access)
+            .setDstStageMask(barrier.dst.stages)
+            .setDstAccessMask(barrier.dst.access)
+            .setOldLayout(old_layout)
+            .setNewLayout(barrier.dst.layout)
+            .setSrcQueueFamilyIndex(
+                no_previous_frame ? VK_QUEUE_FAMILY_IGNORED
+                                  : barrier.src_queue_family)
+            .setDstQueueFamilyIndex(
+                no_previous_frame ? VK_QUEUE_FAMILY_IGNORED
+                                  : barrier.dst_queue_family)
+            .setImage(attachment->vk_image())
+            .setSubresourceRange(vk::ImageSubresourceRange(
+                attachment->aspect_mask(),
+                0,
+                1,
+                0,
+                1)));
+  }
+
+  if(!image_barrier_scratch_.empty() || !buffer_barrier_scratch_.empty()) {
+    cmd.pipelineBarrier2(
+        vk::DependencyInfo()
+            .setBufferMemoryBarriers(buffer_barrier_scratch_)
+            .setImageMemoryBarriers(image_barrier_scratch_));
+  }
+}
+
+void FrameGraph::parse_description(
+    FrameGraphBuilder const& builder,
+    FrameGraphDescription const& description) {
+  std::size_t num_inputs = 0;
+  std::size_t num_outputs = 0;
+  std::size_t num_history = 0;
+  for(auto&& pass : description.passes()) {
+    num_inputs += pass.inputs().size();
+    num_outputs += pass.outputs().size();
+    num_history += std::ranges::count_if(
+        pass.outputs(),
+        [](FrameGraphOutputDescription const& output) {
+          auto attachment = std::get_if<FrameGraphAttachmentOutputDescription>(
+              &output);
+          return attachment != nullptr && attachment->history();
+        });
+  }
+
+  // Everything is sized up front; the name maps and the nodes' spans point
+  // into these tables so they must not reallocate.
+  std::size_t const num_passes = description.passes().size();
+  nodes_.reserve(num_passes);
+  resources_.reserve(num_outputs + num_history);
+  node_inputs_.reserve(num_inputs);
+  node_input_usages_.reserve(num_inputs);
+  node_outputs_.reserve(num_outputs);
+  node_output_usages_.reserve(num_outputs);
+  node_names_.reserve(num_passes);
+  resource_names_.reserve(num_outputs);
+
+  for(auto&& pass : description.passes()) {
+    auto render_impl = builder.find_render_pass(pass.name());
+    if(render_impl == nullptr) {
+      RNDRX_THROW_RUNTIME_ERROR()
+          << "Failed to find render pass implementation named " << pass.name()
+          << ". Did you forget at call add_render_pass()?";
+    }
+
+    bool const is_compute = pass.type() != FrameGraphPassType::Graphics;
+    // Without a separate compute family async work simply runs in order
+    // on the graphics queue.
+    QueueType const queue = pass.type() == FrameGraphPassType::AsyncCompute &&
+                                    builder.device().has_async_compute()
+                                ? QueueType::Compute
+                                : QueueType::Graphics;
+    auto const handle = FrameGraphNodeHandle(nodes_.size());
+    FrameGraphNode& producer = nodes_.emplace_back(
+        std::string(pass.name()),
+        render_impl,
+        is_compute,
+        queue);
+    if(!node_names_.emplace(producer.name(), handle).second) {
+      RNDRX_THROW_RUNTIME_ERROR()
+          << "Found duplicate pass " << quote(pass.name());
+    }
+
+    for(auto&& output : pass.outputs()) {
+      auto& output_named_object = std::visit(
+          FrameGraphNamedObjectFromResourceDescription(),
+          output);
+      auto const resource = FrameGraphResourceHandle(resources_.size());
+      FrameGraphResource& added = resources_.emplace_back(
+          std::string(output_named_object.name()),
+          handle);
+      if(!resource_names_.emplace(added.name(), resource).second) {
+        RNDRX_THROW_RUNTIME_ERROR()
+            << "Found duplicate output " << quote(output_named_object.name())
+            << " on pass " << quote(pass.name());
+      }
+
+      node_outputs_.push_back(resource);
+      node_output_usages_.push_back(
+          std::visit(OutputUsageFromDescription{is_compute}, output));
+
+      auto attachment = std::get_if<FrameGraphAttachmentOutputDescription>(
+          &output);
+      if(attachment != nullptr && producer.extent() == vk::Extent2D()) {
+        producer.set_extent(resolve_extent(*attachment, output_extent_));
+      }
+
+      if(attachment != nullptr && attachment->imported()) {
+        if(attachment->history() || queue == QueueType::Compute) {
+          RNDRX_THROW_RUNTIME_ERROR()
+              << "Imported attachment " << quote(attachment->name())
+              << " can't keep history or be written on the async compute "
+                 "queue.";
+        }
+
+        resources_[index(resource)].set_imported(true);
+      }
+
+      if(attachment != nullptr && attachment->history()) {
+        if(queue == QueueType::Compute) {
+          RNDRX_THROW_RUNTIME_ERROR()
+              << "History attachment " << quote(attachment->name())
+              << " can't be written on the async compute queue.";
+        }
+
+        // Reads of the previous frame go through a resource of their own
+        // so barriers are tracked separately for each image. It isn't
+        // named, inputs find it through the current frame's resource.
+        auto const previous = FrameGraphResourceHandle(resources_.size());
+        resources_.emplace_back(
+            std::string(attachment->name()) + " (previous)",
+            handle);
+        resources_[index(resource)].set_history(previous, false);
+        resources_[index(previous)].set_history(resource, true);
+      }
+    }
+  }
+
+  // Inputs can name the outputs of any pass so they are resolved once
+  // every output is known.
+  std::size_t outputs_begin = 0;
+  for(std::size_t i = 0; i < num_passes; ++i) {
+    FrameGraphRenderPassDescription const& pass = description.passes()[i];
+    std::size_t const inputs_begin = node_inputs_.size();
+    for(auto&& input : pass.inputs()) {
+      auto& named_object = std::visit(
+          FrameGraphNamedObjectFromResourceDescription(),
+          input);
+      auto resource = resource_names_.find(named_object.name());
+      if(resource == resource_names_.end()) {
+        RNDRX_THROW_RUNTIME_ERROR()
+            << "Failed to find output named " << quote(named_object.name())
+            << " for pass " << quote(pass.name());
+      }
+
+      FrameGraphResourceHandle handle = resource->second;
+      auto image = std::get_if<FrameGraphInputImageDescription>(&input);
+      if(image != nullptr && image->previous_frame()) {
+        std::optional<FrameGraphResourceHandle> previous =
+            resources_[index(handle)].history();
+        if(!previous) {
+          RNDRX_THROW_RUNTIME_ERROR()
+              << "Pass " << quote(pass.name()) << " reads the previous frame of "
+              << quote(image->name()) << " which isn't a history attachment.";
+        }
+
+        if(nodes_[i].queue() == QueueType::Compute) {
+          RNDRX_THROW_RUNTIME_ERROR()
+              << "History attachment " << quote(image->name())
+              << " can't be read on the async compute queue.";
+        }
+
+        handle = *previous;
+      }
+
+      FrameGraphResourceUsage usage = std::visit(
+          InputUsageFromDescription(),
+          input);
+      if(usage == FrameGraphResourceUsage::InputAttachment &&
+         pass.type() != FrameGraphPassType::Graphics) {
+        RNDRX_THROW_RUNTIME_ERROR()
+            << "Compute pass " << quote(pass.name())
+            << " can't read input attachments, sample them instead.";
+      }
+
+      // Without subpasses the producer has finished by the time the node
+      // reads the attachment, so it is sampled like any other image. This
+      // also stops build_physical_passes from merging anything.
+      if(usage == FrameGraphResourceUsage::InputAttachment &&
+         dynamic_rendering_) {
+        usage = FrameGraphResourceUsage::SampledImage;
+      }
+
+      node_inputs_.push_back(handle);
+      node_input_usages_.push_back(usage);
+    }
+
+    std::size_t const num_node_inputs = node_inputs_.size() - inputs_begin;
+    std::size_t const num_node_outputs = pass.outputs().size();
+    nodes_[i].set_resources(
+        std::span(node_inputs_).subspan(inputs_begin, num_node_inputs),
+        std::span(node_input_usages_).subspan(inputs_begin, num_node_inputs),
+        std::span(node_outputs_).subspan(outputs_begin, num_node_outputs),
+        std::span(node_output_usages_)
+            .subspan(outputs_begin, num_node_outputs));
+    outputs_begin += num_node_outputs;
+  }
+}
+
+std::vector<bool> FrameGraph::cull_nodes(
+    FrameGraphDescription const& description) {
+  std::vector<bool> live(nodes_.size(), description.sinks().empty());
+  if(description.sinks().empty()) {
+    return live;
+  }
+
+  std::vector<FrameGraphNodeHandle> to_visit;
+  for(auto&& sink : description.sinks()) {
+    auto resource = resource_names_.find(sink);
+    if(resource == resource_names_.end()) {
+      RNDRX_THROW_RUNTIME_ERROR()
+          << "Failed to find sink resource named " << quote(sink);
+    }
+
+    to_visit.push_back(resources_[index(resource->second)].producer());
+    sinks_.push_back(resource->second);
+  }
+
+  // Imported images are always results of the graph.
+  for(std::size_t i = 0; i < resources_.size(); ++i) {
+    auto const handle = FrameGraphResourceHandle(i);
+    if(resources_[i].is_imported() &&
+       std::ranges::find(sinks_, handle) == sinks_.end()) {
+      to_visit.push_back(resources_[i].producer());
+      sinks_.push_back(handle);
+    }
+  }
+
+  // Walk back from the sinks; anything not reached doesn't contribute.
+  while(!to_visit.empty()) {
+    FrameGraphNodeHandle node = to_visit.back();
+    to_visit.pop_back();
+    if(live[index(node)]) {
+      continue;
+    }
+
+    live[index(node)] = true;
+    for(auto&& input : nodes_[index(node)].inputs()) {
+      to_visit.push_back(resources_[index(input)].producer());
+    }
+  }
+
+  std::size_t const num_culled_nodes = std::count(
+      live.begin(),
+      live.end(),
+      false);
+  if(num_culled_nodes > 0) {
+    std::size_t const num_culled_resources = std::ranges::count_if(
+        resources_,
+        [&live](FrameGraphResource const& resource) {
+          return !live[index(resource.producer())];
+        });
+    LOG(Info) << "Frame graph culled " << num_culled_nodes << " passes and "
+              << num_culled_resources << " resources not contributing to sinks.";
+  }
+
+  return live;
+}
+
+namespace {
+// A rough size for an image of format, enough to compare schedules by the
+// memory they keep live.
+vk::DeviceSize bytes_per_pixel(vk::Format format) {
+  switch(format) {
+    case vk::Format::eR8Unorm:
+    case vk::Format::eR8Snorm:
+    case vk::Format::eR8Uint:
+    case vk::Format::eR8Sint:
+    case vk::Format::eS8Uint:
+      return 1;
+    case vk::Format::eR8G8Unorm:
+    case vk::Format::eR8G8Snorm:
+    case vk::Format::eR16Unorm:
+    case vk::Format::eR16Sfloat:
+    case vk::Format::eR16Uint:
+    case vk::Format::eD16Unorm:
+      return 2;
+    case vk::Format::eR16G16B16A16Unorm:
+    case vk::Format::eR16G16B16A16Snorm:
+    case vk::Format::eR16G16B16A16Sfloat:
+    case vk::Format::eR16G16B16A16Uint:
+    case vk::Format::eR32G32Sfloat:
+    case vk::Format::eR32G32Uint:
+    case vk::Format::eD32SfloatS8Uint:
+      return 8;
+    case vk::Format::eR32G32B32Sfloat:
+      return 12;
+    case vk::Format::eR32G32B32A32Sfloat:
+    case vk::Format::eR32G32B32A32Uint:
+    case vk::Format::eR32G32B32A32Sint:
+      return 16;
+    default:
+      return 4;
+  }
+}
+
+// Lower is better, compared in order. Keeping a chain of input attachment
+// reads going lets build_physical_passes merge it into subpasses, which
+// removes its barriers altogether. Async compute goes as early as possible
+// so it overlaps the graphics work recorded after it. After that, nodes
+// that don't read what the previous node just wrote avoid a barrier that
+// would stall on it, and then the schedule with the lowest peak of live
+// memory wins, preferring nodes that free the most. Ties keep the
+// declaration order, so the schedule is the same on every run.
+struct ScheduleCost {
+  int merges = 0;
+  int async_compute = 0;
+  std::size_t stalls = 0;
+  vk::DeviceSize peak_bytes = 0;
+  std::int64_t net_bytes = 0;
+  std::size_t node = 0;
+
+  auto operator<=>(ScheduleCost const&) const = default;
+};
+} // namespace
+
+std::vector<FrameGraphNodeHandle> FrameGraph::sort_nodes(
+    std::vector<bool> const& live) const {
+  // Memory a resource keeps live from its producer to its last reader.
+  // Sinks and history outlive the frame.
+  std::vector<vk::DeviceSize> footprint(resources_.size(), 0);
+  for(auto&& pass : description_.passes()) {
+    for(auto&& output : pass.outputs()) {
+      auto& named_object = std::visit(
+          FrameGraphNamedObjectFromResourceDescription(),
+          output);
+      auto resource = resource_names_.find(named_object.name());
+      if(resource == resource_names_.end()) {
+        continue;
+      }
+
+      if(auto attachment = std::get_if<FrameGraphAttachmentOutputDescription>(
+             &output)) {
+        vk::Extent2D const extent = resolve_extent(*attachment, output_extent_);
+        footprint[index(resource->second)] =
+            vk::DeviceSize(extent.width) * extent.height *
+            bytes_per_pixel(to_vulkan_format(attachment->format()));
+      }
+      else {
+        footprint[index(resource->second)] =
+            std::get<FrameGraphBufferDescription>(output).size();
+      }
+    }
+  }
+
+  std::vector<std::size_t> readers(resources_.size(), 0);
+  std::vector<bool> outlives_frame(resources_.size(), false);
+  for(std::size_t i = 0; i < nodes_.size(); ++i) {
+    if(!live[i]) {
+      continue;
+    }
+
+    for(auto&& input : nodes_[i].inputs()) {
+      ++readers[index(input)];
+    }
+  }
+
+  for(auto&& sink : sinks_) {
+    outlives_frame[index(sink)] = true;
+  }
+
+  for(std::size_t i = 0; i < resources_.size(); ++i) {
+    if(resources_[i].history() || readers[i] == 0) {
+      outlives_frame[i] = true;
+    }
+  }
+
+  auto is_ready = [&](std::size_t node, std::vector<bool> const& scheduled) {
+    return std::ranges::all_of(
+        nodes_[node].inputs(),
+        [&](FrameGraphResourceHandle input) {
+          FrameGraphResource const& resource = resources_[index(input)];
+          return resource.is_previous_frame() ||
+                 scheduled[index(resource.producer())];
+        });
+  };
+
+  std::size_t const num_live = std::count(live.begin(), live.end(), true);
+  std::vector<bool> scheduled(nodes_.size(), false);
+  std::vector<FrameGraphNodeHandle> sorted_nodes;
+  sorted_nodes.reserve(num_live);
+  vk::DeviceSize live_bytes = 0;
+  vk::DeviceSize peak_bytes = 0;
+  while(sorted_nodes.size() < num_live) {
+    FrameGraphNode const* previous =
+        sorted_nodes.empty() ? nullptr : &nodes_[index(sorted_nodes.back())];
+    std::optional<ScheduleCost> best;
+    for(std::size_t i = 0; i < nodes_.size(); ++i) {
+      if(!live[i] || scheduled[i] || !is_ready(i, scheduled)) {
+        continue;
+      }
+
+      FrameGraphNode const& node = nodes_[i];
+      ScheduleCost cost;
+      cost.node = i;
+
+      bool reads_previous = false;
+      bool samples_previous = false;
+      vk::DeviceSize freed = 0;
+      for(std::size_t j = 0; j < node.inputs().size(); ++j) {
+        FrameGraphResourceHandle const input = node.inputs()[j];
+        FrameGraphResource const& resource = resources_[index(input)];
+        if(previous != nullptr && !resource.is_previous_frame() &&
+           &nodes_[index(resource.producer())] == previous) {
+          ++cost.stalls;
+          if(node.input_usages()[j] == FrameGraphResourceUsage::InputAttachment) {
+            reads_previous = true;
+          }
+          else {
+            samples_previous = true;
+          }
+        }
+
+        if(readers[index(input)] == 1 && !outlives_frame[index(input)]) {
+          freed += footprint[index(input)];
+        }
+      }
+
+      bool const merges = previous != nullptr && !previous->is_compute() &&
+                          !node.is_compute() &&
+                          previous->queue() == node.queue() &&
+                          previous->extent() == node.extent() &&
+                          reads_previous && !samples_previous;
+      if(merges) {
+        cost.merges = -1;
+        cost.stalls = 0;
+      }
+
+      if(node.queue() == QueueType::Compute) {
+        cost.async_compute = -1;
+      }
+
+      vk::DeviceSize allocated = 0;
+      for(auto&& output : node.outputs()) {
+        allocated += footprint[index(output)];
+      }
+
+      cost.peak_bytes = std::max(peak_bytes, live_bytes + allocated);
+      cost.net_bytes = static_cast<std::int64_t>(allocated) -
+                       static_cast<std::int64_t>(freed);
+      if(!best || cost < *best) {
+        best = cost;
+      }
+    }
+
+    if(!best) {
+      // Every unscheduled node waits on an unscheduled producer, so
+      // following producers from any of them must come back around. The
+      // node first reached twice is on the cycle, unlike the start.
+      std::size_t node = *std::ranges::find_if(
+          std::views::iota(std::size_t(0), nodes_.size()),
+          [&](std::size_t i) { return live[i] && !scheduled[i]; });
+      std::vector<std::size_t> path;
+      std::vector<std::size_t> path_position(nodes_.size(), nodes_.size());
+      while(path_position[node] == nodes_.size()) {
+        path_position[node] = path.size();
+        path.push_back(node);
+        for(auto&& input : nodes_[node].inputs()) {
+          FrameGraphResource const& resource = resources_[index(input)];
+          if(!resource.is_previous_frame() &&
+             !scheduled[index(resource.producer())]) {
+            node = index(resource.producer());
+            break;
+          }
+        }
+      }
+
+      // Producers were followed backwards; report the passes in the order
+      // they feed each other.
+      std::ostringstream cycle;
+      cycle << quote(nodes_[node].name());
+      for(std::size_t i = path.size(); i-- > path_position[node];) {
+        cycle << " -> " << quote(nodes_[path[i]].name());
+      }
+
+      RNDRX_THROW_RUNTIME_ERROR() << "Frame graph has a cycle: "
+                                  << cycle.str();
+    }
+
+    FrameGraphNode const& node = nodes_[best->node];
+    for(auto&& output : node.outputs()) {
+      live_bytes += footprint[index(output)];
+    }
+
+    peak_bytes = std::max(peak_bytes, live_bytes);
+    for(auto&& input : node.inputs()) {
+      if(--readers[index(input)] == 0 && !outlives_frame[index(input)]) {
+        live_bytes -= footprint[index(input)];
+      }
+    }
+
+    scheduled[best->node] = true;
+    sorted_nodes.push_back(FrameGraphNodeHandle(best->node));
+  }
+
+  return sorted_nodes;
+}
+
+void FrameGraph::compact_nodes(std::span<FrameGraphNodeHandle const> order) {
+  // Rebuild every table in execution order, dropping culled nodes and the
+  // resources they would have produced. Afterwards a node's handle is its
+  // position in the schedule.
+  static constexpr std::uint32_t kRemoved = ~std::uint32_t(0);
+  std::vector<std::uint32_t> node_remap(nodes_.size(), kRemoved);
+  std::vector<std::uint32_t> resource_remap(resources_.size(), kRemoved);
+  std::vector<FrameGraphResource> resources;
+  resources.reserve(resources_.size());
+  for(std::uint32_t i = 0; i < order.size(); ++i) {
+    node_remap[index(order[i])] = i;
+    for(auto&& output : nodes_[index(order[i])].outputs()) {
+      // The previous frame of a history resource follows it.
+      std::optional<FrameGraphResourceHandle> history =
+          resources_[index(output)].history();
+      for(auto&& resource : {std::optional(output), history}) {
+        if(!resource) {
+          continue;
+        }
+
+        resource_remap[index(*resource)] = static_cast<std::uint32_t>(
+            resources.size());
+        resources.push_back(std::move(resources_[index(*resource)]));
+        resources.back().set_producer(FrameGraphNodeHandle(i));
+      }
+    }
+  }
+
+  for(auto&& resource : resources) {
+    if(std::optional<FrameGraphResourceHandle> history = resource.history()) {
+      resource.set_history(
+          FrameGraphResourceHandle(resource_remap[index(*history)]),
+          resource.is_previous_frame());
+    }
+  }
+
+  std::vector<FrameGraphNode> nodes;
+  std::vector<FrameGraphResourceHandle> inputs;
+  std::vector<FrameGraphResourceUsage> input_usages;
+  std::vector<FrameGraphResourceHandle> outputs;
+  std::vector<FrameGraphResourceUsage> output_usages;
+  std::vector<std::pair<std::size_t, std::size_t>> resource_counts;
+  nodes.reserve(order.size());
+  inputs.reserve(node_inputs_.size());
+  input_usages.reserve(node_inputs_.size());
+  outputs.reserve(resources.size());
+  output_usages.reserve(resources.size());
+  resource_counts.reserve(order.size());
+  for(auto&& handle : order) {
+    FrameGraphNode& node = nodes_[index(handle)];
+    // Live nodes only read from live nodes, so every input is remapped.
+    for(auto&& input : node.inputs()) {
+      inputs.push_back(FrameGraphResourceHandle(resource_remap[index(input)]));
+    }
+
+    for(auto&& output : node.outputs()) {
+      outputs.push_back(
+          FrameGraphResourceHandle(resource_remap[index(output)]));
+    }
+
+    input_usages.insert(
+        input_usages.end(),
+        node.input_usages().begin(),
+        node.input_usages().end());
+    output_usages.insert(
+        output_usages.end(),
+        node.output_usages().begin(),
+        node.output_usages().end());
+    resource_counts.emplace_back(node.inputs().size(), node.outputs().size());
+    nodes.push_back(std::move(node));
+  }
+
+  nodes_ = std::move(nodes);
+  resources_ = std::move(resources);
+  node_inputs_ = std::move(inputs);
+  node_input_usages_ = std::move(input_usages);
+  node_outputs_ = std::move(outputs);
+  node_output_usages_ = std::move(output_usages);
+
+  std::size_t inputs_begin = 0;
+  std::size_t outputs_begin = 0;
+  node_names_.clear();
+  for(std::uint32_t i = 0; i < nodes_.size(); ++i) {
+    auto [num_inputs, num_outputs] = resource_counts[i];
+    nodes_[i].set_resources(
+        std::span(node_inputs_).subspan(inputs_begin, num_inputs),
+        std::span(node_input_usages_).subspan(inputs_begin, num_inputs),
+        std::span(node_outputs_).subspan(outputs_begin, num_outputs),
+        std::span(node_output_usages_).subspan(outputs_begin, num_outputs));
+    inputs_begin += num_inputs;
+    outputs_begin += num_outputs;
+    node_names_.emplace(nodes_[i].name(), FrameGraphNodeHandle(i));
+  }
+
+  resource_names_.clear();
+  for(std::uint32_t i = 0; i < resources_.size(); ++i) {
+    if(!resources_[i].is_previous_frame()) {
+      resource_names_.emplace(
+          resources_[i].name(),
+          FrameGraphResourceHandle(i));
+    }
+  }
+
+  for(auto&& sink : sinks_) {
+    sink = FrameGraphResourceHandle(resource_remap[index(sink)]);
+  }
+}
+
+void FrameGraph::build_edges() {
+  std::vector<std::pair<FrameGraphNodeHandle, FrameGraphNodeHandle>> edges;
+  edges.reserve(node_inputs_.size());
+  for(std::uint32_t i = 0; i < nodes_.size(); ++i) {
+    for(auto&& input : nodes_[i].inputs()) {
+      if(resources_[index(input)].is_previous_frame()) {
+        continue;
+      }
+
+      edges.emplace_back(
+          resources_[index(input)].producer(),
+          FrameGraphNodeHandle(i));
+    }
+  }
+
+  // Grouped by producer so each node's dependents are contiguous.
+  std::ranges::sort(edges);
+  auto duplicates = std::ranges::unique(edges);
+  edges.erase(duplicates.begin(), duplicates.end());
+
+  node_dependents_.clear();
+  node_dependents_.reserve(edges.size());
+  for(auto&& edge : edges) {
+    node_dependents_.push_back(edge.second);
+  }
+
+  std::size_t begin = 0;
+  for(std::size_t i = 0; i < nodes_.size(); ++i) {
+    std::size_t end = begin;
+    while(end < edges.size() && index(edges[end].first) == i) {
+      ++end;
+    }
+
+    nodes_[i].set_dependents(
+        std::span(node_dependents_).subspan(begin, end - begin));
+    begin = end;
+  }
+
+  // Nodes are sorted, so every producer's level is final before its
+  // dependents are visited.
+  std::vector<std::uint32_t> levels(nodes_.size(), 0);
+  std::uint32_t num_levels = nodes_.empty() ? 0 : 1;
+  for(std::size_t i = 0; i < nodes_.size(); ++i) {
+    for(FrameGraphNodeHandle dependent : nodes_[i].dependents()) {
+      levels[index(dependent)] = std::max(
+          levels[index(dependent)],
+          levels[i] + 1);
+      num_levels = std::max(num_levels, levels[index(dependent)] + 1);
+    }
+  }
+
+  level_nodes_.resize(nodes_.size());
+  std::iota(level_nodes_.begin(), level_nodes_.end(), 0);
+  std::ranges::stable_sort(level_nodes_, {}, [&levels](std::uint32_t node) {
+    return levels[node];
+  });
+
+  level_begins_.assign(num_levels + 1, 0);
+  for(std::uint32_t level : levels) {
+    ++level_begins_[level + 1];
+  }
+
+  std::partial_sum(
+      level_begins_.begin(),
+      level_begins_.end(),
+      level_begins_.begin());
+}
+
+void FrameGraph::build_physical_passes() {
+  physical_passes_.clear();
+  std::size_t i = 0;
+  while(i < nodes_.size()) {
+    FrameGraphNode* first = &nodes_[i];
+    if(first->is_compute()) {
+      ++i;
+      continue;
+    }
+
+    std::vector<FrameGraphNode*> nodes = {first};
+
+    // Grow the chain while the next node has the same size and reads
+    // something from it, and does so only through input attachments.
+    // The chain is a contiguous run of nodes, so anything it produced has
+    // a producer at or after its first node.
+    for(std::size_t next = i + 1; next < nodes_.size(); ++next) {
+      FrameGraphNode* node = &nodes_[next];
+      if(node->is_compute() || node->queue() != first->queue() ||
+         node->extent() != first->extent()) {
+        break;
+      }
+
+      bool reads_chain = false;
+      bool samples_chain = false;
+      for(std::size_t j = 0; j < node->inputs().size(); ++j) {
+        FrameGraphResource const& input = resources_[index(node->inputs()[j])];
+        if(index(input.producer()) < i || input.is_previous_frame()) {
+          continue;
+        }
+
+        if(node->input_usages()[j] == FrameGraphResourceUsage::InputAttachment) {
+          reads_chain = true;
+        }
+        else {
+          samples_chain = true;
+        }
+      }
+
+      if(!reads_chain || samples_chain) {
+        break;
+      }
+
+      nodes.push_back(node);
+    }
+
+    std::size_t const num_nodes = nodes.size();
+    physical_passes_.push_back(
+        std::make_unique<FrameGraphPhysicalPass>(i, std::move(nodes)));
+    i += num_nodes;
+  }
+}
+
+std::vector<bool> FrameGraph::find_pass_internal_resources() const {
+  // Resources consumed by something other than the subpasses of the
+  // physical pass that produced them. Whatever doesn't escape is dead once
+  // the pass ends, so it needn't be stored.
+  std::vector<bool> escaping(resources_.size(), false);
+  std::vector<bool> consumed(resources_.size(), false);
+  for(auto&& sink : sinks_) {
+    escaping[index(sink)] = true;
+  }
+
+  // History is read by the next frame, imported images by whoever
+  // imported them.
+  for(std::size_t i = 0; i < resources_.size(); ++i) {
+    if(resources_[i].history() || resources_[i].is_imported()) {
+      escaping[i] = true;
+    }
+  }
+
+  for(auto&& node : nodes_) {
+    for(auto&& input : node.inputs()) {
+      consumed[index(input)] = true;
+      FrameGraphNode const& producer =
+          nodes_[index(resources_[index(input)].producer())];
+      if(node.physical_pass() == nullptr ||
+         node.physical_pass() != producer.physical_pass()) {
+        escaping[index(input)] = true;
+      }
+    }
+  }
+
+  // Without sinks the unconsumed resources are the results of the graph.
+  // With them, anything nobody reads was written for the pass's own
+  // benefit, like a depth buffer.
+  std::vector<bool> internal(resources_.size(), false);
+  for(std::size_t i = 0; i < resources_.size(); ++i) {
+    internal[i] = !escaping[i] && (consumed[i] || !sinks_.empty());
+  }
+
+  return internal;
+}
+
+void FrameGraph::build_batches() {
+  batches_.clear();
+  for(std::size_t i = 0; i < nodes_.size(); ++i) {
+    QueueType queue = nodes_[i].queue();
+    if(batches_.empty() || batches_.back().queue != queue) {
+      QueueBatch batch;
+      batch.queue = queue;
+      batch.begin = i;
+      batches_.push_back(std::move(batch));
+    }
+
+    batches_.back().end = i + 1;
+  }
+
+  // Everything on the graphics queue is ordered by barriers alone.
+  uses_compute_queue_ = std::ranges::any_of(
+      batches_,
+      [](QueueBatch const& batch) { return batch.queue == QueueType::Compute; });
+  if(uses_compute_queue_) {
+    LOG(Info) << "Frame graph split into " << batches_.size()
+              << " batches across the graphics and compute queues.";
+  }
+}
+
+void FrameGraph::compute_resource_lifetimes() {
+  std::vector<bool> consumed(resources_.size(), false);
+  for(int i = 0; i < static_cast<int>(nodes_.size()); ++i) {
+    FrameGraphNode const& node = nodes_[i];
+    // Everything attached to a physical pass is in use for all of it.
+    int first = i;
+    int last = i;
+    if(FrameGraphPhysicalPass const* pass = node.physical_pass()) {
+      first = static_cast<int>(pass->first_node());
+      last = first + static_cast<int>(pass->nodes().size()) - 1;
+    }
+
+    for(auto&& output : node.outputs()) {
+      // Outputs are always produced before they are consumed
+      // so the producer marks the start of the lifetime.
+      FrameGraphResource& resource = resources_[index(output)];
+      resource.set_lifetime(first, std::max(last, resource.last_use()));
+    }
+
+    for(auto&& input : node.inputs()) {
+      FrameGraphResource& resource = resources_[index(input)];
+      resource.set_lifetime(
+          resource.first_use(),
+          std::max(last, resource.last_use()));
+      consumed[index(input)] = true;
+    }
+  }
+
+  // Sinks and anything not consumed inside the graph are results of the
+  // graph and need to survive until the end of the frame.
+  int const last_node = static_cast<int>(nodes_.size()) - 1;
+  for(auto&& sink : sinks_) {
+    consumed[index(sink)] = false;
+  }
+
+  for(std::size_t i = 0; i < resources_.size(); ++i) {
+    if(!consumed[i] || resources_[i].is_imported()) {
+      resources_[i].set_lifetime(resources_[i].first_use(), last_node);
+    }
+  }
+}
+
+void FrameGraph::allocate_graphics_resources(
+    Device& device,
+    FrameGraphDescription const& description) {
+  struct ResourceAllocator {
+    ResourceAllocator(Device& device, FrameGraph& target)
+        : device_(device)
+        , target_(target) {
+    }
+
+    void operator()(FrameGraphAttachmentOutputDescription const& description) {
+      // Attachments are deferred until all are known so they
+      // can share memory.
+      if(target_.find_resource(description.name()) != nullptr) {
+        attachments_.push_back(&description);
+      }
+    }
+
+    void operator()(FrameGraphBufferDescription const& description) {
+      FrameGraphResource* resource = target_.find_resource(description.name());
+      if(resource == nullptr) {
+        // Culled
+        return;
+      }
+
+      target_.buffers_.push_back(
+          std::make_unique<FrameGraphBuffer>(description));
+      resource->set_render_resource(target_.buffers_.back().get());
+    }
+
+    FrameGraph& target_;
     Device& device_;
+    std::vector<FrameGraphAttachmentOutputDescription const*> attachments_;
   };
 
   ResourceAllocator resource_allocator(device, *this);
@@ -492,19 +2764,740 @@ void FrameGraph::allocate_graphics_resources(
     for(auto&& output : pass.outputs()) {
       std::visit(resource_allocator, output);
     }
+  }
+
+  allocate_attachments(device, resource_allocator.attachments_);
+
+  auto internal_resources = find_pass_internal_resources();
+  for(auto&& pass : physical_passes_) {
+    if(dynamic_rendering_) {
+      pass->create_rendering_info(resources_, internal_resources);
+    }
+    else {
+      pass->create_vk_render_pass(device, resources_, internal_resources);
+    }
+  }
+}
+
+namespace {
+vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Greedy first-fit packing of resources into memory blocks. Resources
+// are placed largest first; a resource may share a byte range with
+// another only if their lifetimes are disjoint.
+class TransientMemoryPlanner {
+ public:
+  struct Request {
+    vk::MemoryRequirements requirements;
+    int first_use = 0;
+    int last_use = 0;
+  };
+
+  struct Placement {
+    std::size_t block = 0;
+    vk::DeviceSize offset = 0;
+  };
+
+  struct Block {
+    vk::DeviceSize size = 0;
+    vk::DeviceSize alignment = 0;
+    std::uint32_t memory_type_bits = 0;
+    std::vector<std::size_t> occupants;
+  };
+
+  explicit TransientMemoryPlanner(std::vector<Request> requests)
+      : requests_(std::move(requests))
+      , placements_(requests_.size()) {
+    std::vector<std::size_t> order(requests_.size());
+    for(std::size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+
+    std::ranges::stable_sort(order, [this](std::size_t a, std::size_t b) {
+      return requests_[a].requirements.size > requests_[b].requirements.size;
+    });
+
+    for(std::size_t idx : order) {
+      place(idx);
+    }
+  }
+
+  std::span<Block const> blocks() const {
+    return blocks_;
+  }
+
+  Placement const& placement(std::size_t request_idx) const {
+    return placements_[request_idx];
+  }
+
+ private:
+  bool overlaps(std::size_t a, std::size_t b, vk::DeviceSize a_offset) const {
+    Request const& ra = requests_[a];
+    Request const& rb = requests_[b];
+    bool time_overlap = ra.first_use <= rb.last_use &&
+                        rb.first_use <= ra.last_use;
+    if(!time_overlap) {
+      return false;
+    }
+
+    vk::DeviceSize b_offset = placements_[b].offset;
+    return a_offset < b_offset + rb.requirements.size &&
+           b_offset < a_offset + ra.requirements.size;
+  }
+
+  bool try_place(std::size_t idx, std::size_t block_idx) {
+    Block& block = blocks_[block_idx];
+    vk::MemoryRequirements const& reqs = requests_[idx].requirements;
+    if((block.memory_type_bits & reqs.memoryTypeBits) == 0) {
+      return false;
+    }
+
+    std::vector<vk::DeviceSize> candidates = {0};
+    for(std::size_t occupant : block.occupants) {
+      candidates.push_back(align_up(
+          placements_[occupant].offset +
+              requests_[occupant].requirements.size,
+          reqs.alignment));
+    }
+
+    std::ranges::sort(candidates);
+    for(vk::DeviceSize offset : candidates) {
+      if(offset + reqs.size > block.size) {
+        break;
+      }
+
+      bool fits = std::ranges::none_of(
+          block.occupants,
+          [this, idx, offset](std::size_t occupant) {
+            return overlaps(idx, occupant, offset);
+          });
+
+      if(fits) {
+        placements_[idx] = {block_idx, offset};
+        block.occupants.push_back(idx);
+        block.memory_type_bits &= reqs.memoryTypeBits;
+        block.alignment = std::max(block.alignment, reqs.alignment);
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void place(std::size_t idx) {
+    for(std::size_t i = 0; i < blocks_.size(); ++i) {
+      if(try_place(idx, i)) {
+        return;
+      }
+    }
+
+    vk::MemoryRequirements const& reqs = requests_[idx].requirements;
+    Block block;
+    block.size = reqs.size;
+    block.alignment = reqs.alignment;
+    block.memory_type_bits = reqs.memoryTypeBits;
+    block.occupants.push_back(idx);
+    blocks_.push_back(std::move(block));
+    placements_[idx] = {blocks_.size() - 1, 0};
+  }
+
+  std::vector<Request> requests_;
+  std::vector<Placement> placements_;
+  std::vector<Block> blocks_;
+};
+
+} // namespace
+
+void FrameGraph::allocate_attachments(
+    Device& device,
+    std::vector<FrameGraphAttachmentOutputDescription const*> const& descriptions) {
+  // Images are created with exactly the usages the graph puts them to.
+  // Anything touched on the compute queue gets its own memory; aliasing it
+  // would need cross-queue synchronisation between unrelated resources.
+  // Likewise anything that loads its previous contents, which aliasing
+  // would clobber.
+  std::vector<vk::ImageUsageFlags> usages(resources_.size());
+  std::vector<bool> dedicated(resources_.size(), false);
+  for(auto&& node : nodes_) {
+    auto add_usage = [&](FrameGraphResourceHandle resource,
+                         FrameGraphResourceUsage usage) {
+      usages[index(resource)] |= image_usage(usage);
+      if(node.queue() == QueueType::Compute) {
+        dedicated[index(resource)] = true;
+      }
+    };
+
+    for(std::size_t i = 0; i < node.inputs().size(); ++i) {
+      add_usage(node.inputs()[i], node.input_usages()[i]);
+    }
+
+    for(std::size_t i = 0; i < node.outputs().size(); ++i) {
+      add_usage(node.outputs()[i], node.output_usage(i));
+    }
+  }
+
+  // Both images of a history resource are used both ways, and live across
+  // frames so they can't alias anything.
+  for(std::size_t i = 0; i < resources_.size(); ++i) {
+    if(std::optional<FrameGraphResourceHandle> history =
+           resources_[i].history()) {
+      usages[i] |= usages[index(*history)];
+      dedicated[i] = true;
+    }
+  }
+
+  std::vector<bool> const internal = find_pass_internal_resources();
+  std::vector<FrameGraphAttachmentOutputDescription const*> placed;
+  std::vector<TransientMemoryPlanner::Request> requests;
+  std::vector<vk::ImageUsageFlags> placed_usages;
+  std::vector<vk::Extent2D> placed_extents;
+  for(auto&& description : descriptions) {
+    FrameGraphResource* resource = find_resource(description->name());
+    RNDRX_ASSERT(resource);
+
+    std::size_t const resource_idx = resource - resources_.data();
+    vk::ImageUsageFlags usage = usages[resource_idx];
+    vk::Extent2D const extent = resolve_extent(*description, output_extent_);
+    bool const loads = description->load_op() == AttachmentLoadOp::Load;
+
+    // Only the image's parameters are known, it's handed to the graph every
+    // frame.
+    if(resource->is_imported()) {
+      if(loads) {
+        RNDRX_THROW_RUNTIME_ERROR()
+            << "Imported attachment " << quote(description->name())
+            << " has no previous contents to load.";
+      }
+
+      auto const handle = FrameGraphResourceHandle(resource_idx);
+      auto imported = std::ranges::find(
+          imports_,
+          handle,
+          &ImportedAttachment::resource);
+      if(imported == imports_.end()) {
+        imports_.emplace_back().resource = handle;
+        imported = imports_.end() - 1;
+      }
+
+      imported->attachment = std::make_unique<FrameGraphAttachment>(
+          *description,
+          extent,
+          usage);
+      imported->bound = false;
+      resource->set_render_resource(imported->attachment.get());
+      continue;
+    }
+
+    // Attachments that never leave their pass don't need memory at all on
+    // GPUs that keep them on chip.
+    if(device.has_lazily_allocated_memory() && internal[resource_idx] &&
+       !loads && is_transient_usage(usage)) {
+      usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+      attachments_.push_back(acquire_attachment(
+          device,
+          *description,
+          extent,
+          usage));
+      resource->set_render_resource(attachments_.back().get());
+      continue;
+    }
+
+    if(resource->history()) {
+      std::array<FrameGraphAttachment*, 2> images;
+      for(auto&& image : images) {
+        attachments_.push_back(acquire_attachment(
+            device,
+            *description,
+            extent,
+            usage));
+        image = attachments_.back().get();
+      }
+
+      resource->set_history_attachments(images[0], images[1]);
+      resources_[index(*resource->history())].set_history_attachments(
+          images[1],
+          images[0]);
+      continue;
+    }
+
+    if(dedicated[resource_idx] || loads) {
+      attachments_.push_back(acquire_attachment(
+          device,
+          *description,
+          extent,
+          usage));
+      resource->set_render_resource(attachments_.back().get());
+      continue;
+    }
+
+    vk::ImageCreateInfo create_info = FrameGraphAttachment::image_create_info(
+        *description,
+        extent,
+        usage);
+    vk::MemoryRequirements2 requirements = device.vk().getImageMemoryRequirements(
+        vk::DeviceImageMemoryRequirements().setPCreateInfo(&create_info));
+
+    placed.push_back(description);
+    placed_usages.push_back(usage);
+    placed_extents.push_back(extent);
+    requests.push_back(
+        {requirements.memoryRequirements,
+         resource->first_use(),
+         resource->last_use()});
+  }
+
+  if(!requests.empty()) {
+    // Aliased attachments are always packed together, so the previous
+    // blocks, if any, have been released along with their images.
+    RNDRX_ASSERT(transient_memory_.empty());
+    TransientMemoryPlanner planner(requests);
+
+    transient_memory_.reserve(planner.blocks().size());
+    for(auto&& block : planner.blocks()) {
+      vk::MemoryRequirements const requirements(
+          block.size,
+          block.alignment,
+          block.memory_type_bits);
+      if(resource_pool_ != nullptr) {
+        transient_memory_.push_back(
+            resource_pool_->acquire_memory(requirements));
+      }
+      else {
+        transient_memory_.emplace_back(
+            new vma::Allocation(
+                device.allocator().allocate_memory(requirements)),
+            FrameGraphResourcePool::Recycler());
+      }
+    }
+
+    for(std::size_t i = 0; i < placed.size(); ++i) {
+      auto const& placement = planner.placement(i);
+      FrameGraphResource* resource = find_resource(placed[i]->name());
+      // Placed images are only valid in this graph's blocks, so they
+      // aren't pooled.
+      attachments_.emplace_back(
+          new FrameGraphAttachment(
+              device,
+              *placed[i],
+              placed_extents[i],
+              placed_usages[i],
+              *transient_memory_[placement.block],
+              placement.offset),
+          FrameGraphResourcePool::Recycler());
+      attachments_.back()->set_memory_block(placement.block);
+      resource->set_render_resource(attachments_.back().get());
+    }
+  }
+
+  update_transient_memory_stats();
+}
+
+FrameGraphResourcePool::Attachment FrameGraph::acquire_attachment(
+    Device& device,
+    FrameGraphAttachmentOutputDescription const& description,
+    vk::Extent2D extent,
+    vk::ImageUsageFlags usage) {
+  if(resource_pool_ != nullptr) {
+    return resource_pool_->acquire_attachment(description, extent, usage);
+  }
+
+  return FrameGraphResourcePool::Attachment(
+      new FrameGraphAttachment(device, description, extent, usage),
+      FrameGraphResourcePool::Recycler());
+}
+
+void FrameGraph::update_transient_memory_stats() {
+  transient_memory_stats_ = {};
+  for(auto&& attachment : attachments_) {
+    vk::DeviceSize const size =
+        attachment->image().vk().getMemoryRequirements().size;
+    transient_memory_stats_.naive_bytes += size;
+    if(attachment->memory_block() == FrameGraphAttachment::kDedicatedMemory) {
+      transient_memory_stats_.allocated_bytes += size;
+    }
+  }
+
+  for(auto&& block : transient_memory_) {
+    transient_memory_stats_.allocated_bytes += block->size();
+  }
+
+  transient_memory_stats_.num_attachments = attachments_.size();
+  transient_memory_stats_.num_blocks = transient_memory_.size();
+
+  auto to_mb = [](vk::DeviceSize bytes) {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+  };
+
+  LOG(Info) << "Frame graph placed " << transient_memory_stats_.num_attachments
+            << " attachments in " << transient_memory_stats_.num_blocks
+            << " memory blocks: " << to_mb(transient_memory_stats_.allocated_bytes)
+            << "MB allocated vs " << to_mb(transient_memory_stats_.naive_bytes)
+            << "MB unaliased ("
+            << to_mb(
+                   transient_memory_stats_.naive_bytes -
+                   transient_memory_stats_.allocated_bytes)
+            << "MB saved).";
+}
+
+void FrameGraph::build_barriers(Device& device) {
+  struct Access {
+    FrameGraphResourceHandle resource;
+    FrameGraphResourceUsage usage;
+  };
+
+  auto node_accesses = [](FrameGraphNode const& node) {
+    std::vector<Access> accesses;
+    for(std::size_t i = 0; i < node.inputs().size(); ++i) {
+      accesses.push_back({node.inputs()[i], node.input_usages()[i]});
+    }
+
+    for(std::size_t i = 0; i < node.outputs().size(); ++i) {
+      accesses.push_back({node.outputs()[i], node.output_usage(i)});
+    }
+
+    return accesses;
+  };
+
+  for(auto&& node : nodes_) {
+    node.clear_release_barriers();
+  }
+
+  // Where a resource is, which queue owns it and the sorted index of the
+  // last node to touch it.
+  static constexpr std::size_t kEndOfFrame = ~std::size_t(0);
+  struct Tracked {
+    FrameGraphResourceState state;
+    QueueType owner = QueueType::Graphics;
+    std::size_t last_node = 0;
+    bool used = false;
+  };
+
+  // Run through the frame once to find the state every resource is left in
+  // at the end of the frame; that's where the next frame starts from.
+  std::vector<Tracked> end_states(resources_.size());
+  for(std::size_t i = 0; i < nodes_.size(); ++i) {
+    FrameGraphNode const& node = nodes_[i];
+    for(auto&& access : node_accesses(node)) {
+      FrameGraphAttachment const* attachment =
+          resources_[index(access.resource)].get_attachment();
+      if(attachment == nullptr) {
+        continue;
+      }
+
+      Tracked& tracked = end_states[index(access.resource)];
+      tracked.used = true;
+      transition(
+          tracked.state,
+          required_state(access.usage, attachment, node.shader_stages()));
+      tracked.owner = node.queue();
+      tracked.last_node = i;
+    }
+  }
+
+  // Sinks are used outside of the graph on the graphics queue, so those
+  // left on the compute queue are handed back at the end of the frame.
+  std::uint32_t const graphics_family = device.graphics_queue_family_idx();
+  std::uint32_t const compute_family = device.compute_queue_family_idx();
+  tail_acquires_.clear();
+  tail_releases_.clear();
+  std::vector<std::size_t> sink_release_nodes;
+  for(auto&& sink : sinks_) {
+    Tracked& tracked = end_states[index(sink)];
+    if(!tracked.used || tracked.owner != QueueType::Compute) {
+      continue;
+    }
+
+    FrameGraphResourceState const& state = tracked.state;
+    FrameGraphBarrier release;
+    release.resource = sink;
+    release.src = state;
+    release.src.access &= kWriteAccess;
+    release.dst.layout = state.layout;
+    release.src_queue_family = compute_family;
+    release.dst_queue_family = graphics_family;
+    nodes_[tracked.last_node].add_release_barrier(release);
+    sink_release_nodes.push_back(tracked.last_node);
+
+    // Acquires chain to the semaphore wait through their source stages.
+    FrameGraphBarrier acquire = release;
+    acquire.src = {state.layout, vk::PipelineStageFlagBits2::eAllCommands};
+    acquire.dst = {
+        state.layout,
+        vk::PipelineStageFlagBits2::eAllCommands,
+        vk::AccessFlagBits2::eMemoryRead};
+    tail_acquires_.push_back(acquire);
+    tracked.owner = QueueType::Graphics;
+    tracked.state = acquire.dst;
+    tracked.last_node = kEndOfFrame;
+  }
+
+  // When the contents of an aliased image are discarded the previous user of
+  // the memory may still be executing, so the first barrier of a resource
+  // waits for everything that shares its memory.
+  std::unordered_map<std::size_t, FrameGraphResourceState> block_end_states;
+  for(std::size_t i = 0; i < resources_.size(); ++i) {
+    if(!end_states[i].used) {
+      continue;
+    }
+
+    std::size_t block = resources_[i].get_attachment()->memory_block();
+    if(block == FrameGraphAttachment::kDedicatedMemory) {
+      continue;
+    }
+
+    FrameGraphResourceState& block_state = block_end_states[block];
+    block_state.stages |= end_states[i].state.stages;
+    block_state.access |= end_states[i].state.access;
+  }
+
+  std::vector<std::size_t> node_batches(nodes_.size());
+  for(std::size_t b = 0; b < batches_.size(); ++b) {
+    for(std::size_t i = batches_[b].begin; i < batches_[b].end; ++i) {
+      node_batches[i] = b;
+    }
+  }
+
+  auto add_batch_wait = [this](
+                            std::size_t batch_idx,
+                            std::size_t wait_batch_idx,
+                            vk::PipelineStageFlags2 stages) {
+    auto& waits = batches_[batch_idx].waits;
+    auto wait = std::ranges::find(
+        waits,
+        wait_batch_idx,
+        &QueueBatch::Wait::batch);
+    if(wait == waits.end()) {
+      waits.push_back({wait_batch_idx, stages});
+    }
+    else {
+      wait->stages |= stages;
+    }
+  };
+
+  // The sink acquires go in the caller's final submission, which has to
+  // wait for the releases even when no graphics node reads the sinks. A
+  // frame ending on the compute queue already waits for its last batch.
+  if(!batches_.empty() && batches_.back().queue == QueueType::Graphics) {
+    for(std::size_t node : sink_release_nodes) {
+      add_batch_wait(
+          batches_.size() - 1,
+          node_batches[node],
+          vk::PipelineStageFlagBits2::eAllCommands);
+    }
+  }
+
+  std::vector<Tracked> states = end_states;
+
+  // The images of a history resource swap roles every frame, so each one
+  // starts where the other ended. Last frame's image is left alone when
+  // nothing reads it.
+  for(std::size_t i = 0; i < resources_.size(); ++i) {
+    std::optional<FrameGraphResourceHandle> history = resources_[i].history();
+    if(!history || resources_[i].is_previous_frame()) {
+      continue;
+    }
+
+    Tracked const& previous_end = end_states[index(*history)];
+    states[index(*history)] = end_states[i];
+    states[i] = previous_end.used ? previous_end : end_states[i];
+  }
+  std::vector<bool> touched(resources_.size(), false);
+  auto touch = [&touched](FrameGraphResourceHandle resource) {
+    bool const first_touch = !touched[index(resource)];
+    touched[index(resource)] = true;
+    return first_touch;
+  };
+
+  // Attachments of the physical pass being walked and where its
+  // barriers go; nothing can be recorded between subpasses.
+  std::vector<FrameGraphResourceHandle> pass_resources;
+  std::vector<std::vector<FrameGraphBarrier>> node_barriers(
+      nodes_.size());
+  for(std::size_t i = 0; i < nodes_.size(); ++i) {
+    FrameGraphNode& node = nodes_[i];
+    FrameGraphPhysicalPass const* pass = node.physical_pass();
+    if(pass == nullptr || node.subpass() == 0) {
+      pass_resources.clear();
+    }
+
+    std::vector<FrameGraphBarrier>& barriers =
+        node_barriers[pass ? pass->first_node() : i];
+    for(auto&& access : node_accesses(node)) {
+      // Buffers get fresh memory each frame and are shared by both queue
+      // families, so they only need ordering against earlier uses in the
+      // same frame.
+      FrameGraphResource const& resource = resources_[index(access.resource)];
+      if(FrameGraphBuffer const* buffer = resource.get_buffer()) {
+        Tracked& tracked = states[index(access.resource)];
+        FrameGraphResourceState next = required_buffer_state(
+            access.usage,
+            *buffer,
+            node.is_compute());
+        bool const first_touch = touch(access.resource);
+        bool const changes_queue = tracked.owner != node.queue();
+        std::size_t const previous_node = tracked.last_node;
+        tracked.owner = node.queue();
+        tracked.last_node = i;
+        if(first_touch) {
+          tracked.state = next;
+        }
+        else if(changes_queue) {
+          add_batch_wait(
+              node_batches[i],
+              node_batches[previous_node],
+              next.stages);
+          tracked.state = next;
+        }
+        else {
+          FrameGraphResourceState src = tracked.state;
+          if(transition(tracked.state, next)) {
+            src.access &= kWriteAccess;
+            barriers.push_back({access.resource, src, next, false});
+          }
+        }
+        continue;
+      }
+
+      FrameGraphAttachment const* attachment = resource.get_attachment();
+      if(attachment == nullptr) {
+        continue;
+      }
+
+      Tracked& tracked = states[index(access.resource)];
+      FrameGraphResourceState& current = tracked.state;
+      FrameGraphResourceState next = required_state(
+          access.usage,
+          attachment,
+          node.shader_stages());
+
+      // Already attached to this render pass; the subpass dependencies
+      // and attachment layouts take care of it.
+      bool const in_pass =
+          pass != nullptr &&
+          std::ranges::find(pass_resources, access.resource) !=
+              pass_resources.end();
+      if(pass != nullptr && !in_pass) {
+        pass_resources.push_back(access.resource);
+      }
+
+      if(in_pass) {
+        touch(access.resource);
+        tracked.last_node = i;
+        current.layout = next.layout;
+        current.stages |= next.stages;
+        current.access |= next.access;
+        continue;
+      }
+      bool const first_touch = touch(access.resource);
+      bool const changes_family =
+          device.queue_family_idx(tracked.owner) !=
+          device.queue_family_idx(node.queue());
+      std::size_t const previous_node = tracked.last_node;
+      tracked.owner = node.queue();
+      tracked.last_node = i;
+
+      if(first_touch && discards_contents(access.usage, attachment)) {
+        // Ownership doesn't need transferring for discarded contents, and
+        // when the previous frame finished on the other queue the frame
+        // boundary wait already covers it.
+        FrameGraphResourceState src = changes_family ? FrameGraphResourceState()
+                                                     : current;
+        auto block_state = block_end_states.find(attachment->memory_block());
+        if(block_state != block_end_states.end()) {
+          src.stages |= block_state->second.stages;
+          src.access |= block_state->second.access;
+        }
+
+        // The acquire semaphore of an imported image is waited on at the
+        // stages of its first use, the transition has to come after it.
+        if(resource.is_imported()) {
+          src.stages |= next.stages;
+          auto imported = std::ranges::find(
+              imports_,
+              access.resource,
+              &ImportedAttachment::resource);
+          imported->first_batch = node_batches[i];
+          imported->first_stages = next.stages;
+        }
+
+        src.access &= kWriteAccess;
+        FrameGraphBarrier barrier{access.resource, src, next, true};
+        barrier.across_frames = true;
+        barriers.push_back(barrier);
+        current = next;
+        continue;
+      }
+
+      if(changes_family) {
+        // Release after the last use on the old queue, acquire here. Sinks
+        // handed back to the graphics queue are released at the very end.
+        FrameGraphBarrier release;
+        release.resource = access.resource;
+        release.src = current;
+        release.src.access &= kWriteAccess;
+        release.dst.layout = next.layout;
+        release.dst_queue_family = device.queue_family_idx(node.queue());
+        if(previous_node == kEndOfFrame) {
+          release.src_queue_family = graphics_family;
+          tail_releases_.push_back(release);
+        }
+        else {
+          release.src_queue_family = device.queue_family_idx(
+              nodes_[previous_node].queue());
+          nodes_[previous_node].add_release_barrier(release);
+        }
+
+        FrameGraphBarrier acquire = release;
+        acquire.src = {current.layout, next.stages};
+        acquire.dst = next;
+        acquire.across_frames = first_touch;
+        barriers.push_back(acquire);
+
+        // Across frames the frame boundary wait orders the two.
+        if(!first_touch) {
+          add_batch_wait(
+              node_batches[i],
+              node_batches[previous_node],
+              next.stages);
+        }
+
+        current = next;
+        continue;
+      }
+
+      FrameGraphResourceState src = current;
+      if(transition(current, next)) {
+        src.access &= kWriteAccess;
+        FrameGraphBarrier barrier{access.resource, src, next, false};
+        barrier.across_frames = first_touch;
+        barriers.push_back(barrier);
+      }
+    }
+
+  }
+
+  for(std::size_t i = 0; i < nodes_.size(); ++i) {
+    nodes_[i].set_barriers(std::move(node_barriers[i]));
+  }
 
-    FrameGraphNode* node = find_node(pass.name());
-    RNDRX_ASSERT(node && "Not possible for a node to not exist at this point.");
-    node->create_vk_render_pass(device);
+  // Imported images end the frame in the layout their owner wants, which
+  // is only known once they are imported.
+  import_releases_.clear();
+  for(auto&& imported : imports_) {
+    FrameGraphBarrier release;
+    release.resource = imported.resource;
+    release.src = end_states[index(imported.resource)].state;
+    release.src.access &= kWriteAccess;
+    import_releases_.push_back(release);
   }
 }
 
 FrameGraphResource* FrameGraph::find_resource(std::string_view name) {
-  auto resource = resources_.find(name);
-  if(resource != resources_.end()) {
-    // const_cast required because a value is const in a set.
-    // It's safe as long as we don't change the name.
-    return const_cast<FrameGraphResource*>(&*resource);
+  auto resource = resource_names_.find(name);
+  if(resource != resource_names_.end()) {
+    return &resources_[index(resource->second)];
   }
 
   return nullptr;
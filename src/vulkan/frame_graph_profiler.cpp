@@ -0,0 +1,304 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "rndrx/vulkan/frame_graph_profiler.hpp"
+
+#include <algorithm>
+#include "imgui.h"
+#include "rndrx/vulkan/frame_graph.hpp"
+
+namespace rndrx::vulkan {
+
+namespace {
+// Reported in this order, the order of the flag bits.
+constexpr vk::QueryPipelineStatisticFlags kStatisticFlags =
+    vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices |
+    vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives |
+    vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+    vk::QueryPipelineStatisticFlagBits::eClippingPrimitives |
+    vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations |
+    vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations;
+constexpr std::size_t kNumStatistics = 6;
+constexpr double kAverageWeight = 0.05;
+
+std::uint64_t valid_bits_mask(std::uint32_t valid_bits) {
+  if(valid_bits >= 64) {
+    return ~std::uint64_t(0);
+  }
+
+  return (std::uint64_t(1) << valid_bits) - 1;
+}
+} // namespace
+
+FrameGraphProfiler::FrameGraphProfiler(
+    Device& device,
+    std::span<FrameGraphNode const> nodes,
+    Options const& options)
+    : frames_(std::max<std::size_t>(options.frames_in_flight, 1))
+    , pipeline_statistics_(
+          options.pipeline_statistics &&
+          device.has_pipeline_statistics_query()) {
+  timestamp_period_ =
+      device.physical_device().getProperties().limits.timestampPeriod;
+  auto queue_families = device.physical_device().getQueueFamilyProperties();
+  for(QueueType queue : {QueueType::Graphics, QueueType::Compute}) {
+    timestamp_mask_[static_cast<std::size_t>(queue)] = valid_bits_mask(
+        queue_families[device.queue_family_idx(queue)].timestampValidBits);
+  }
+
+  timings_.reserve(nodes.size());
+  for(auto&& node : nodes) {
+    FrameGraphNodeTiming& timing = timings_.emplace_back();
+    timing.name = node.name();
+    timing.queue = node.queue();
+  }
+
+  // Pools can't be empty.
+  auto const num_nodes = static_cast<std::uint32_t>(
+      std::max<std::size_t>(nodes.size(), 1));
+  for(auto&& frame : frames_) {
+    frame.timestamps = device.vk().createQueryPool( //
+        vk::QueryPoolCreateInfo()
+            .setQueryType(vk::QueryType::eTimestamp)
+            .setQueryCount(num_nodes * 2));
+    if(pipeline_statistics_) {
+      frame.statistics = device.vk().createQueryPool( //
+          vk::QueryPoolCreateInfo()
+              .setQueryType(vk::QueryType::ePipelineStatistics)
+              .setQueryCount(num_nodes)
+              .setPipelineStatistics(kStatisticFlags));
+    }
+  }
+}
+
+void FrameGraphProfiler::begin_frame() {
+  FramePools const& pools = frames_[current_frame_];
+  if(!pools.written || timings_.empty()) {
+    return;
+  }
+
+  read_timestamps(pools);
+  if(pipeline_statistics_) {
+    read_statistics(pools);
+  }
+}
+
+void FrameGraphProfiler::end_frame() {
+  frames_[current_frame_].written = true;
+  current_frame_ = (current_frame_ + 1) % frames_.size();
+}
+
+void FrameGraphProfiler::read_timestamps(FramePools const& pools) {
+  // Each query is followed by its availability, so whatever has completed
+  // can be used without waiting for the rest.
+  auto const num_queries = static_cast<std::uint32_t>(timings_.size() * 2);
+  std::vector<std::uint64_t> const data =
+      pools.timestamps
+          .getResults<std::uint64_t>(
+              0,
+              num_queries,
+              num_queries * 2 * sizeof(std::uint64_t),
+              2 * sizeof(std::uint64_t),
+              vk::QueryResultFlagBits::e64 |
+                  vk::QueryResultFlagBits::eWithAvailability)
+          .second;
+
+  for(std::size_t i = 0; i < timings_.size(); ++i) {
+    FrameGraphNodeTiming& timing = timings_[i];
+    std::uint64_t const* begin = &data[i * 4];
+    std::uint64_t const* end = begin + 2;
+    if(begin[1] == 0 || end[1] == 0) {
+      continue;
+    }
+
+    // Masking handles the counter wrapping between the two writes.
+    std::uint64_t const mask =
+        timestamp_mask_[static_cast<std::size_t>(timing.queue)];
+    std::uint64_t const ticks = (end[0] - begin[0]) & mask;
+    timing.gpu_ms = ticks * timestamp_period_ / 1e6;
+    timing.average_gpu_ms =
+        timing.has_timestamps
+            ? timing.average_gpu_ms +
+                  (timing.gpu_ms - timing.average_gpu_ms) * kAverageWeight
+            : timing.gpu_ms;
+    timing.has_timestamps = true;
+  }
+}
+
+void FrameGraphProfiler::read_statistics(FramePools const& pools) {
+  constexpr std::size_t kStride = kNumStatistics + 1;
+  auto const num_queries = static_cast<std::uint32_t>(timings_.size());
+  std::vector<std::uint64_t> const data =
+      pools.statistics
+          .getResults<std::uint64_t>(
+              0,
+              num_queries,
+              num_queries * kStride * sizeof(std::uint64_t),
+              kStride * sizeof(std::uint64_t),
+              vk::QueryResultFlagBits::e64 |
+                  vk::QueryResultFlagBits::eWithAvailability)
+          .second;
+
+  for(std::size_t i = 0; i < timings_.size(); ++i) {
+    std::uint64_t const* values = &data[i * kStride];
+    if(values[kNumStatistics] == 0) {
+      continue;
+    }
+
+    FrameGraphNodeTiming& timing = timings_[i];
+    timing.statistics.input_assembly_vertices = values[0];
+    timing.statistics.input_assembly_primitives = values[1];
+    timing.statistics.vertex_shader_invocations = values[2];
+    timing.statistics.clipping_primitives = values[3];
+    timing.statistics.fragment_shader_invocations = values[4];
+    timing.statistics.compute_shader_invocations = values[5];
+    timing.has_statistics = true;
+  }
+}
+
+void FrameGraphProfiler::reset_queries(
+    vk::CommandBuffer cmd,
+    QueueType queue,
+    std::size_t first_node,
+    std::size_t num_nodes) const {
+  FramePools const& pools = frames_[current_frame_];
+  if(writes_timestamps(queue)) {
+    cmd.resetQueryPool(
+        *pools.timestamps,
+        static_cast<std::uint32_t>(first_node * 2),
+        static_cast<std::uint32_t>(num_nodes * 2));
+  }
+
+  if(pipeline_statistics_ && queue == QueueType::Graphics) {
+    cmd.resetQueryPool(
+        *pools.statistics,
+        static_cast<std::uint32_t>(first_node),
+        static_cast<std::uint32_t>(num_nodes));
+  }
+}
+
+void FrameGraphProfiler::begin_node(
+    vk::CommandBuffer cmd,
+    std::size_t node_idx) const {
+  FramePools const& pools = frames_[current_frame_];
+  QueueType const queue = timings_[node_idx].queue;
+  if(writes_timestamps(queue)) {
+    cmd.writeTimestamp2(
+        vk::PipelineStageFlagBits2::eTopOfPipe,
+        *pools.timestamps,
+        static_cast<std::uint32_t>(node_idx * 2));
+  }
+
+  // Statistics pools hold graphics counters, which compute only queues
+  // can't record.
+  if(pipeline_statistics_ && queue == QueueType::Graphics) {
+    cmd.beginQuery(
+        *pools.statistics,
+        static_cast<std::uint32_t>(node_idx),
+        vk::QueryControlFlags());
+  }
+}
+
+void FrameGraphProfiler::end_node(
+    vk::CommandBuffer cmd,
+    std::size_t node_idx) const {
+  FramePools const& pools = frames_[current_frame_];
+  QueueType const queue = timings_[node_idx].queue;
+  if(pipeline_statistics_ && queue == QueueType::Graphics) {
+    cmd.endQuery(*pools.statistics, static_cast<std::uint32_t>(node_idx));
+  }
+
+  if(writes_timestamps(queue)) {
+    cmd.writeTimestamp2(
+        vk::PipelineStageFlagBits2::eBottomOfPipe,
+        *pools.timestamps,
+        static_cast<std::uint32_t>(node_idx * 2 + 1));
+  }
+}
+
+double FrameGraphProfiler::total_gpu_ms() const {
+  double total = 0;
+  for(auto&& timing : timings_) {
+    total += timing.gpu_ms;
+  }
+
+  return total;
+}
+
+void FrameGraphProfiler::draw_ui(char const* title) const {
+  if(!ImGui::Begin(title)) {
+    ImGui::End();
+    return;
+  }
+
+  // Nodes on different queues can overlap, so the total is only an upper
+  // bound on the frame's GPU time.
+  ImGui::Text("Sum of nodes: %.3fms", total_gpu_ms());
+  int const num_columns = pipeline_statistics_ ? 8 : 3;
+  ImGuiTableFlags const flags = ImGuiTableFlags_RowBg |
+                                ImGuiTableFlags_Borders |
+                                ImGuiTableFlags_SizingFixedFit;
+  if(ImGui::BeginTable("##timings", num_columns, flags)) {
+    ImGui::TableSetupColumn("Node");
+    ImGui::TableSetupColumn("Queue");
+    ImGui::TableSetupColumn("GPU ms");
+    if(pipeline_statistics_) {
+      ImGui::TableSetupColumn("IA verts");
+      ImGui::TableSetupColumn("IA prims");
+      ImGui::TableSetupColumn("VS invocs");
+      ImGui::TableSetupColumn("FS invocs");
+      ImGui::TableSetupColumn("CS invocs");
+    }
+    ImGui::TableHeadersRow();
+
+    for(auto&& timing : timings_) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(timing.name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(
+          timing.queue == QueueType::Compute ? "Compute" : "Graphics");
+      ImGui::TableNextColumn();
+      if(timing.has_timestamps) {
+        ImGui::Text("%.3f", timing.average_gpu_ms);
+      }
+      else {
+        ImGui::TextUnformatted("-");
+      }
+
+      if(!pipeline_statistics_) {
+        continue;
+      }
+
+      FrameGraphPipelineStatistics const& stats = timing.statistics;
+      for(std::uint64_t value :
+          {stats.input_assembly_vertices,
+           stats.input_assembly_primitives,
+           stats.vertex_shader_invocations,
+           stats.fragment_shader_invocations,
+           stats.compute_shader_invocations}) {
+        ImGui::TableNextColumn();
+        if(timing.has_statistics) {
+          ImGui::Text("%llu", static_cast<unsigned long long>(value));
+        }
+        else {
+          ImGui::TextUnformatted("-");
+        }
+      }
+    }
+    ImGui::EndTable();
+  }
+  ImGui::End();
+}
+
+} // namespace rndrx::vulkan
@@ -0,0 +1,63 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "rndrx/vulkan/frame_graph_reloader.hpp"
+
+#include <exception>
+#include <optional>
+#include <utility>
+#include "rndrx/log.hpp"
+#include "rndrx/vulkan/device.hpp"
+#include "rndrx/vulkan/frame_graph.hpp"
+#include "rndrx/vulkan/frame_graph_builder.hpp"
+
+namespace rndrx::vulkan {
+
+FrameGraphReloader::FrameGraphReloader(
+    FrameGraphBuilder const& builder,
+    FrameGraph& graph,
+    std::filesystem::path path)
+    : builder_(&builder)
+    , graph_(&graph)
+    , watcher_(path)
+    , current_(load_frame_graph_description(path)) {
+  *graph_ = FrameGraph(*builder_, current_);
+}
+
+bool FrameGraphReloader::poll() {
+  std::optional<FrameGraphDescription> description = watcher_.poll();
+  if(!description) {
+    return false;
+  }
+
+  builder_->device().vk().waitIdle();
+  try {
+    graph_->update(*builder_, *description);
+  }
+  catch(std::exception const& e) {
+    LOG(Error) << "Frame graph " << quote(watcher_.path().string())
+               << " failed to compile, keeping the previous one: "
+               << e.what();
+    // The graph may have been left half updated.
+    *graph_ = FrameGraph();
+    *graph_ = FrameGraph(*builder_, current_);
+    return true;
+  }
+
+  current_ = std::move(*description);
+  LOG(Info) << "Reloaded frame graph " << quote(watcher_.path().string())
+            << ".";
+  return true;
+}
+
+} // namespace rndrx::vulkan
@@ -0,0 +1,134 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "rndrx/vulkan/frame_graph_resource_pool.hpp"
+
+#include <algorithm>
+#include "rndrx/assert.hpp"
+#include "rndrx/frame_graph_description.hpp"
+#include "rndrx/vulkan/device.hpp"
+#include "rndrx/vulkan/formats.hpp"
+#include "rndrx/vulkan/frame_graph.hpp"
+
+namespace rndrx::vulkan {
+
+void FrameGraphResourcePool::Recycler::operator()(
+    FrameGraphAttachment* attachment) const {
+  if(pool != nullptr) {
+    pool->recycle(attachment);
+  }
+  else {
+    delete attachment;
+  }
+}
+
+void FrameGraphResourcePool::Recycler::operator()(
+    vma::Allocation* memory) const {
+  if(pool != nullptr) {
+    pool->recycle(memory);
+  }
+  else {
+    delete memory;
+  }
+}
+
+FrameGraphResourcePool::FrameGraphResourcePool(Device& device)
+    : device_(&device) {
+}
+
+FrameGraphResourcePool::~FrameGraphResourcePool() = default;
+
+FrameGraphResourcePool::Attachment FrameGraphResourcePool::acquire_attachment(
+    FrameGraphAttachmentOutputDescription const& description,
+    vk::Extent2D extent,
+    vk::ImageUsageFlags usage) {
+  RNDRX_ASSERT(device_);
+  vk::Format const format = to_vulkan_format(description.format());
+  auto found = std::ranges::find_if(
+      free_attachments_,
+      [&](std::unique_ptr<FrameGraphAttachment> const& attachment) {
+        return attachment->format() == format &&
+               attachment->width() == static_cast<int>(extent.width) &&
+               attachment->height() == static_cast<int>(extent.height) &&
+               attachment->usage() == usage;
+      });
+
+  if(found == free_attachments_.end()) {
+    ++stats_.allocated;
+    return Attachment(
+        new FrameGraphAttachment(*device_, description, extent, usage),
+        Recycler{this});
+  }
+
+  Attachment attachment(found->release(), Recycler{this});
+  free_attachments_.erase(found);
+  attachment->set_load_state(description);
+  --stats_.free_attachments;
+  ++stats_.reused;
+  return attachment;
+}
+
+FrameGraphResourcePool::Memory FrameGraphResourcePool::acquire_memory(
+    vk::MemoryRequirements const& requirements) {
+  RNDRX_ASSERT(device_);
+  // Blocks are dedicated allocations, so they start at offset zero and
+  // any alignment is met.
+  auto best = free_memory_.end();
+  for(auto i = free_memory_.begin(); i != free_memory_.end(); ++i) {
+    vma::Allocation const& block = **i;
+    bool const fits =
+        block.size() >= requirements.size &&
+        (requirements.memoryTypeBits & (1u << block.memory_type())) != 0;
+    if(fits && (best == free_memory_.end() || block.size() < (*best)->size())) {
+      best = i;
+    }
+  }
+
+  if(best == free_memory_.end()) {
+    ++stats_.allocated;
+    return Memory(
+        new vma::Allocation(device_->allocator().allocate_memory(requirements)),
+        Recycler{this});
+  }
+
+  Memory memory(best->release(), Recycler{this});
+  free_memory_.erase(best);
+  --stats_.free_blocks;
+  stats_.free_bytes -= memory->size();
+  ++stats_.reused;
+  return memory;
+}
+
+void FrameGraphResourcePool::trim() {
+  free_attachments_.clear();
+  free_memory_.clear();
+  stats_.free_attachments = 0;
+  stats_.free_blocks = 0;
+  stats_.free_bytes = 0;
+}
+
+void FrameGraphResourcePool::recycle(FrameGraphAttachment* attachment) {
+  // Placed images are only valid with the memory they were placed in.
+  RNDRX_ASSERT(
+      attachment->memory_block() == FrameGraphAttachment::kDedicatedMemory);
+  free_attachments_.emplace_back(attachment);
+  ++stats_.free_attachments;
+}
+
+void FrameGraphResourcePool::recycle(vma::Allocation* memory) {
+  free_memory_.emplace_back(memory);
+  ++stats_.free_blocks;
+  stats_.free_bytes += memory->size();
+}
+
+} // namespace rndrx::vulkan
@@ -0,0 +1,135 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "rndrx/vulkan/frame_timeline.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <vulkan/vulkan_raii.hpp>
+#include "rndrx/assert.hpp"
+#include "rndrx/throw_exception.hpp"
+#include "rndrx/vulkan/device.hpp"
+
+namespace rndrx::vulkan {
+
+namespace {
+vk::raii::Semaphore create_timeline_semaphore(Device& device) {
+  vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo>
+      create_info(
+          vk::SemaphoreCreateInfo(),
+          vk::SemaphoreTypeCreateInfo()
+              .setSemaphoreType(vk::SemaphoreType::eTimeline)
+              .setInitialValue(0));
+  return device.vk().createSemaphore(
+      create_info.get<vk::SemaphoreCreateInfo>());
+}
+} // namespace
+
+FrameTimeline::FrameTimeline(Device& device)
+    : device_(&device)
+    , graphics_semaphore_(create_timeline_semaphore(device)) {
+  if(device.has_async_compute()) {
+    compute_semaphore_ = create_timeline_semaphore(device);
+  }
+}
+
+vk::Semaphore FrameTimeline::semaphore(QueueType queue) const {
+  if(queue == QueueType::Compute && *compute_semaphore_) {
+    return *compute_semaphore_;
+  }
+
+  return *graphics_semaphore_;
+}
+
+vk::SemaphoreSubmitInfo FrameTimeline::signal_info(
+    QueueType queue,
+    std::uint64_t frame) const {
+  return vk::SemaphoreSubmitInfo()
+      .setSemaphore(semaphore(queue))
+      .setValue(frame * kStepsPerFrame)
+      .setStageMask(vk::PipelineStageFlagBits2::eAllCommands);
+}
+
+vk::SemaphoreSubmitInfo FrameTimeline::wait_info(
+    QueueType queue,
+    std::uint64_t frame,
+    vk::PipelineStageFlags2 stages) const {
+  return vk::SemaphoreSubmitInfo()
+      .setSemaphore(semaphore(queue))
+      .setValue(frame * kStepsPerFrame)
+      .setStageMask(stages);
+}
+
+vk::SemaphoreSubmitInfo FrameTimeline::step_signal_info(
+    QueueType queue,
+    std::uint64_t frame,
+    std::uint64_t step) const {
+  return vk::SemaphoreSubmitInfo()
+      .setSemaphore(semaphore(queue))
+      .setValue(step_value(frame, step))
+      .setStageMask(vk::PipelineStageFlagBits2::eAllCommands);
+}
+
+vk::SemaphoreSubmitInfo FrameTimeline::step_wait_info(
+    QueueType queue,
+    std::uint64_t frame,
+    std::uint64_t step,
+    vk::PipelineStageFlags2 stages) const {
+  return vk::SemaphoreSubmitInfo()
+      .setSemaphore(semaphore(queue))
+      .setValue(step_value(frame, step))
+      .setStageMask(stages);
+}
+
+std::uint64_t FrameTimeline::completed_frame() const {
+  std::uint64_t completed = graphics_semaphore_.getCounterValue();
+  if(*compute_semaphore_) {
+    completed = std::min(completed, compute_semaphore_.getCounterValue());
+  }
+
+  return completed / kStepsPerFrame;
+}
+
+void FrameTimeline::wait(std::uint64_t frame) const {
+  if(frame == 0) {
+    return;
+  }
+
+  std::array<vk::Semaphore, 2> semaphores = {
+      *graphics_semaphore_,
+      *compute_semaphore_};
+  std::array<std::uint64_t, 2> values = {
+      frame * kStepsPerFrame,
+      frame * kStepsPerFrame};
+  std::uint32_t const num_semaphores = *compute_semaphore_ ? 2 : 1;
+  auto result = device_->vk().waitSemaphores(
+      vk::SemaphoreWaitInfo()
+          .setSemaphoreCount(num_semaphores)
+          .setPSemaphores(semaphores.data())
+          .setPValues(values.data()),
+      std::numeric_limits<std::uint64_t>::max());
+  if(result != vk::Result::eSuccess) {
+    throw_runtime_error("Failed to wait for frame timeline.");
+  }
+}
+
+std::uint64_t FrameTimeline::step_value(
+    std::uint64_t frame,
+    std::uint64_t step) {
+  RNDRX_ASSERT(frame > 0);
+  RNDRX_ASSERT(step > 0 && step < kStepsPerFrame);
+  return (frame - 1) * kStepsPerFrame + step;
+}
+
+} // namespace rndrx::vulkan
@@ -0,0 +1,112 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "rndrx/vulkan/gpu_frame_timer.hpp"
+
+#include <vulkan/vulkan_raii.hpp>
+#include "rndrx/vulkan/device.hpp"
+#include "rndrx/vulkan/frame_timeline.hpp"
+#include "rndrx/vulkan/submission_context.hpp"
+
+namespace rndrx::vulkan {
+
+GpuFrameTimer::GpuFrameTimer(Device& device, std::uint32_t frames_in_flight)
+    : pending_frames_(frames_in_flight, 0) {
+  std::uint32_t const valid_bits =
+      device.physical_device()
+          .getQueueFamilyProperties()[device.graphics_queue_family_idx()]
+          .timestampValidBits;
+  if(valid_bits == 0) {
+    return;
+  }
+
+  timestamp_mask_ = valid_bits >= 64 ? ~std::uint64_t(0)
+                                     : (std::uint64_t(1) << valid_bits) - 1;
+  timestamp_period_ =
+      device.physical_device().getProperties().limits.timestampPeriod;
+  query_pool_ = device.vk().createQueryPool(
+      vk::QueryPoolCreateInfo()
+          .setQueryType(vk::QueryType::eTimestamp)
+          .setQueryCount(frames_in_flight * 2));
+}
+
+void GpuFrameTimer::begin_frame(SubmissionContext& sc) {
+  if(!is_supported()) {
+    return;
+  }
+
+  std::size_t const slot = sc.frame_index() % pending_frames_.size();
+  auto const first_query = static_cast<std::uint32_t>(slot * 2);
+  vk::CommandBuffer cmd = sc.command_buffer();
+  cmd.resetQueryPool(*query_pool_, first_query, 2);
+  cmd.writeTimestamp2(
+      vk::PipelineStageFlagBits2::eNone,
+      *query_pool_,
+      first_query);
+  pending_frames_[slot] = 0;
+}
+
+void GpuFrameTimer::end_frame(SubmissionContext& sc) {
+  if(!is_supported()) {
+    return;
+  }
+
+  std::size_t const slot = sc.frame_index() % pending_frames_.size();
+  sc.command_buffer().writeTimestamp2(
+      vk::PipelineStageFlagBits2::eAllCommands,
+      *query_pool_,
+      static_cast<std::uint32_t>(slot * 2 + 1));
+  pending_frames_[slot] = sc.frame_index();
+}
+
+std::optional<GpuFrameTime> GpuFrameTimer::poll(FrameTimeline const& timeline) {
+  std::uint64_t const completed = timeline.completed_frame();
+  std::size_t oldest = pending_frames_.size();
+  for(std::size_t i = 0; i < pending_frames_.size(); ++i) {
+    std::uint64_t const frame = pending_frames_[i];
+    if(frame == 0 || frame > completed) {
+      continue;
+    }
+
+    if(oldest == pending_frames_.size() || frame < pending_frames_[oldest]) {
+      oldest = i;
+    }
+  }
+
+  if(oldest == pending_frames_.size()) {
+    return std::nullopt;
+  }
+
+  // The frame has completed so the results are already available.
+  auto [result, timestamps] = query_pool_.getResults<std::uint64_t>(
+      static_cast<std::uint32_t>(oldest * 2),
+      2,
+      2 * sizeof(std::uint64_t),
+      sizeof(std::uint64_t),
+      vk::QueryResultFlagBits::e64);
+
+  GpuFrameTime time;
+  time.frame_index = pending_frames_[oldest];
+  pending_frames_[oldest] = 0;
+  if(result != vk::Result::eSuccess) {
+    return std::nullopt;
+  }
+
+  // Masking handles the counter wrapping between the two writes.
+  std::uint64_t const ticks = (timestamps[1] - timestamps[0]) &
+                              timestamp_mask_;
+  time.gpu_ms = ticks * timestamp_period_ / 1e6;
+  return time;
+}
+
+} // namespace rndrx::vulkan
@@ -16,6 +16,7 @@
 #include <array>
 #include <memory>
 #include <span>
+#include <utility>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_raii.hpp>
 #include "imgui.h"
@@ -25,31 +26,53 @@
 #include "rndrx/vulkan/application.hpp"
 #include "rndrx/vulkan/device.hpp"
 #include "rndrx/vulkan/submission_context.hpp"
-#include "rndrx/vulkan/swapchain.hpp"
 #include "rndrx/vulkan/vma/allocator.hpp"
 #include "rndrx/vulkan/vma/image.hpp"
 #include "rndrx/vulkan/window.hpp"
 
 namespace rndrx::vulkan {
 
+ImGuiFrame::ImGuiFrame(ImDrawData const& draw_data)
+    : draw_data_(std::make_unique<ImDrawData>(draw_data)) {
+  draw_lists_.reserve(draw_data.CmdListsCount);
+  for(int i = 0; i < draw_data.CmdListsCount; ++i) {
+    draw_lists_.push_back(draw_data.CmdLists[i]->CloneOutput());
+  }
+
+  draw_data_->CmdLists = draw_lists_.data();
+}
+
+ImGuiFrame::~ImGuiFrame() {
+  for(ImDrawList* draw_list : draw_lists_) {
+    IM_DELETE(draw_list);
+  }
+}
+
 ImGuiRenderPass::ImGuiRenderPass() = default;
 
-ImGuiRenderPass::ImGuiRenderPass(Device& device)
-    : draw_data_(std::make_unique<ImDrawData>()) {
+ImGuiRenderPass::ImGuiRenderPass(Device& device) {
   IMGUI_CHECKVERSION();
-  ImGui::CreateContext();
+  context_.reset(ImGui::CreateContext());
   ImGui::StyleColorsDark();
   ImGui::GetStyle().Alpha = 0.9f;
 
   create_descriptor_pool(device);
 }
 
-ImGuiRenderPass::~ImGuiRenderPass() {
-  if(draw_data_) {
+ImGuiRenderPass::~ImGuiRenderPass() = default;
+
+void ImGuiRenderPass::ContextDeleter::operator()(ImGuiContext* context) const {
+  ImGui::SetCurrentContext(context);
+  ImGuiIO& io = ImGui::GetIO();
+  if(io.BackendRendererUserData) {
     ImGui_ImplVulkan_Shutdown();
+  }
+
+  if(io.BackendPlatformUserData) {
     ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
   }
+
+  ImGui::DestroyContext(context);
 }
 
 void ImGuiRenderPass::begin_frame() {
@@ -58,19 +81,13 @@ void ImGuiRenderPass::begin_frame() {
   ImGui::NewFrame();
 }
 
-void ImGuiRenderPass::end_frame() {
+std::shared_ptr<ImGuiFrame const> ImGuiRenderPass::end_frame() {
   ImGui::Render();
-  for(int i = 0; i < draw_data_->CmdListsCount; ++i) {
-    IM_FREE(draw_data_->CmdLists[i]);
-  }
+  return std::make_shared<ImGuiFrame>(*ImGui::GetDrawData());
+}
 
-  ImDrawData* draw_data = ImGui::GetDrawData();
-  *draw_data_ = *draw_data;
-  draw_list_memory_.resize(draw_data->CmdListsCount);
-  draw_data_->CmdLists = draw_list_memory_.data();
-  for(int i = 0; i < draw_data->CmdListsCount; ++i) {
-    draw_data_->CmdLists[i] = draw_data->CmdLists[i]->CloneOutput();
-  }
+void ImGuiRenderPass::set_frame(std::shared_ptr<ImGuiFrame const> frame) {
+  frame_ = std::move(frame);
 }
 
 ImGuiRenderPass::ImGuiRenderPass(ImGuiRenderPass&&) = default;
@@ -79,8 +96,8 @@ ImGuiRenderPass& ImGuiRenderPass::operator=(ImGuiRenderPass&&) = default;
 void ImGuiRenderPass::initialise_imgui(
     Device& device,
     Application const& app,
-    Swapchain const& swapchain,
-    vk::RenderPass render_pass) {
+    std::uint32_t image_count,
+    vk::Format colour_format) {
   ImGui_ImplGlfw_InitForVulkan(app.window().glfw(), true);
 
   ImGui_ImplVulkan_InitInfo init_info = {};
@@ -91,18 +108,28 @@ void ImGuiRenderPass::initialise_imgui(
   init_info.CheckVkResultFn = &check_vk_result;
   init_info.DescriptorPool = *descriptor_pool_;
   init_info.MinImageCount = 2;
-  init_info.ImageCount = swapchain.images().size();
+  init_info.ImageCount = image_count;
+  init_info.UseDynamicRendering = true;
+  init_info.ColorAttachmentFormat = static_cast<VkFormat>(colour_format);
 
-  ImGui_ImplVulkan_Init(&init_info, render_pass);
+  ImGui_ImplVulkan_Init(&init_info, VK_NULL_HANDLE);
 }
 
-void ImGuiRenderPass::pre_render(SubmissionContext& sc) {
+void ImGuiRenderPass::pre_render(
+    SubmissionContext& sc,
+    vk::CommandBuffer cmd) {
 }
 
-void ImGuiRenderPass::render(SubmissionContext& sc) {
-  ImGui_ImplVulkan_RenderDrawData(draw_data_.get(), sc.command_buffer());
+void ImGuiRenderPass::render(
+    SubmissionContext& sc,
+    vk::CommandBuffer cmd) {
+  if(frame_) {
+    ImGui_ImplVulkan_RenderDrawData(frame_->draw_data(), cmd);
+  }
 }
-void ImGuiRenderPass::post_render(SubmissionContext& sc) {
+void ImGuiRenderPass::post_render(
+    SubmissionContext& sc,
+    vk::CommandBuffer cmd) {
 }
 
 void ImGuiRenderPass::create_fonts_texture(SubmissionContext& sc) {
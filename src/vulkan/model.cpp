@@ -19,6 +19,7 @@
 #include <filesystem>
 #include <numeric>
 #include <ranges>
+#include <span>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_raii.hpp>
@@ -32,6 +33,7 @@
 #include "rndrx/vulkan/material.hpp"
 #include "rndrx/vulkan/texture.hpp"
 #include "rndrx/vulkan/shader_cache.hpp"
+#include "rndrx/vulkan/upload_queue.hpp"
 #include "rndrx/vulkan/vma/buffer.hpp"
 
 namespace rndrx::vulkan {
@@ -105,6 +107,8 @@ void ModelCreator::create(Device& device, Model& out) {
 
 Model::Model(Device& device, ShaderCache const& shaders, ModelCreator& source) {
   source.create(device, *this);
+  // Start the uploads now rather than with whatever is uploaded next.
+  device.upload_queue().flush();
   vs_ = shaders.get("simple_static_model.vsmain");
   fs_ = shaders.get("gbuffer_opaque.psmain");
 }
@@ -130,65 +134,39 @@ void Model::create_device_buffers(
 
   RNDRX_ASSERT(vertex_buffer_size > 0);
 
-  vma::Buffer vertex_staging = device.allocator().create_buffer(
-      vk::BufferCreateInfo()
-          .setSize(vertex_buffer_size)
-          .setUsage(vk::BufferUsageFlagBits::eTransferSrc));
+  VmaAllocationCreateInfo allocation_create_info = {};
+  allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
 
-  vma::Buffer index_staging = device.allocator().create_buffer(
-      vk::BufferCreateInfo()
-          .setSize(index_buffer_size)
-          .setUsage(vk::BufferUsageFlagBits::eTransferSrc));
-
-  vertices_ = device.allocator().create_buffer(
+  vertices_ = vma::Buffer(
+      device.allocator(),
       vk::BufferCreateInfo()
           .setSize(vertex_buffer_size)
           .setUsage(
               vk::BufferUsageFlagBits::eTransferDst |
-              vk::BufferUsageFlagBits::eVertexBuffer));
-
-  std::memcpy(vertices_.mapped_data(), vertex_buffer.data(), vertex_buffer_size);
+              vk::BufferUsageFlagBits::eVertexBuffer),
+      allocation_create_info);
 
-  indices_ = device.allocator().create_buffer(
+  indices_ = vma::Buffer(
+      device.allocator(),
       vk::BufferCreateInfo()
           .setSize(index_buffer_size)
           .setUsage(
               vk::BufferUsageFlagBits::eTransferDst |
-              vk::BufferUsageFlagBits::eIndexBuffer));
-
-  std::memcpy(indices_.mapped_data(), index_buffer.data(), index_buffer_size);
+              vk::BufferUsageFlagBits::eIndexBuffer),
+      allocation_create_info);
 
-  auto transfer_cmd = device.alloc_transfer_command_buffer();
-  transfer_cmd.begin( //
-      vk::CommandBufferBeginInfo().setFlags(
-          vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
-
-  transfer_cmd.copyBuffer(
-      *vertex_staging.vk(),
+  // The textures were recorded into this batch or earlier ones, so the
+  // buffers' token covers the whole model.
+  UploadQueue& uploads = device.upload_queue();
+  upload_token_ = uploads.upload(
       *vertices_.vk(),
-      vk::BufferCopy(0, 0, vertex_buffer_size));
-
-  transfer_cmd.copyBuffer(
-      *index_staging.vk(),
-      *indices_.vk(),
-      vk::BufferCopy(0, 0, index_buffer_size));
-
-  transfer_cmd.end();
-
-  vk::raii::Fence fence = device.vk().createFence({});
-
-  device.transfer_queue().submit2(
-      vk::SubmitInfo2() //
-          .setCommandBufferInfos(
-              vk::CommandBufferSubmitInfo().setCommandBuffer(*transfer_cmd)),
-      *fence);
-  vk::Result wait_result = device.vk().waitForFences(
-      *fence,
-      VK_TRUE,
-      std::numeric_limits<std::uint64_t>::max());
-
-  if(wait_result != vk::Result::eSuccess) {
-    throw_runtime_error("Failed to wait for fence.");
+      0,
+      std::as_bytes(vertex_buffer));
+  if(index_buffer_size > 0) {
+    upload_token_ = uploads.upload(
+        *indices_.vk(),
+        0,
+        std::as_bytes(index_buffer));
   }
 }
 
@@ -0,0 +1,157 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "rndrx/vulkan/offscreen_queue.hpp"
+
+#include <vulkan/vulkan_core.h>
+#include <vulkan/vulkan_raii.hpp>
+#include "rndrx/assert.hpp"
+#include "rndrx/vulkan/device.hpp"
+#include "rndrx/vulkan/frame_timeline.hpp"
+#include "rndrx/vulkan/submission_context.hpp"
+
+namespace rndrx::vulkan {
+
+namespace {
+// kFormat is four bytes per pixel.
+constexpr vk::DeviceSize kBytesPerPixel = 4;
+} // namespace
+
+OffscreenQueue::OffscreenQueue(
+    Device& device,
+    vk::Extent2D extent,
+    std::uint32_t frames_in_flight,
+    bool readback)
+    : images_(frames_in_flight)
+    , extent_(extent)
+    , readback_(readback) {
+  create_images(device);
+}
+
+OffscreenContext OffscreenQueue::acquire_context() {
+  image_idx_ = (image_idx_ + 1) % images_.size();
+  Image const& image = images_[image_idx_];
+  return {*image.image.vk(), *image.view, image_idx_};
+}
+
+void OffscreenQueue::record_readback(
+    SubmissionContext& sc,
+    OffscreenContext const& ctx) {
+  RNDRX_ASSERT(readback_);
+  Image& image = images_[ctx.image_idx_];
+  vk::CommandBuffer cmd = sc.command_buffer();
+  cmd.copyImageToBuffer(
+      *image.image.vk(),
+      final_layout(),
+      *image.readback.vk(),
+      vk::BufferImageCopy()
+          .setImageSubresource(vk::ImageSubresourceLayers(
+              vk::ImageAspectFlagBits::eColor,
+              0,
+              0,
+              1))
+          .setImageExtent(vk::Extent3D(extent_, 1)));
+
+  vk::BufferMemoryBarrier2 to_host;
+  to_host //
+      .setSrcStageMask(vk::PipelineStageFlagBits2::eCopy)
+      .setSrcAccessMask(vk::AccessFlagBits2::eTransferWrite)
+      .setDstStageMask(vk::PipelineStageFlagBits2::eHost)
+      .setDstAccessMask(vk::AccessFlagBits2::eHostRead)
+      .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+      .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+      .setBuffer(*image.readback.vk())
+      .setSize(VK_WHOLE_SIZE);
+  cmd.pipelineBarrier2(vk::DependencyInfo().setBufferMemoryBarriers(to_host));
+  image.readback_frame = sc.frame_index();
+}
+
+std::optional<OffscreenReadback> OffscreenQueue::poll_readback(
+    FrameTimeline const& timeline) {
+  Image* oldest = nullptr;
+  std::uint64_t const completed = timeline.completed_frame();
+  for(auto&& image : images_) {
+    if(image.readback_frame == 0 || image.readback_frame > completed) {
+      continue;
+    }
+
+    if(!oldest || image.readback_frame < oldest->readback_frame) {
+      oldest = &image;
+    }
+  }
+
+  if(!oldest) {
+    return std::nullopt;
+  }
+
+  oldest->readback.invalidate();
+  OffscreenReadback readback;
+  readback.frame_index = oldest->readback_frame;
+  readback.format = kFormat;
+  readback.extent = extent_;
+  readback.pixels = std::span(
+      static_cast<std::byte const*>(oldest->readback.mapped_data()),
+      extent_.width * extent_.height * kBytesPerPixel);
+  oldest->readback_frame = 0;
+  return readback;
+}
+
+void OffscreenQueue::create_images(Device& device) {
+  for(auto&& image : images_) {
+    image.image = device.allocator().create_image(
+        vk::ImageCreateInfo()
+            .setImageType(vk::ImageType::e2D)
+            .setFormat(kFormat)
+            .setExtent(vk::Extent3D(extent_, 1))
+            .setMipLevels(1)
+            .setArrayLayers(1)
+            .setSamples(vk::SampleCountFlagBits::e1)
+            .setTiling(vk::ImageTiling::eOptimal)
+            .setUsage(
+                vk::ImageUsageFlagBits::eColorAttachment |
+                vk::ImageUsageFlagBits::eSampled |
+                vk::ImageUsageFlagBits::eTransferSrc)
+            .setSharingMode(vk::SharingMode::eExclusive)
+            .setInitialLayout(vk::ImageLayout::eUndefined));
+    image.view = device.vk().createImageView(
+        vk::ImageViewCreateInfo()
+            .setImage(*image.image.vk())
+            .setViewType(vk::ImageViewType::e2D)
+            .setFormat(kFormat)
+            .setSubresourceRange(vk::ImageSubresourceRange(
+                vk::ImageAspectFlagBits::eColor,
+                0,
+                1,
+                0,
+                1)));
+
+    if(!readback_) {
+      continue;
+    }
+
+    // Read by the host in no particular order, so cached memory is best.
+    VmaAllocationCreateInfo allocation_create_info = {};
+    allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+    allocation_create_info.flags =
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT |
+        VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    image.readback = vma::Buffer(
+        device.allocator(),
+        vk::BufferCreateInfo()
+            .setSize(extent_.width * extent_.height * kBytesPerPixel)
+            .setUsage(vk::BufferUsageFlagBits::eTransferDst),
+        allocation_create_info);
+  }
+}
+
+} // namespace rndrx::vulkan
@@ -13,6 +13,23 @@
 // limitations under the License.
 #include "rndrx/vulkan/renderer.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <glm/vec4.hpp>
+#include "rndrx/assert.hpp"
+#include "rndrx/frame_graph_description.hpp"
+#include "rndrx/log.hpp"
+#include "rndrx/throw_exception.hpp"
+#include "rndrx/vulkan/application.hpp"
+#include "rndrx/vulkan/formats.hpp"
+#include "rndrx/vulkan/frame_graph_builder.hpp"
+
 namespace rndrx::vulkan {
 
 namespace {
@@ -27,17 +44,212 @@ ShaderCache load_essential_shaders(Device& device) {
   loader.load("simple_static_model.phong");
   return cache;
 }
+
+// The thread rendering the frame records too, so the pool has one worker
+// fewer than there are recording threads.
+std::size_t recording_worker_count(ApplicationConfig const& config) {
+  std::size_t threads = config.recording_threads;
+  if(threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  return threads - 1;
+}
+
+// The name of the swapchain image in the renderer's graphs.
+constexpr std::string_view kBackbuffer = "backbuffer";
+// The UI layer, sampled by the composite.
+constexpr std::string_view kUi = "ui";
+constexpr ImageFormat kUiFormat = ImageFormat::B8G8R8A8Unorm;
 } // namespace
 
 Renderer::Renderer(Application const& app)
-    : device_(app)
-    , swapchain_(app, device_)
+    : headless_(app.is_headless())
+    , device_(app)
+    , swapchain_(
+          headless_ ? Swapchain()
+                    : Swapchain(app, device_, app.window().extents().extent))
+    , present_queue_(
+          headless_ ? PresentationQueue()
+                    : PresentationQueue(
+                          device_,
+                          swapchain_,
+                          device_.graphics_queue(),
+                          app.frames_in_flight()))
+    , offscreen_queue_(
+          headless_ ? OffscreenQueue(
+                          device_,
+                          app.config().headless_extent,
+                          app.frames_in_flight(),
+                          app.config().readback)
+                    : OffscreenQueue())
     , shaders_(load_essential_shaders(device_))
-    , final_composite_pass_(device_, swapchain_.surface_format().format, shaders_)
-    // , present_queue_(
-    //       device_,
-    //       swapchain_,
-    //       device_.graphics_queue(),
-    //       *final_composite_pass_.render_pass()) {
-  {}
+    , final_composite_pass_(device_, output_format(), shaders_)
+    , imgui_render_pass_(
+          headless_ ? ImGuiRenderPass() : ImGuiRenderPass(device_))
+    , recording_threads_(recording_worker_count(app.config()))
+    , frame_graph_resources_(device_) {
+  if(app.config().profile_frame_graphs) {
+    FrameGraphProfiler::Options options;
+    options.frames_in_flight = app.frames_in_flight();
+    profiling_ = options;
+  }
+
+  if(!headless_) {
+    imgui_render_pass_.initialise_imgui(
+        device_,
+        app,
+        static_cast<std::uint32_t>(swapchain_.images().size()),
+        to_vulkan_format(kUiFormat));
+  }
+
+  create_frame_graphs();
+}
+
+void Renderer::create_frame_graphs() {
+  deferred_frame_graph_ = FrameGraph(
+      frame_graph_builder(),
+      frame_graph_description());
+  update_composite_sources();
+}
+
+FrameGraphBuilder Renderer::frame_graph_builder() {
+  // The composite pipeline is built for dynamic rendering.
+  FrameGraphBuilder builder(device_, &recording_threads_);
+  builder.set_resource_pool(&frame_graph_resources_);
+  builder.set_dynamic_rendering(true);
+  builder.set_output_extent(output_extent());
+  if(profiling_) {
+    builder.enable_profiling(*profiling_);
+  }
+
+  builder.register_pass("final_composite", &final_composite_pass_);
+  if(!headless_) {
+    builder.register_pass("imgui", &imgui_render_pass_);
+  }
+
+  return builder;
+}
+
+FrameGraphDescription Renderer::frame_graph_description() const {
+  std::optional<ImageFormat> backbuffer_format = from_vulkan_format(
+      output_format());
+  if(!backbuffer_format) {
+    RNDRX_THROW_RUNTIME_ERROR() << "Unsupported output format "
+                                << vk::to_string(output_format());
+  }
+
+  // Attachments are sized relative to the output, so the description
+  // doesn't change with the swapchain.
+  FrameGraphDescription description;
+  FrameGraphRenderPassDescription composite("final_composite");
+  if(!headless_) {
+    description.add_render_pass(
+        FrameGraphRenderPassDescription("imgui").add_output(
+            FrameGraphAttachmentOutputDescription(std::string(kUi))
+                .format(kUiFormat)
+                .load_op(AttachmentLoadOp::Clear)
+                .clear_colour(glm::vec4(0))));
+    composite.add_input(FrameGraphInputImageDescription(std::string(kUi)));
+  }
+
+  composite.add_output(
+      FrameGraphAttachmentOutputDescription(std::string(kBackbuffer))
+          .format(*backbuffer_format)
+          .load_op(AttachmentLoadOp::Clear)
+          .imported());
+  description.add_render_pass(std::move(composite));
+  return description;
+}
+
+void Renderer::update_composite_sources() {
+  // The composite blends the layers the graph rendered this frame.
+  std::vector<vk::ImageView> sources;
+  if(FrameGraphAttachment const* ui = deferred_frame_graph_.find_attachment(
+         kUi)) {
+    sources.push_back(ui->vk_image_view());
+  }
+
+  final_composite_pass_.set_sources(device_, sources);
+}
+
+std::optional<PresentationContext> Renderer::acquire_present_context() {
+  return present_queue_.acquire_context();
+}
+
+void Renderer::render(SubmissionContext& sc, PresentationContext const& ctx) {
+  FrameGraphImportedImage backbuffer;
+  backbuffer.image = ctx.image();
+  backbuffer.view = ctx.image_view();
+  backbuffer.acquire_semaphore = ctx.acquire_semaphore();
+  backbuffer.release_semaphore = ctx.present_semaphore();
+  deferred_frame_graph_.import_image(kBackbuffer, backbuffer);
+  deferred_frame_graph_.render(sc);
+}
+
+void Renderer::present(PresentationContext const& ctx) {
+  present_queue_.present(ctx);
+}
+
+bool Renderer::recreate_swapchain(
+    Application const& app,
+    vk::Extent2D framebuffer_extent) {
+  RNDRX_ASSERT(!headless_);
+  device_.vk().waitIdle();
+
+  // The graph caches framebuffers of the old images.
+  deferred_frame_graph_.release_imported_images();
+  vk::Format const old_format = output_format();
+  if(!swapchain_.recreate(app, device_, framebuffer_extent)) {
+    return false;
+  }
+
+  present_queue_.recreate(device_);
+  if(output_format() != old_format) {
+    RNDRX_THROW_RUNTIME_ERROR() << "Swapchain format changed to "
+                                << vk::to_string(output_format());
+  }
+
+  // Only the attachments sized by the output are recreated, after the
+  // old ones have gone back to the pool.
+  deferred_frame_graph_.update(
+      frame_graph_builder(),
+      frame_graph_description());
+  update_composite_sources();
+  LOG(Info) << "Swapchain recreated at " << output_extent().width << "x"
+            << output_extent().height;
+  return true;
+}
+
+void Renderer::render_offscreen(SubmissionContext& sc) {
+  OffscreenContext ctx = offscreen_queue_.acquire_context();
+  FrameGraphImportedImage backbuffer;
+  backbuffer.image = ctx.image();
+  backbuffer.view = ctx.image_view();
+  backbuffer.final_layout = offscreen_queue_.final_layout();
+  if(offscreen_queue_.has_readback()) {
+    backbuffer.final_stages = vk::PipelineStageFlagBits2::eCopy;
+    backbuffer.final_access = vk::AccessFlagBits2::eTransferRead;
+  }
+
+  deferred_frame_graph_.import_image(kBackbuffer, backbuffer);
+  deferred_frame_graph_.render(sc);
+  if(offscreen_queue_.has_readback()) {
+    offscreen_queue_.record_readback(sc, ctx);
+  }
+}
+
+std::optional<OffscreenReadback> Renderer::poll_readback(
+    FrameTimeline const& timeline) {
+  return offscreen_queue_.poll_readback(timeline);
+}
+
+vk::Format Renderer::output_format() const {
+  return headless_ ? offscreen_queue_.format()
+                   : swapchain_.surface_format().format;
+}
+
+vk::Extent2D Renderer::output_extent() const {
+  return headless_ ? offscreen_queue_.extent() : swapchain_.extent();
+}
 } // namespace rndrx::vulkan
@@ -0,0 +1,89 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "rndrx/vulkan/static_frame_graph.hpp"
+
+#include <array>
+#include "rndrx/formats.hpp"
+#include "rndrx/frame_graph_description.hpp"
+#include "rndrx/vulkan/composite_render_pass.hpp"
+#include "rndrx/vulkan/imgui_render_pass.hpp"
+
+// Compile-checks an example plan shaped like the renderer's UI composite,
+// so the plan compiler and the graph are compiled along with the library.
+// Nothing runs it. The passes are declared out of order to exercise the
+// scheduling.
+
+namespace rndrx::vulkan {
+namespace {
+constexpr auto kUiCompositePlan = compile_static_frame_graph(
+    std::array{
+        StaticFrameGraphImage{"ui", ImageFormat::B8G8R8A8Unorm},
+        StaticFrameGraphImage{"colour", ImageFormat::B8G8R8A8Unorm}},
+    std::array{
+        StaticFrameGraphPass{
+            "composite",
+            FrameGraphPassType::Graphics,
+            {{{"ui", FrameGraphResourceUsage::SampledImage},
+              {"colour", FrameGraphResourceUsage::ColourAttachment}}}},
+        StaticFrameGraphPass{
+            "imgui",
+            FrameGraphPassType::Graphics,
+            {{{"ui", FrameGraphResourceUsage::ColourAttachment}}}}});
+
+constexpr std::size_t kUi = kUiCompositePlan.image_index("ui");
+constexpr std::size_t kColour = kUiCompositePlan.image_index("colour");
+constexpr std::size_t kComposite = kUiCompositePlan.pass_index("composite");
+constexpr std::size_t kImGui = kUiCompositePlan.pass_index("imgui");
+
+static_assert(
+    kUiCompositePlan.order[0] == kImGui &&
+        kUiCompositePlan.order[1] == kComposite,
+    "The UI has to be drawn before it's composited.");
+static_assert(
+    kUiCompositePlan.first_use[kUi] == 0 &&
+        kUiCompositePlan.last_use[kUi] == 1 &&
+        kUiCompositePlan.first_use[kColour] == 1,
+    "Image lifetimes span their first and last access.");
+
+// The UI is discarded before it's drawn, then made readable for the
+// composite, which discards the colour image it draws into.
+static_assert(
+    kUiCompositePlan.transition_begin[0] == 0 &&
+        kUiCompositePlan.transition_begin[1] == 1 &&
+        kUiCompositePlan.transition_begin[2] == 3,
+    "One barrier before the UI and two before the composite.");
+static_assert(
+    kUiCompositePlan.transitions[0].image == kUi &&
+    kUiCompositePlan.transitions[0].first &&
+    kUiCompositePlan.transitions[0].discard);
+static_assert(
+    kUiCompositePlan.transitions[1].image == kUi &&
+    kUiCompositePlan.transitions[1].src ==
+        FrameGraphResourceUsage::ColourAttachment &&
+    kUiCompositePlan.transitions[1].dst ==
+        FrameGraphResourceUsage::SampledImage &&
+    !kUiCompositePlan.transitions[1].discard);
+static_assert(
+    kUiCompositePlan.transitions[2].image == kColour &&
+    kUiCompositePlan.transitions[2].first);
+} // namespace
+
+// Instantiates every member, so the recording code is checked against the
+// real pass types.
+template class StaticFrameGraph<
+    kUiCompositePlan,
+    CompositeRenderPass,
+    ImGuiRenderPass>;
+
+} // namespace rndrx::vulkan
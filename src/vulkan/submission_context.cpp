@@ -13,64 +13,199 @@
 // limitations under the License.
 #include "rndrx/vulkan/submission_context.hpp"
 
-#include <vulkan/vulkan_core.h>
 #include <cstdint>
-#include <limits>
 #include <vulkan/vulkan_raii.hpp>
+#include "rndrx/assert.hpp"
 #include "rndrx/throw_exception.hpp"
 #include "rndrx/vulkan/device.hpp"
 
 namespace rndrx::vulkan {
 SubmissionContext::~SubmissionContext() {
-  wait_for_fence();
+  wait_for_completion();
+}
+
+vk::CommandBuffer SubmissionContext::command_buffer(QueueType queue) {
+  QueueCommands& commands = queue_commands(queue);
+  if(!commands.recording) {
+    vk::CommandBuffer cmd = next_command_buffer(
+        commands.primary_pool,
+        vk::CommandBufferLevel::ePrimary);
+    cmd.begin(vk::CommandBufferBeginInfo().setFlags(
+        vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    commands.recording = true;
+  }
+
+  return *commands.primary_pool
+              .command_buffers[commands.primary_pool.num_used - 1];
 }
 
 void SubmissionContext::begin_rendering(vk::Rect2D extents) {
   render_extents_ = extents;
-  wait_for_fence();
-  command_pool_.reset();
-  vk::CommandBufferBeginInfo begin_info;
-  command_buffer().begin(begin_info);
+  wait_for_completion();
+  frame_index_ = timeline_->begin_frame();
+  next_timeline_step_ = 1;
+  transient_buffers_.reset();
+  for(auto&& commands : queues_) {
+    RNDRX_ASSERT(!commands.recording);
+    commands.next_submit_waits.clear();
+    commands.primary_pool.pool.reset();
+    commands.primary_pool.num_used = 0;
+    for(auto&& recording_pool : commands.recording_pools) {
+      recording_pool.pool.reset();
+      recording_pool.num_used = 0;
+    }
+  }
+
+  command_buffer(QueueType::Graphics);
 }
 
 void SubmissionContext::finish_rendering() {
-  command_buffer().end();
-  vk::PipelineStageFlags stage_flags = vk::PipelineStageFlagBits::eAllCommands;
-  vk::SubmitInfo submit_info;
-  submit_info //
-      .setWaitDstStageMask(stage_flags)
-      .setCommandBuffers(*command_buffers_[0])
-      .setWaitSemaphoreCount(0);
-  device_.vk().resetFences(*submit_fence_);
-  device_.graphics_queue().submit(submit_info, *submit_fence_);
-}
-
-void SubmissionContext::wait_for_fence() {
-  auto result = device_.vk().waitForFences(
-      *submit_fence_,
-      VK_TRUE,
-      std::numeric_limits<std::uint64_t>::max());
-  if(result != vk::Result::eSuccess) {
-    throw_runtime_error("Failed to wait for fences.");
+  signal_compute_timeline();
+  final_signals_.push_back(
+      timeline_->signal_info(QueueType::Graphics, frame_index_));
+  submit_to_queue(QueueType::Graphics, final_waits_, final_signals_);
+  final_waits_.clear();
+  final_signals_.clear();
+}
+
+void SubmissionContext::signal_compute_timeline() {
+  // Compute work left unsubmitted has nothing to wait for it.
+  if(!device_.has_async_compute()) {
+    if(queue_commands(QueueType::Compute).recording) {
+      submit(QueueType::Compute, {}, {});
+    }
+
+    // The graphics signal covers it as the queues are the same.
+    return;
+  }
+
+  // The compute timeline has to reach every frame index, even for frames
+  // without compute work, so an empty submission signals it if needed.
+  // The signal covers everything submitted to the queue before it.
+  vk::SemaphoreSubmitInfo signal =
+      timeline_->signal_info(QueueType::Compute, frame_index_);
+  if(queue_commands(QueueType::Compute).recording) {
+    submit_to_queue(QueueType::Compute, {}, signal);
+  }
+  else {
+    device_.queue(QueueType::Compute)
+        .submit2(vk::SubmitInfo2().setSignalSemaphoreInfos(signal));
+  }
+}
+
+void SubmissionContext::submit(
+    QueueType queue,
+    std::span<vk::SemaphoreSubmitInfo const> waits,
+    std::span<vk::SemaphoreSubmitInfo const> signals) {
+  submit_to_queue(queue, waits, signals);
+  if(queue == QueueType::Graphics) {
+    command_buffer(QueueType::Graphics);
+  }
+}
+
+void SubmissionContext::wait_semaphore(vk::SemaphoreSubmitInfo const& wait) {
+  final_waits_.push_back(wait);
+}
+
+void SubmissionContext::signal_semaphore(vk::SemaphoreSubmitInfo const& signal) {
+  final_signals_.push_back(signal);
+}
+
+void SubmissionContext::wait_before_next_submit(
+    QueueType queue,
+    vk::SemaphoreSubmitInfo const& wait) {
+  queue_commands(queue).next_submit_waits.push_back(wait);
+}
+
+void SubmissionContext::submit_to_queue(
+    QueueType queue,
+    std::span<vk::SemaphoreSubmitInfo const> waits,
+    std::span<vk::SemaphoreSubmitInfo const> signals) {
+  vk::CommandBuffer cmd = command_buffer(queue);
+  cmd.end();
+  QueueCommands& commands = queue_commands(queue);
+  commands.recording = false;
+
+  std::vector<vk::SemaphoreSubmitInfo> all_waits;
+  if(!commands.next_submit_waits.empty()) {
+    all_waits = std::move(commands.next_submit_waits);
+    commands.next_submit_waits.clear();
+    all_waits.insert(all_waits.end(), waits.begin(), waits.end());
+    waits = all_waits;
+  }
+
+  vk::CommandBufferSubmitInfo cmd_info(cmd);
+  device_.queue(queue).submit2(
+      vk::SubmitInfo2()
+          .setWaitSemaphoreInfos(waits)
+          .setCommandBufferInfos(cmd_info)
+          .setSignalSemaphoreInfos(signals));
+}
+
+std::uint64_t SubmissionContext::reserve_timeline_steps(std::size_t count) {
+  std::uint64_t const first = next_timeline_step_;
+  next_timeline_step_ += count;
+  if(next_timeline_step_ > FrameTimeline::kStepsPerFrame) {
+    RNDRX_THROW_RUNTIME_ERROR() << "Frame uses more than "
+                                << FrameTimeline::kStepsPerFrame - 1
+                                << " timeline steps.";
+  }
+
+  return first;
+}
+
+void SubmissionContext::wait_for_completion() const {
+  timeline_->wait(frame_index_);
+}
+
+void SubmissionContext::reserve_recording_threads(std::size_t count) {
+  for(QueueType queue : {QueueType::Graphics, QueueType::Compute}) {
+    auto& recording_pools = queue_commands(queue).recording_pools;
+    while(recording_pools.size() < count) {
+      recording_pools.push_back(create_command_pool(queue));
+    }
   }
 }
 
-void SubmissionContext::create_command_pool(Device& device) {
-  vk::CommandPoolCreateInfo create_info({}, device.graphics_queue_family_idx());
-  command_pool_ = device.vk().createCommandPool(create_info);
+vk::CommandBuffer SubmissionContext::secondary_command_buffer(
+    std::size_t thread_idx,
+    QueueType queue) {
+  auto& recording_pools = queue_commands(queue).recording_pools;
+  RNDRX_ASSERT(thread_idx < recording_pools.size());
+  return next_command_buffer(
+      recording_pools[thread_idx],
+      vk::CommandBufferLevel::eSecondary);
 }
 
-void SubmissionContext::create_command_buffers(Device& device) {
-  vk::CommandBufferAllocateInfo alloc_info(
-      *command_pool_,
-      vk::CommandBufferLevel::ePrimary,
-      1);
-  command_buffers_ = vk::raii::CommandBuffers(device.vk(), alloc_info);
+SubmissionContext::CommandPool SubmissionContext::create_command_pool(
+    QueueType queue) const {
+  CommandPool command_pool;
+  command_pool.pool = device_.vk().createCommandPool(
+      vk::CommandPoolCreateInfo()
+          .setFlags(vk::CommandPoolCreateFlagBits::eTransient)
+          .setQueueFamilyIndex(device_.queue_family_idx(queue)));
+  return command_pool;
 }
 
-void SubmissionContext::create_sync_objects(Device& device) {
-  vk::FenceCreateInfo fence_create_info(vk::FenceCreateFlagBits::eSignaled);
-  submit_fence_ = device.vk().createFence(fence_create_info);
+vk::CommandBuffer SubmissionContext::next_command_buffer(
+    CommandPool& pool,
+    vk::CommandBufferLevel level) const {
+  if(pool.num_used == pool.command_buffers.size()) {
+    auto command_buffers = device_.vk().allocateCommandBuffers(
+        vk::CommandBufferAllocateInfo()
+            .setCommandPool(*pool.pool)
+            .setLevel(level)
+            .setCommandBufferCount(1));
+    pool.command_buffers.push_back(std::move(command_buffers.front()));
+  }
+
+  return *pool.command_buffers[pool.num_used++];
+}
+
+void SubmissionContext::create_command_pools(Device& device) {
+  for(QueueType queue : {QueueType::Graphics, QueueType::Compute}) {
+    queue_commands(queue).primary_pool = create_command_pool(queue);
+  }
 }
 
-} // namespace rndrx::vulkan
\ No newline at end of file
+} // namespace rndrx::vulkan
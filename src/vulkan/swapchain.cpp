@@ -13,7 +13,7 @@
 // limitations under the License.
 #include "rndrx/vulkan/swapchain.hpp"
 
-#include <GLFW/glfw3.h>
+#include <algorithm>
 #include <iterator>
 #include <limits>
 #include <ranges>
@@ -22,13 +22,12 @@
 #include <vulkan/vulkan_handles.hpp>
 #include <vulkan/vulkan_raii.hpp>
 #include <vulkan/vulkan_structs.hpp>
+#include "rndrx/log.hpp"
 #include "rndrx/noncopyable.hpp"
 #include "rndrx/throw_exception.hpp"
 #include "rndrx/to_vector.hpp"
 #include "rndrx/vulkan/application.hpp"
 #include "rndrx/vulkan/device.hpp"
-#include "rndrx/vulkan/render_target.hpp"
-#include "rndrx/vulkan/window.hpp"
 
 namespace rndrx::vulkan {
 
@@ -40,6 +39,21 @@ void transform_from_raii(SourceRange&& src, DestinationRange&& dest) {
 }
 
 namespace {
+vk::PresentModeKHR to_vulkan_present_mode(PresentMode mode) {
+  switch(mode) {
+    case PresentMode::Immediate:
+      return vk::PresentModeKHR::eImmediate;
+    case PresentMode::Mailbox:
+      return vk::PresentModeKHR::eMailbox;
+    case PresentMode::Fifo:
+      return vk::PresentModeKHR::eFifo;
+    case PresentMode::FifoRelaxed:
+      return vk::PresentModeKHR::eFifoRelaxed;
+  }
+
+  return vk::PresentModeKHR::eFifo;
+}
+
 class SwapChainSupportDetails {
  public:
   SwapChainSupportDetails(vk::PhysicalDevice const& pd, vk::SurfaceKHR const& surface) {
@@ -64,35 +78,23 @@ class SwapChainSupportDetails {
     return formats_[0];
   }
 
-  vk::PresentModeKHR choose_present_mode() const {
-    auto selected_present_mode = std::ranges::find_if(
-        present_modes_,
-        [](vk::PresentModeKHR const& available_present_mode) {
-          return available_present_mode == vk::PresentModeKHR::eMailbox;
-        });
-
-    if(selected_present_mode != present_modes_.end()) {
-      return *selected_present_mode;
+  vk::PresentModeKHR choose_present_mode(PresentMode requested) const {
+    vk::PresentModeKHR const mode = to_vulkan_present_mode(requested);
+    if(std::ranges::find(present_modes_, mode) != present_modes_.end()) {
+      return mode;
     }
 
-    // Hope for the best
+    LOG(Warn) << vk::to_string(mode) << " isn't supported, using FIFO.";
     return vk::PresentModeKHR::eFifo;
   }
 
-  vk::Extent2D choose_extent(Window const& window) const {
+  vk::Extent2D choose_extent(vk::Extent2D framebuffer_extent) const {
     if(capabilities_.currentExtent.width !=
        std::numeric_limits<std::uint32_t>::max()) {
       return capabilities_.currentExtent;
     }
     else {
-      // We need to refetch the window size after creating the surface
-      // because we we requested might not be the same.
-      int width, height;
-      glfwGetFramebufferSize(window.glfw(), &width, &height);
-
-      vk::Extent2D actual_extent(
-          static_cast<std::uint32_t>(width),
-          static_cast<std::uint32_t>(height));
+      vk::Extent2D actual_extent = framebuffer_extent;
 
       actual_extent.width = std::clamp(
           actual_extent.width,
@@ -127,61 +129,81 @@ class SwapChainSupportDetails {
 } // namespace
 
 PresentationQueue::~PresentationQueue() {
-  std::vector<vk::Fence> wait_fences;
-  transform_from_raii(image_ready_fences_, wait_fences);
-  auto wait_result = swapchain_->vk().getDevice().waitForFences(
-      wait_fences,
-      VK_TRUE,
-      std::numeric_limits<std::uint64_t>::max());
-
-  if(wait_result != vk::Result::eSuccess) {
-    // Don't throw from destructor -- hope for the best.
-    // throw_runtime_error("Failed to wait for fence.");
+  // Pending presents still wait on the semaphores.
+  if(present_queue_ != nullptr) {
+    present_queue_->waitIdle();
   }
 }
 
-PresentationContext PresentationQueue::acquire_context() {
-  sync_idx_ = (sync_idx_ + 1) % image_ready_fences_.size();
-  auto wait_result = swapchain_->vk().getDevice().waitForFences(
-      *image_ready_fences_[sync_idx_],
-      VK_TRUE,
-      std::numeric_limits<std::uint64_t>::max());
-
-  if(wait_result != vk::Result::eSuccess) {
-    throw_runtime_error("Failed to wait for fence.");
+std::optional<PresentationContext> PresentationQueue::acquire_context() {
+  // An acquire semaphore can be reused once the submission waiting on it
+  // has finished. There is one per frame in flight, or per image if that
+  // is more, and the frame timeline keeps older frames from being pending.
+  sync_idx_ = (sync_idx_ + 1) % acquire_semaphores_.size();
+  vk::ResultValue<std::uint32_t> result(vk::Result::eErrorOutOfDateKHR, 0);
+  try {
+    result = swapchain_->vk().getDevice().acquireNextImage2KHR(
+        vk::AcquireNextImageInfoKHR()
+            .setSwapchain(*swapchain_->vk())
+            .setTimeout(std::numeric_limits<std::uint64_t>::max())
+            .setSemaphore(*acquire_semaphores_[sync_idx_])
+            .setDeviceMask(1));
+  }
+  catch(vk::OutOfDateKHRError const&) {
+    needs_recreation_ = true;
+    return std::nullopt;
   }
 
-  swapchain_->vk().getDevice().resetFences(*image_ready_fences_[sync_idx_]);
-
-  auto result = swapchain_->vk().getDevice().acquireNextImage2KHR(
-      vk::AcquireNextImageInfoKHR()
-          .setSwapchain(*swapchain_->vk())
-          .setTimeout(std::numeric_limits<std::uint64_t>::max())
-          .setFence(*image_ready_fences_[sync_idx_])
-          .setDeviceMask(1));
-  if(result.result != vk::Result::eSuccess) {
-    throw_runtime_error("Failed to handle swapchain acquire failure");
+  // A suboptimal image was still acquired and signals the semaphore, so
+  // the frame goes ahead.
+  if(result.result == vk::Result::eSuboptimalKHR) {
+    needs_recreation_ = true;
+  }
+  else if(result.result != vk::Result::eSuccess) {
+    RNDRX_THROW_RUNTIME_ERROR() << "Failed to acquire a swapchain image: "
+                                << vk::to_string(result.result);
   }
 
   image_idx_ = result.value;
 
-  return {
+  return PresentationContext{
       swapchain_->images()[image_idx_],
       *image_views_[image_idx_],
-      *framebuffers_[image_idx_],
+      *acquire_semaphores_[sync_idx_],
+      *present_semaphores_[image_idx_],
       image_idx_,
       sync_idx_};
 }
 
-void PresentationQueue::present(PresentationContext const& ctx) const {
+void PresentationQueue::present(PresentationContext const& ctx) {
   vk::PresentInfoKHR present_info;
-  present_info.setSwapchains(*swapchain_->vk()).setImageIndices(ctx.image_idx_);
-  auto result = present_queue_->presentKHR(present_info);
-  if(result != vk::Result::eSuccess) {
-    throw_runtime_error("Failed to handle swapchain present failure");
+  present_info //
+      .setWaitSemaphores(ctx.present_semaphore_)
+      .setSwapchains(*swapchain_->vk())
+      .setImageIndices(ctx.image_idx_);
+  try {
+    if(present_queue_->presentKHR(present_info) ==
+       vk::Result::eSuboptimalKHR) {
+      needs_recreation_ = true;
+    }
+  }
+  catch(vk::OutOfDateKHRError const&) {
+    // The present semaphore's wait still happens, so it can be reused.
+    needs_recreation_ = true;
   }
 }
 
+void PresentationQueue::recreate(Device const& device) {
+  image_views_.clear();
+  acquire_semaphores_.clear();
+  present_semaphores_.clear();
+  create_image_views(device);
+  create_sync_objects(device);
+  image_idx_ = std::numeric_limits<std::uint32_t>::max();
+  sync_idx_ = 0;
+  needs_recreation_ = false;
+}
+
 void PresentationQueue::create_image_views(Device const& device) {
   image_views_ = //
       swapchain_->images() |
@@ -201,41 +223,51 @@ void PresentationQueue::create_image_views(Device const& device) {
       to_vector;
 }
 
-void PresentationQueue::create_framebuffers(Device const& device, vk::RenderPass renderpass) {
-  framebuffers_ = //
-      image_views_ |
-      std::views::transform(
-          [this, &device, renderpass](vk::raii::ImageView const& image_view) {
-            return device.vk().createFramebuffer(
-                vk::FramebufferCreateInfo()
-                    .setRenderPass(renderpass)
-                    .setAttachments(*image_view)
-                    .setWidth(swapchain_->extent().width)
-                    .setHeight(swapchain_->extent().height)
-                    .setLayers(1));
-          }) |
+void PresentationQueue::create_sync_objects(Device const& device) {
+  auto create_semaphore = [&device](auto&&) {
+    return device.vk().createSemaphore(vk::SemaphoreCreateInfo());
+  };
+
+  std::size_t const num_acquire_semaphores = std::max<std::size_t>(
+      frames_in_flight_,
+      swapchain_->images().size());
+  acquire_semaphores_ = //
+      std::views::iota(std::size_t(0), num_acquire_semaphores) |
+      std::views::transform(create_semaphore) | to_vector;
+  present_semaphores_ = //
+      swapchain_->images() | std::views::transform(create_semaphore) |
       to_vector;
 }
 
-void PresentationQueue::create_sync_objects(Device const& device) {
-  image_ready_fences_ = //
-      swapchain_->images() |
-      std::views::transform([this, &device](vk::Image img) {
-        vk::FenceCreateInfo create_info(vk::FenceCreateFlagBits::eSignaled);
-        return device.vk().createFence(create_info);
-      }) |
-      to_vector;
+Swapchain::Swapchain(
+    Application const& app,
+    Device& device,
+    vk::Extent2D framebuffer_extent) {
+  create_swapchain(app, device, framebuffer_extent);
 }
 
-Swapchain::Swapchain(Application const& app, Device& device) {
-  create_swapchain(app, device);
+bool Swapchain::recreate(
+    Application const& app,
+    Device& device,
+    vk::Extent2D framebuffer_extent) {
+  return create_swapchain(app, device, framebuffer_extent);
 }
 
-void Swapchain::create_swapchain(Application const& app, Device& device) {
+bool Swapchain::create_swapchain(
+    Application const& app,
+    Device& device,
+    vk::Extent2D framebuffer_extent) {
   SwapChainSupportDetails support(*app.selected_device(), *app.surface());
+  vk::Extent2D const extent = support.choose_extent(framebuffer_extent);
+  // A swapchain can't have a zero extent, which is what the surface
+  // reports while the window is minimised.
+  if(extent.width == 0 || extent.height == 0) {
+    return false;
+  }
+
+  extent_ = extent;
   surface_format_ = support.choose_surface_format();
   queue_family_idx_ = app.find_graphics_queue_family_idx();
-  extent_ = support.choose_extent(app.window());
 
   swapchain_ = device.vk().createSwapchainKHR(
       vk::SwapchainCreateInfoKHR()
@@ -248,8 +280,11 @@ void Swapchain::create_swapchain(Application const& app, Device& device) {
           .setImageUsage(vk::ImageUsageFlagBits::eColorAttachment)
           .setImageSharingMode(vk::SharingMode::eExclusive)
           .setQueueFamilyIndices(queue_family_idx_)
-          .setPresentMode(support.choose_present_mode()));
+          .setPresentMode(
+              support.choose_present_mode(app.config().present_mode))
+          .setOldSwapchain(*swapchain_));
   images_ = swapchain_.getImages();
+  return true;
 }
 
 } // namespace rndrx::vulkan
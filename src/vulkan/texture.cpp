@@ -16,12 +16,11 @@
 #include <vulkan/vulkan_core.h>
 #include <cmath>
 #include <cstring>
-#include <limits>
 #include <utility>
 #include "rndrx/throw_exception.hpp"
 #include "rndrx/vulkan/device.hpp"
+#include "rndrx/vulkan/upload_queue.hpp"
 #include "rndrx/vulkan/vma/allocator.hpp"
-#include "rndrx/vulkan/vma/buffer.hpp"
 
 namespace {
 std::uint32_t compute_mip_level_count(std::uint32_t width, std::uint32_t height) {
@@ -70,14 +69,12 @@ Texture::Texture(Device& device, TextureCreateInfo const& create_info) {
           .setFormat(format_)
           .setSubresourceRange(whole_image_resource));
 
-  vma::Buffer staging_buffer = device.allocator().create_buffer(
-      vk::BufferCreateInfo()
-          .setSize(width_ * height_ * 4)
-          .setUsage(vk::BufferUsageFlagBits::eTransferSrc));
+  UploadQueue& uploads = device.upload_queue();
+  UploadQueue::Staging staging = uploads.stage(width_ * height_ * 4);
 
   if(create_info.component_count != 4) {
-    std::uint32_t* texel_data = static_cast<std::uint32_t*>(
-        staging_buffer.mapped_data());
+    std::uint32_t* texel_data = reinterpret_cast<std::uint32_t*>(
+        staging.data.data());
     int component_idx = 0;
     for(int i = 0; i < height_; ++i) {
       for(int j = 0; j < width_; ++j) {
@@ -92,15 +89,12 @@ Texture::Texture(Device& device, TextureCreateInfo const& create_info) {
   }
   else {
     std::memcpy(
-        staging_buffer.mapped_data(),
+        staging.data.data(),
         create_info.image_data.data(),
         create_info.image_data.size());
   }
 
-  vk::raii::CommandBuffer copy_cmd_buf = device.alloc_transfer_command_buffer();
-  copy_cmd_buf.begin( //
-      vk::CommandBufferBeginInfo().setFlags(
-          vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+  vk::CommandBuffer copy_cmd_buf = uploads.command_buffer();
 
   copy_cmd_buf.pipelineBarrier(
       vk::PipelineStageFlagBits::eAllCommands,
@@ -122,9 +116,10 @@ Texture::Texture(Device& device, TextureCreateInfo const& create_info) {
       vk::CopyBufferToImageInfo2()
           .setDstImage(*image_.vk())
           .setDstImageLayout(vk::ImageLayout::eTransferDstOptimal)
-          .setSrcBuffer(*staging_buffer.vk())
+          .setSrcBuffer(staging.buffer)
           .setRegions( //
               vk::BufferImageCopy2()
+                  .setBufferOffset(staging.offset)
                   .setImageExtent( //
                       vk::Extent3D().setWidth(width_).setHeight(height_).setDepth(1))
                   .setImageSubresource(
@@ -135,28 +130,10 @@ Texture::Texture(Device& device, TextureCreateInfo const& create_info) {
                           .setMipLevel(0))));
 
   generate_mip_maps(device, copy_cmd_buf);
-
-  copy_cmd_buf.end();
-
-  vk::raii::Fence fence = device.vk().createFence({});
-
-  device.transfer_queue().submit2(
-      vk::SubmitInfo2() //
-          .setCommandBufferInfos(
-              vk::CommandBufferSubmitInfo().setCommandBuffer(*copy_cmd_buf)),
-      *fence);
-
-  vk::Result wait_result = device.vk().waitForFences(
-      *fence,
-      VK_TRUE,
-      std::numeric_limits<std::uint64_t>::max());
-
-  if(wait_result != vk::Result::eSuccess) {
-    throw_runtime_error("Failed to wait for fence.");
-  }
+  upload_token_ = uploads.batch_token();
 }
 
-void Texture::generate_mip_maps(Device& device, vk::raii::CommandBuffer& cmd_buf) {
+void Texture::generate_mip_maps(Device& device, vk::CommandBuffer cmd_buf) {
   auto physical_device = device.physical_device();
   vk::FormatProperties props = physical_device.getFormatProperties(format_);
   if(!(props.optimalTilingFeatures &
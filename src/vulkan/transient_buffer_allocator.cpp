@@ -0,0 +1,116 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "rndrx/vulkan/transient_buffer_allocator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include "rndrx/assert.hpp"
+#include "rndrx/log.hpp"
+#include "rndrx/vulkan/device.hpp"
+#include "rndrx/vulkan/vma/allocator.hpp"
+
+namespace rndrx::vulkan {
+
+namespace {
+vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+TransientBufferAllocator::TransientBufferAllocator(
+    Device& device,
+    vk::DeviceSize block_size)
+    : device_(device)
+    , block_size_(block_size) {
+  // Offsets are bound directly into descriptors, so they have to satisfy
+  // every kind of buffer binding.
+  vk::PhysicalDeviceLimits const& limits =
+      device.physical_device().getProperties().limits;
+  alignment_ = std::max<vk::DeviceSize>(
+      {limits.minUniformBufferOffsetAlignment,
+       limits.minStorageBufferOffsetAlignment,
+       16});
+}
+
+TransientBufferAllocator::Allocation TransientBufferAllocator::allocate(
+    vk::DeviceSize size,
+    vk::BufferUsageFlags usage) {
+  RNDRX_ASSERT(size > 0);
+  RNDRX_ASSERT((usage & ~kSupportedUsage) == vk::BufferUsageFlags());
+
+  // Blocks are only filled in order, a block that can't fit the
+  // allocation is left with a gap at the end until the next reset.
+  while(current_block_ < blocks_.size()) {
+    Block& block = blocks_[current_block_];
+    vk::DeviceSize offset = align_up(block.used, alignment_);
+    if(offset + size <= block.size) {
+      block.used = offset + size;
+      return {*block.buffer.vk(), offset, size};
+    }
+    ++current_block_;
+  }
+
+  add_block(size);
+  Block& block = blocks_.back();
+  block.used = size;
+  return {*block.buffer.vk(), 0, size};
+}
+
+void TransientBufferAllocator::reset() {
+  for(auto&& block : blocks_) {
+    block.used = 0;
+  }
+  current_block_ = 0;
+}
+
+vk::DeviceSize TransientBufferAllocator::allocated_bytes() const {
+  vk::DeviceSize total = 0;
+  for(auto&& block : blocks_) {
+    total += block.used;
+  }
+  return total;
+}
+
+void TransientBufferAllocator::add_block(vk::DeviceSize min_size) {
+  vk::DeviceSize const size = std::max(block_size_, min_size);
+  std::array<std::uint32_t, 2> queue_families = {
+      device_.graphics_queue_family_idx(),
+      device_.compute_queue_family_idx()};
+
+  vk::BufferCreateInfo create_info =
+      vk::BufferCreateInfo().setSize(size).setUsage(kSupportedUsage);
+  if(device_.has_async_compute()) {
+    create_info //
+        .setSharingMode(vk::SharingMode::eConcurrent)
+        .setQueueFamilyIndices(queue_families);
+  }
+
+  VmaAllocationCreateInfo allocation_create_info = {};
+  allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+  Block block;
+  block.buffer = vma::Buffer(
+      device_.allocator(),
+      create_info,
+      allocation_create_info);
+  block.size = size;
+  blocks_.push_back(std::move(block));
+  current_block_ = blocks_.size() - 1;
+
+  LOG(Info) << "Transient buffer allocator grew to " << blocks_.size()
+            << " blocks.";
+}
+
+} // namespace rndrx::vulkan
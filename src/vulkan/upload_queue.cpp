@@ -0,0 +1,262 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "rndrx/vulkan/upload_queue.hpp"
+
+#include <cstring>
+#include <limits>
+#include <utility>
+#include "rndrx/assert.hpp"
+#include "rndrx/throw_exception.hpp"
+#include "rndrx/vulkan/device.hpp"
+#include "rndrx/vulkan/vma/allocator.hpp"
+
+namespace rndrx::vulkan {
+
+namespace {
+vk::raii::Semaphore create_timeline_semaphore(Device& device) {
+  vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo>
+      create_info(
+          vk::SemaphoreCreateInfo(),
+          vk::SemaphoreTypeCreateInfo()
+              .setSemaphoreType(vk::SemaphoreType::eTimeline)
+              .setInitialValue(0));
+  return device.vk().createSemaphore(
+      create_info.get<vk::SemaphoreCreateInfo>());
+}
+
+std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+UploadQueue::UploadQueue(Device& device, vk::DeviceSize ring_size)
+    : device_(&device)
+    , ring_(device.allocator().create_buffer(
+          vk::BufferCreateInfo()
+              .setSize(ring_size)
+              .setUsage(vk::BufferUsageFlagBits::eTransferSrc)))
+    , ring_data_(static_cast<std::byte*>(ring_.mapped_data()))
+    , ring_size_(ring_size)
+    , timeline_(create_timeline_semaphore(device))
+    , command_pool_(device.vk().createCommandPool(
+          vk::CommandPoolCreateInfo()
+              .setFlags(
+                  vk::CommandPoolCreateFlagBits::eTransient |
+                  vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
+              .setQueueFamilyIndex(device.graphics_queue_family_idx()))) {
+}
+
+UploadQueue::~UploadQueue() {
+  // Batches in flight still read from the ring and their command buffers.
+  if(*timeline_ && submitted_token_ > 0) {
+    wait(submitted_token_);
+  }
+}
+
+UploadQueue::Staging UploadQueue::stage(
+    vk::DeviceSize size,
+    vk::DeviceSize alignment) {
+  RNDRX_ASSERT(size > 0);
+  RNDRX_ASSERT(ring_size_ % alignment == 0);
+
+  // Get the GPU started on a large batch while the rest is staged.
+  if(current_ && current_->staged_bytes >= ring_size_ / 4) {
+    flush();
+  }
+
+  if(size > ring_size_) {
+    return stage_dedicated(size);
+  }
+
+  while(true) {
+    std::uint64_t start = align_up(ring_head_, alignment);
+    // Allocations don't straddle the end of the ring.
+    if(start % ring_size_ + size > ring_size_) {
+      start = align_up(start, ring_size_);
+    }
+
+    if(start + size - ring_tail_ <= ring_size_) {
+      begin_batch();
+      ring_head_ = start + size;
+      current_->staged_bytes += size;
+      vk::DeviceSize const offset = start % ring_size_;
+      return {
+          std::span<std::byte>(ring_data_ + offset, size),
+          *ring_.vk(),
+          offset};
+    }
+
+    make_room();
+  }
+}
+
+UploadQueue::Staging UploadQueue::stage_dedicated(vk::DeviceSize size) {
+  begin_batch();
+  vma::Buffer& buffer = current_->dedicated_staging.emplace_back(
+      device_->allocator().create_buffer(
+          vk::BufferCreateInfo()
+              .setSize(size)
+              .setUsage(vk::BufferUsageFlagBits::eTransferSrc)));
+  current_->staged_bytes += size;
+  return {
+      std::span<std::byte>(static_cast<std::byte*>(buffer.mapped_data()), size),
+      *buffer.vk(),
+      0};
+}
+
+vk::CommandBuffer UploadQueue::command_buffer() {
+  begin_batch();
+  return *current_->command_buffer;
+}
+
+std::uint64_t UploadQueue::upload(
+    vk::Buffer dst,
+    vk::DeviceSize dst_offset,
+    std::span<std::byte const> data) {
+  Staging staging = stage(data.size());
+  std::memcpy(staging.data.data(), data.data(), data.size());
+  command_buffer().copyBuffer(
+      staging.buffer,
+      dst,
+      vk::BufferCopy(staging.offset, dst_offset, data.size()));
+  return batch_token();
+}
+
+std::uint64_t UploadQueue::flush() {
+  if(!current_) {
+    return submitted_token_;
+  }
+
+  Batch batch = std::move(*current_);
+  current_.reset();
+  batch.command_buffer.end();
+
+  ring_.flush();
+  for(vma::Buffer& buffer : batch.dedicated_staging) {
+    buffer.flush();
+  }
+
+  batch.token = ++submitted_token_;
+  batch.ring_end = ring_head_;
+  device_->graphics_queue().submit2(
+      vk::SubmitInfo2()
+          .setCommandBufferInfos(
+              vk::CommandBufferSubmitInfo().setCommandBuffer(
+                  *batch.command_buffer))
+          .setSignalSemaphoreInfos(
+              vk::SemaphoreSubmitInfo()
+                  .setSemaphore(*timeline_)
+                  .setValue(batch.token)
+                  .setStageMask(vk::PipelineStageFlagBits2::eAllCommands)));
+  in_flight_.push_back(std::move(batch));
+  return submitted_token_;
+}
+
+std::uint64_t UploadQueue::completed_token() const {
+  return timeline_.getCounterValue();
+}
+
+void UploadQueue::wait(std::uint64_t token) {
+  if(token > submitted_token_) {
+    flush();
+  }
+
+  vk::Semaphore semaphore = *timeline_;
+  vk::Result result = device_->vk().waitSemaphores(
+      vk::SemaphoreWaitInfo().setSemaphores(semaphore).setValues(token),
+      std::numeric_limits<std::uint64_t>::max());
+
+  if(result != vk::Result::eSuccess) {
+    throw_runtime_error("Failed to wait for uploads.");
+  }
+
+  retire_completed();
+}
+
+vk::SemaphoreSubmitInfo UploadQueue::wait_info(
+    std::uint64_t token,
+    vk::PipelineStageFlags2 stages) {
+  if(token > submitted_token_) {
+    flush();
+  }
+
+  return vk::SemaphoreSubmitInfo()
+      .setSemaphore(*timeline_)
+      .setValue(token)
+      .setStageMask(stages);
+}
+
+void UploadQueue::begin_batch() {
+  if(current_) {
+    return;
+  }
+
+  Batch batch;
+  if(free_command_buffers_.empty()) {
+    batch.command_buffer = std::move(
+        device_->vk()
+            .allocateCommandBuffers(
+                vk::CommandBufferAllocateInfo()
+                    .setCommandBufferCount(1)
+                    .setCommandPool(*command_pool_)
+                    .setLevel(vk::CommandBufferLevel::ePrimary))
+            .front());
+  }
+  else {
+    batch.command_buffer = std::move(free_command_buffers_.back());
+    free_command_buffers_.pop_back();
+  }
+
+  batch.command_buffer.begin( //
+      vk::CommandBufferBeginInfo().setFlags(
+          vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+  current_ = std::move(batch);
+}
+
+void UploadQueue::make_room() {
+  if(retire_completed()) {
+    return;
+  }
+
+  if(in_flight_.empty()) {
+    if(ring_tail_ == ring_head_) {
+      // Nothing uses the ring, so start again from its beginning.
+      ring_head_ = align_up(ring_head_, ring_size_);
+      ring_tail_ = ring_head_;
+      return;
+    }
+
+    // Everything in the ring belongs to the batch being recorded.
+    flush();
+  }
+
+  wait(in_flight_.front().token);
+}
+
+bool UploadQueue::retire_completed() {
+  std::uint64_t const completed = completed_token();
+  bool retired = false;
+  while(!in_flight_.empty() && in_flight_.front().token <= completed) {
+    Batch& batch = in_flight_.front();
+    ring_tail_ = batch.ring_end;
+    batch.command_buffer.reset();
+    free_command_buffers_.push_back(std::move(batch.command_buffer));
+    in_flight_.pop_front();
+    retired = true;
+  }
+
+  return retired;
+}
+
+} // namespace rndrx::vulkan
@@ -0,0 +1,68 @@
+// Copyright (c) 2022 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "rndrx/vulkan/vma/allocation.hpp"
+
+#include "rndrx/throw_exception.hpp"
+#include "rndrx/vulkan/vma/allocator.hpp"
+
+namespace rndrx::vulkan::vma {
+Allocation::Allocation(Allocator& allocator, vk::MemoryRequirements const& requirements)
+    : allocator_(&allocator) {
+  VmaAllocationCreateInfo vma_create_info = {};
+  vma_create_info.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+  vma_create_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  VkMemoryRequirements const& requirements_ref = requirements;
+  VkResult result = vmaAllocateMemory(
+      allocator.vma(),
+      &requirements_ref,
+      &vma_create_info,
+      &allocation_,
+      &info_);
+  if(result != VK_SUCCESS) {
+    throw_runtime_error("Failed to allocate device memory.");
+  }
+}
+
+Allocation::~Allocation() {
+  clear();
+}
+
+Allocation::Allocation(Allocation&& other)
+    : allocator_(other.allocator_)
+    , allocation_(other.allocation_)
+    , info_(other.info_) {
+  other.allocation_ = nullptr;
+}
+
+Allocation& Allocation::operator=(Allocation&& rhs) {
+  clear();
+  allocator_ = rhs.allocator_;
+  allocation_ = rhs.allocation_;
+  info_ = rhs.info_;
+  rhs.allocation_ = nullptr;
+  return *this;
+}
+
+void Allocation::clear() {
+  if(allocation_) {
+    vmaFreeMemory(allocator_->vma(), allocation_);
+    allocation_ = nullptr;
+  }
+}
+
+Allocation Allocator::allocate_memory(vk::MemoryRequirements const& requirements) {
+  return Allocation(*this, requirements);
+}
+
+} // namespace rndrx::vulkan::vma
@@ -16,18 +16,31 @@
 #include "rndrx/vulkan/vma/allocator.hpp"
 
 namespace rndrx::vulkan::vma {
-Buffer::Buffer(Allocator& allocator, vk::BufferCreateInfo const& create_info)
-    : allocator_(&allocator) {
+namespace {
+VmaAllocationCreateInfo mapped_allocation_create_info() {
   VmaAllocationCreateInfo vma_create_info = {};
   vma_create_info.usage = VMA_MEMORY_USAGE_AUTO;
   vma_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
                           VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  return vma_create_info;
+}
+} // namespace
+
+Buffer::Buffer(Allocator& allocator, vk::BufferCreateInfo const& create_info)
+    : Buffer(allocator, create_info, mapped_allocation_create_info()) {
+}
+
+Buffer::Buffer(
+    Allocator& allocator,
+    vk::BufferCreateInfo const& create_info,
+    VmaAllocationCreateInfo const& allocation_create_info)
+    : allocator_(&allocator) {
   VkBuffer buffer = nullptr;
   VkBufferCreateInfo const& create_info_ref = create_info;
   vmaCreateBuffer(
       allocator.vma(),
       &create_info_ref,
-      &vma_create_info,
+      &allocation_create_info,
       &buffer,
       &allocation_,
       &info_);
@@ -47,6 +60,14 @@ Buffer& Buffer::operator=(Buffer&& rhs) {
   return *this;
 }
 
+void Buffer::invalidate() {
+  vmaInvalidateAllocation(allocator_->vma(), allocation_, 0, VK_WHOLE_SIZE);
+}
+
+void Buffer::flush() {
+  vmaFlushAllocation(allocator_->vma(), allocation_, 0, VK_WHOLE_SIZE);
+}
+
 void Buffer::clear() {
   if(*buffer_) {
     VkBuffer buffer = buffer_.release();
@@ -14,24 +14,51 @@
 #include "rndrx/vulkan/vma/image.hpp"
 
 #include <cstddef>
+#include "rndrx/throw_exception.hpp"
+#include "rndrx/vulkan/vma/allocation.hpp"
 #include "rndrx/vulkan/vma/allocator.hpp"
 
 namespace rndrx::vulkan::vma {
 Image::Image(Allocator& allocator, vk::ImageCreateInfo const& create_info)
+    : Image(allocator, create_info, VmaAllocationCreateInfo{}) {
+}
+
+Image::Image(
+    Allocator& allocator,
+    vk::ImageCreateInfo const& create_info,
+    VmaAllocationCreateInfo const& allocation_create_info)
     : allocator_(&allocator) {
-  VmaAllocationCreateInfo vma_create_info = {};
   VkImage image = nullptr;
   VkImageCreateInfo const& create_info_ref = create_info;
   vmaCreateImage(
       allocator.vma(),
       &create_info_ref,
-      &vma_create_info,
+      &allocation_create_info,
       &image,
       &allocation_,
       nullptr);
   image_ = vk::raii::Image(allocator.device(), image);
 }
 
+Image::Image(
+    Allocator& allocator,
+    vk::ImageCreateInfo const& create_info,
+    Allocation const& memory,
+    vk::DeviceSize offset)
+    : allocator_(&allocator) {
+  image_ = allocator.device().createImage(create_info);
+  VkImage image = *image_;
+  VkResult result = vmaBindImageMemory2(
+      allocator.vma(),
+      memory.vma(),
+      offset,
+      image,
+      nullptr);
+  if(result != VK_SUCCESS) {
+    throw_runtime_error("Failed to bind image memory.");
+  }
+}
+
 Image::~Image() {
   clear();
 }
@@ -41,11 +68,14 @@ Image& Image::operator=(Image&& rhs) {
   image_ = std::move(rhs.image_);
   allocator_ = rhs.allocator_;
   allocation_ = rhs.allocation_;
+  rhs.allocation_ = nullptr;
   return *this;
 }
 
 void Image::clear() {
-  if(*image_) {
+  // Placed images have no allocation of their own, the raii handle
+  // destroys them.
+  if(*image_ && allocation_) {
     vk::Image img = image_.release();
     VkImage vk_img = img;
     vmaDestroyImage(allocator_->vma(), vk_img, allocation_);
@@ -56,4 +86,17 @@ Image Allocator::create_image(vk::ImageCreateInfo const& create_info) {
   return Image(*this, create_info);
 }
 
+Image Allocator::create_image(
+    vk::ImageCreateInfo const& create_info,
+    VmaAllocationCreateInfo const& allocation_create_info) {
+  return Image(*this, create_info, allocation_create_info);
+}
+
+Image Allocator::create_image(
+    vk::ImageCreateInfo const& create_info,
+    Allocation const& memory,
+    vk::DeviceSize offset) {
+  return Image(*this, create_info, memory, offset);
+}
+
 } // namespace rndrx::vulkan::vma
\ No newline at end of file
@@ -42,6 +42,10 @@ Window::Window() {
       "rndrx-vulkan",
       /* glfwGetPrimaryMonitor() */ nullptr,
       nullptr);
+
+  // The framebuffer can be larger than the requested size on high DPI
+  // displays.
+  handle_window_size();
 }
 
 Window::~Window() {